@@ -0,0 +1,299 @@
+#include "image.h"
+#include "memory.h"
+#include "scan_kernel.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+
+using namespace bench;
+
+namespace {
+
+    const char file_magic[8] = { 'R', 'M', 'M', 'I', 'M', 'A', 'G', 'E' };
+    const uint32_t file_version = 1;
+    const size_t page = 0x1000;
+
+    struct file_region {
+        uint64_t begin;
+        uint64_t end;
+        uint32_t allocation_protect;
+        uint32_t protect;
+        uint32_t state;
+        uint32_t type;
+        uint64_t size;
+    };
+
+    // Bytes drawn with the weights scan_kernel assumes for process memory.
+    std::vector<unsigned char> code_alphabet() {
+        std::vector<unsigned char> alphabet;
+        for (unsigned b = 0; b < 256; b++)
+            alphabet.insert(alphabet.end(), rmm::scan_kernel::byte_frequency((unsigned char)b) + 1, (unsigned char)b);
+        return alphabet;
+    }
+
+}
+
+image image::synthetic(const synthetic_options &options) {
+    image result;
+    std::mt19937_64 random(options.seed);
+    auto size = (options.region_size + page - 1) & ~(page - 1);
+
+    uintptr_t address = 0x10000000;
+    for (size_t i = 0; i < options.regions; i++) {
+        address += page * (1 + random() % 16);
+        bool code = std::uniform_real_distribution<double>()(random) < options.code_ratio;
+        bool inaccessible = options.inaccessible != 0 && i % options.inaccessible == options.inaccessible - 1;
+
+        region r;
+        r.info.begin = address;
+        r.info.end = address + size;
+        r.info.protect = inaccessible ? PAGE_NOACCESS : code ? PAGE_EXECUTE_READ : PAGE_READWRITE;
+        r.info.allocation_protect = r.info.protect;
+        r.info.state = MEM_COMMIT;
+        r.info.type = code ? MEM_IMAGE : MEM_PRIVATE;
+        if (!inaccessible)
+            r.data.resize(size);
+        result._regions.push_back(std::move(r));
+        address += size;
+    }
+
+    auto alphabet = code_alphabet();
+    auto &regions = result._regions;
+    for (auto &r : regions) {
+        if (!r.readable())
+            continue;
+        if (r.info.type == MEM_IMAGE) {
+            for (auto &c : r.data)
+                c = (char)alphabet[random() % alphabet.size()];
+            continue;
+        }
+        for (size_t offset = 0; offset + sizeof(uint64_t) <= r.data.size(); offset += sizeof(uint64_t)) {
+            uint64_t value = 0;
+            auto kind = random() % 20;
+            if (kind < 8) {
+                value = 0;
+            } else if (kind < 13) {
+                auto &target = regions[random() % regions.size()];
+                value = target.info.begin + random() % (target.info.end - target.info.begin);
+            } else {
+                value = random() % 1000;
+            }
+            std::memcpy(r.data.data() + offset, &value, sizeof(value));
+        }
+    }
+    return result;
+}
+
+image image::capture(HANDLE process) {
+    image result;
+    auto &io = rmm::backend::of(process);
+    const size_t chunk = 1024 * 1024;
+
+    for (auto &r : rmm::memory(process).regions()) {
+        region captured;
+        if (auto ec = io.query(process, r.begin(), captured.info))
+            continue;
+        captured.info.begin = r.begin();
+        captured.info.end = r.end();
+        captured.data.resize(r.size());
+        // unreadable chunks (e.g. guard pages turned up in the meantime) are left zero-filled
+        for (size_t offset = 0; offset < captured.data.size(); offset += chunk) {
+            auto n = (std::min)(chunk, captured.data.size() - offset);
+            if (io.read(process, captured.info.begin + offset, captured.data.data() + offset, n))
+                std::fill_n(captured.data.data() + offset, n, '\0');
+        }
+        result._regions.push_back(std::move(captured));
+    }
+    return result;
+}
+
+image image::load(const std::string &path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+        throw std::runtime_error("cannot open image " + path);
+
+    char magic[sizeof(file_magic)];
+    uint32_t version;
+    uint64_t count;
+    in.read(magic, sizeof(magic));
+    in.read((char*)&version, sizeof(version));
+    in.read((char*)&count, sizeof(count));
+    if (!in || std::memcmp(magic, file_magic, sizeof(magic)) != 0 || version != file_version)
+        throw std::runtime_error("not an image: " + path);
+
+    image result;
+    for (uint64_t i = 0; i < count; i++) {
+        file_region header;
+        in.read((char*)&header, sizeof(header));
+        if (!in || header.end < header.begin || (header.size != 0 && header.size != header.end - header.begin))
+            throw std::runtime_error("corrupt image: " + path);
+        region r;
+        r.info = { (uintptr_t)header.begin, (uintptr_t)header.end, header.allocation_protect, header.protect, header.state, header.type };
+        r.data.resize(header.size);
+        in.read(r.data.data(), r.data.size());
+        if (!in)
+            throw std::runtime_error("truncated image: " + path);
+        result._regions.push_back(std::move(r));
+    }
+    return result;
+}
+
+void image::save(const std::string &path) const {
+    std::ofstream out(path, std::ios::binary);
+    if (!out)
+        throw std::runtime_error("cannot create image " + path);
+
+    uint64_t count = _regions.size();
+    out.write(file_magic, sizeof(file_magic));
+    out.write((const char*)&file_version, sizeof(file_version));
+    out.write((const char*)&count, sizeof(count));
+    for (auto &r : _regions) {
+        file_region header = { r.info.begin, r.info.end, r.info.allocation_protect, r.info.protect, r.info.state, r.info.type, r.data.size() };
+        out.write((const char*)&header, sizeof(header));
+        out.write(r.data.data(), r.data.size());
+    }
+    if (!out)
+        throw std::runtime_error("cannot write image " + path);
+}
+
+size_t image::readable_size() const {
+    size_t size = 0;
+    for (auto &r : _regions)
+        size += r.data.size();
+    return size;
+}
+
+const image::region* image::find(uintptr_t address) const {
+    auto it = std::upper_bound(_regions.begin(), _regions.end(), address, [](uintptr_t address, const region &r) {
+        return address < r.info.end;
+    });
+    if (it == _regions.end() || address < it->info.begin)
+        return nullptr;
+    return &*it;
+}
+
+void image::write(uintptr_t address, const void *data, size_t size) {
+    auto r = const_cast<region*>(find(address));
+    if (r == nullptr || !r->readable() || address + size > r->info.end)
+        throw std::out_of_range("write outside of a readable region");
+    std::memcpy(r->data.data() + (address - r->info.begin), data, size);
+}
+
+void io_counters::reset() {
+    reads = 0;
+    vector_reads = 0;
+    queries = 0;
+    enumerations = 0;
+    bytes = 0;
+}
+
+image_backend::image_backend(std::shared_ptr<const image> image)
+    : _image(std::move(image))
+{}
+
+uintptr_t image_backend::min_address() const {
+    return rmm::backend::native().min_address();
+}
+
+uintptr_t image_backend::max_address() const {
+    return rmm::backend::native().max_address();
+}
+
+size_t image_backend::page_size() const {
+    return page;
+}
+
+std::error_code image_backend::copy(uintptr_t address, void *buffer, size_t size) const {
+    auto out = (char*)buffer;
+    while (size != 0) {
+        auto r = _image->find(address);
+        if (r == nullptr || !r->readable())
+            return std::make_error_code(std::errc::bad_address);
+        auto n = (std::min)(size, (size_t)(r->info.end - address));
+        std::memcpy(out, r->data.data() + (address - r->info.begin), n);
+        out += n;
+        address += n;
+        size -= n;
+    }
+    return {};
+}
+
+std::error_code image_backend::read(HANDLE process, uintptr_t address, void *buffer, size_t size) {
+    _counters.reads++;
+    _counters.bytes += size;
+    return copy(address, buffer, size);
+}
+
+std::error_code image_backend::write(HANDLE process, uintptr_t address, const void *buffer, size_t size) {
+    return std::make_error_code(std::errc::read_only_file_system);
+}
+
+std::error_code image_backend::query(HANDLE process, uintptr_t address, rmm::region_info &info) {
+    _counters.queries++;
+    auto &regions = _image->regions();
+    auto it = std::upper_bound(regions.begin(), regions.end(), address, [](uintptr_t address, const image::region &r) {
+        return address < r.info.end;
+    });
+    if (it != regions.end() && it->info.begin <= address) {
+        info = it->info;
+        return {};
+    }
+    if (address >= max_address())
+        return std::make_error_code(std::errc::invalid_argument);
+    // free gap up to the next region
+    info.begin = it == regions.begin() ? min_address() : std::prev(it)->info.end;
+    info.end = it == regions.end() ? max_address() : it->info.begin;
+    info.allocation_protect = 0;
+    info.protect = PAGE_NOACCESS;
+    info.state = MEM_FREE;
+    info.type = 0;
+    return {};
+}
+
+std::error_code image_backend::protect(HANDLE process, uintptr_t address, size_t size, DWORD new_prot, DWORD &old_prot) {
+    auto r = _image->find(address);
+    if (r == nullptr)
+        return std::make_error_code(std::errc::bad_address);
+    old_prot = r->info.protect;
+    return {};
+}
+
+void image_backend::read_vector(HANDLE process, rmm::io_vector *vectors, size_t count) {
+    _counters.vector_reads++;
+    for (size_t i = 0; i < count; i++) {
+        _counters.bytes += vectors[i].size;
+        vectors[i].status = copy(vectors[i].address, vectors[i].buffer, vectors[i].size);
+    }
+}
+
+std::vector<rmm::region_info> image_backend::regions(HANDLE process, uintptr_t begin, uintptr_t end) {
+    _counters.enumerations++;
+    std::vector<rmm::region_info> result;
+    for (auto &r : _image->regions()) {
+        if (r.info.end <= begin || r.info.begin >= end)
+            continue;
+        auto info = r.info;
+        info.begin = (std::max)(info.begin, begin);
+        info.end = (std::min)(info.end, end);
+        result.push_back(info);
+    }
+    return result;
+}
+
+std::vector<rmm::module_info> image_backend::modules(HANDLE process) {
+    return {};
+}
+
+std::vector<rmm::process_info> image_backend::processes() {
+    return {};
+}
+
+HANDLE image_backend::open(DWORD pid) {
+    throw std::system_error(std::make_error_code(std::errc::operation_not_supported), "image backend");
+}
+
+void image_backend::close(HANDLE process) {
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "backend.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+    // Address space held in local memory: synthetic, loaded from a file or captured from a live process.
+    // Only committed, readable regions carry data.
+    class image {
+    public:
+        struct region {
+            rmm::region_info info;
+            std::vector<char> data;
+
+            inline bool readable() const { return !data.empty(); }
+        };
+
+        struct synthetic_options {
+            size_t regions = 64;
+            size_t region_size = 1024 * 1024;
+            // Share of regions filled with code-like bytes, the rest holds pointers, small integers and zero fill.
+            double code_ratio = 0.5;
+            // Regions are separated by unmapped gaps, every `inaccessible`-th one is PAGE_NOACCESS (0 - none).
+            size_t inaccessible = 8;
+            uint64_t seed = 1;
+        };
+
+        static image synthetic(const synthetic_options &options);
+        // Snapshot of every readable region of `process`.
+        static image capture(HANDLE process);
+        static image load(const std::string &path);
+        void save(const std::string &path) const;
+
+        inline const std::vector<region>& regions() const { return _regions; }
+        size_t readable_size() const;
+
+        // Region containing `address`, nullptr if it is unmapped.
+        const region* find(uintptr_t address) const;
+        // Overwrites bytes of a readable region (`size` must not cross its end).
+        void write(uintptr_t address, const void *data, size_t size);
+
+        // Uniformly distributed address of a readable byte such that [address, address + size) is readable.
+        template<typename Random>
+        uintptr_t random_address(Random &random, size_t size) const;
+
+    private:
+        std::vector<region> _regions;
+    };
+
+    // Calls issued to a backend, by type. Each one stands for a syscall of the native backends
+    // (process_vm_readv/ReadProcessMemory, VirtualQueryEx, one /proc/<pid>/maps read).
+    struct io_counters {
+        std::atomic<size_t> reads{ 0 };
+        std::atomic<size_t> vector_reads{ 0 };
+        std::atomic<size_t> queries{ 0 };
+        std::atomic<size_t> enumerations{ 0 };
+        std::atomic<size_t> bytes{ 0 };
+
+        inline size_t syscalls() const { return reads + vector_reads + queries + enumerations; }
+        void reset();
+    };
+
+    // Backend serving an image (attach it to a made-up HANDLE, see rmm::backend::attach).
+    class image_backend : public rmm::backend {
+    public:
+        image_backend(std::shared_ptr<const image> image);
+
+        inline io_counters& counters() { return _counters; }
+
+        uintptr_t min_address() const override;
+        uintptr_t max_address() const override;
+        size_t page_size() const override;
+
+        std::error_code read(HANDLE process, uintptr_t address, void *buffer, size_t size) override;
+        std::error_code write(HANDLE process, uintptr_t address, const void *buffer, size_t size) override;
+        std::error_code query(HANDLE process, uintptr_t address, rmm::region_info &info) override;
+        std::error_code protect(HANDLE process, uintptr_t address, size_t size, DWORD new_prot, DWORD &old_prot) override;
+        void read_vector(HANDLE process, rmm::io_vector *vectors, size_t count) override;
+        std::vector<rmm::region_info> regions(HANDLE process, uintptr_t begin, uintptr_t end) override;
+
+        std::vector<rmm::module_info> modules(HANDLE process) override;
+        std::vector<rmm::process_info> processes() override;
+        HANDLE open(DWORD pid) override;
+        void close(HANDLE process) override;
+
+    private:
+        std::error_code copy(uintptr_t address, void *buffer, size_t size) const;
+
+        std::shared_ptr<const image> _image;
+        io_counters _counters;
+    };
+
+    template<typename Random>
+    uintptr_t image::random_address(Random &random, size_t size) const {
+        std::vector<const region*> candidates;
+        size_t total = 0;
+        for (auto &r : _regions) {
+            if (r.readable() && r.data.size() >= size) {
+                candidates.push_back(&r);
+                total += r.data.size() - size + 1;
+            }
+        }
+        if (total == 0)
+            return 0;
+        auto n = (size_t)(random() % total);
+        for (auto r : candidates) {
+            auto count = r->data.size() - size + 1;
+            if (n < count)
+                return r->info.begin + n;
+            n -= count;
+        }
+        return 0;
+    }
+
+}
@@ -0,0 +1,403 @@
+// Throughput of the rmm::memory scanners over synthetic and captured address spaces.
+//
+//     bench [options]
+//         --image <file>           scan a captured image (repeatable) instead of the synthetic ones
+//         --capture <pid> <file>   capture the readable memory of a process into an image and exit
+//         --filter <text>          run only cases whose name contains <text>
+//         --repeat <n>             time the best of <n> runs (default 3)
+//         --size <MiB>             size of each synthetic address space (default 64)
+//         --threads                scan on thread_pool::shared()
+//         --seed <n>               seed of synthetic images and patterns (default 1)
+//
+// Every case is checked against a naive reference scan; the exit code is non-zero on any mismatch.
+// Syscalls are calls issued to the backend (reads, vectored reads, queries, region enumerations),
+// allocations are calls to operator new during a scan, MiB and GB/s count the bytes read through the backend.
+
+#include "image.h"
+#include "reference.h"
+
+#include "memory.h"
+#include "process.h"
+#include "region_reader.h"
+#include "signature.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace bench;
+
+namespace {
+
+    std::atomic<size_t> allocations{ 0 };
+
+}
+
+void* operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (auto p = std::malloc(size != 0 ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    std::free(p);
+}
+
+namespace {
+
+    // Made-up process handle the image backends are attached to.
+    const HANDLE image_process = (HANDLE)(intptr_t)0x1AA6E;
+
+    // Signature of the signature_matcher case, parsed at compile time.
+    constexpr auto code_signature = rmm::make_signature("48 8B 05 ?? ?? ?? ?? 4? 89");
+    static_assert(code_signature.length() == 9, "signature length");
+    static_assert(code_signature.pattern(0) == '\x48' && code_signature.mask(0) == '\xFF', "exact byte");
+    static_assert(code_signature.pattern(3) == '\x00' && code_signature.mask(3) == '\x00', "wildcard byte");
+    static_assert(code_signature.pattern(7) == '\x40' && code_signature.mask(7) == '\xF0', "high nibble byte");
+    static_assert(code_signature.class_of(7) == decltype(code_signature)::high_nibble, "byte class");
+    // 05 is the rarest exact byte in code (see scan_kernel::byte_frequency)
+    static_assert(code_signature.anchor() == 2, "signature anchor");
+    static_assert(rmm::make_signature("?? ?? ??").anchor() == 3, "no anchor without fixed bytes");
+    typedef rmm::signature_matcher<code_signature> code_matcher;
+
+    struct options {
+        std::vector<std::string> images;
+        std::string filter;
+        size_t repeat = 3;
+        size_t size = 64;
+        bool threads = false;
+        uint64_t seed = 1;
+    };
+
+    struct source {
+        std::string name;
+        std::shared_ptr<const bench::image> contents;
+        // Synthetic images get matches planted, in captured ones patterns are sampled from the contents.
+        bool synthetic;
+    };
+
+    // Pattern of a case and the image it is searched in.
+    struct prepared {
+        std::shared_ptr<const bench::image> contents;
+        std::string pattern;
+        std::string mask;
+        uintptr_t target = 0;
+    };
+
+    struct scenario {
+        std::string scanner;
+        size_t length;
+        double wildcards;
+        // Planted matches per MiB of readable memory.
+        size_t density;
+
+        std::string name(bool synthetic) const {
+            auto name = scanner;
+            if (scanner != "find_references" && scanner != "find_call_references")
+                name += " len=" + std::to_string(length);
+            if (wildcards != 0)
+                name += " wild=" + std::to_string((int)(wildcards * 100)) + "%";
+            if (synthetic)
+                name += " dens=" + std::to_string(density);
+            return name;
+        }
+    };
+
+    typedef std::function<std::vector<uintptr_t>(const rmm::memory&, const prepared&)> scan_fn;
+    typedef std::function<std::vector<uintptr_t>(const image&, const prepared&)> reference_fn;
+
+    std::vector<uintptr_t> addresses(const std::vector<rmm::pointer> &pointers) {
+        std::vector<uintptr_t> result;
+        result.reserve(pointers.size());
+        for (auto &p : pointers)
+            result.push_back(p);
+        return result;
+    }
+
+    std::vector<uintptr_t> single(const rmm::pointer &p) {
+        if (p == nullptr)
+            return {};
+        return { (uintptr_t)p };
+    }
+
+    std::vector<uintptr_t> first_of(std::vector<uintptr_t> found) {
+        if (found.size() > 1)
+            found.resize(1);
+        return found;
+    }
+
+    std::vector<uintptr_t> last_of(std::vector<uintptr_t> found) {
+        if (found.size() > 1)
+            found.erase(found.begin(), found.end() - 1);
+        return found;
+    }
+
+    // Bytes distributed like code, never NUL, so that wildcards ('?' under a NUL mask) do not end pattern strings.
+    std::string random_bytes(std::mt19937_64 &random, size_t length) {
+        std::string bytes(length, '\0');
+        for (auto &c : bytes) {
+            do
+                c = (char)(random() % 256);
+            while (c == '\0' || random() % 256 > rmm::scan_kernel::byte_frequency((unsigned char)c));
+        }
+        return bytes;
+    }
+
+    // Value at a readable address of the image (at least sizeof(T) bytes up to the end of its region).
+    template<typename T>
+    T read_value(const image &img, uintptr_t address) {
+        T value{};
+        if (auto r = img.find(address); r != nullptr && r->readable() && address + sizeof(T) <= r->info.end)
+            std::memcpy(&value, r->data.data() + (address - r->info.begin), sizeof(T));
+        return value;
+    }
+
+    prepared prepare(const source &src, const scenario &sc, std::mt19937_64 &random) {
+        prepared p;
+        std::shared_ptr<image> planted;
+        if (src.synthetic)
+            planted = std::make_shared<image>(*src.contents);
+        auto &img = planted ? *planted : *src.contents;
+        auto count = planted ? sc.density * (img.readable_size() >> 20) : 0;
+
+        if (sc.scanner == "find_references") {
+            if (planted) {
+                p.target = img.random_address(random, 1);
+            } else {
+                // a non-zero value stored in the image, so that at least one reference exists
+                for (int attempt = 0; attempt < 1000 && p.target == 0; attempt++)
+                    p.target = read_value<uintptr_t>(img, img.random_address(random, sizeof(uintptr_t)) & ~(sizeof(uintptr_t) - 1));
+            }
+            for (size_t i = 0; i < count; i++)
+                planted->write(img.random_address(random, sizeof(uintptr_t)) & ~(sizeof(uintptr_t) - 1), &p.target, sizeof(p.target));
+        } else if (sc.scanner == "find_call_references") {
+            p.target = img.random_address(random, 1);
+            if (!planted) {
+                // the destination of something that looks like a call
+                for (int attempt = 0; attempt < 100000; attempt++) {
+                    auto at = img.random_address(random, 5);
+                    if (read_value<unsigned char>(img, at) == 0xE8) {
+                        p.target = at + 5 + read_value<int32_t>(img, at + 1);
+                        break;
+                    }
+                }
+            }
+            for (size_t i = 0; i < count; i++) {
+                auto at = img.random_address(random, 5);
+                char call[5] = { '\xE8' };
+                auto rel = (int32_t)(p.target - (at + 5));
+                std::memcpy(call + 1, &rel, sizeof(rel));
+                planted->write(at, call, sizeof(call));
+            }
+        } else if (sc.scanner == "signature_matcher") {
+            p.pattern.assign(code_signature.pattern(), code_signature.length());
+            p.mask.assign(code_signature.mask(), code_signature.length());
+            for (size_t i = 0; i < count; i++) {
+                // masked out bits are random
+                auto bytes = random_bytes(random, p.pattern.size());
+                for (size_t j = 0; j < bytes.size(); j++)
+                    bytes[j] = (char)((bytes[j] & ~p.mask[j]) | p.pattern[j]);
+                planted->write(img.random_address(random, bytes.size()), bytes.data(), bytes.size());
+            }
+        } else {
+            if (planted) {
+                p.pattern = random_bytes(random, sc.length);
+            } else {
+                // a window which is not a run of a single byte (zero fill would match everywhere)
+                p.pattern.resize(sc.length);
+                for (int attempt = 0; attempt < 1000; attempt++) {
+                    auto at = img.random_address(random, sc.length);
+                    auto r = img.find(at);
+                    std::memcpy(&p.pattern[0], r->data.data() + (at - r->info.begin), sc.length);
+                    if (p.pattern.find_first_not_of(p.pattern[0]) != std::string::npos)
+                        break;
+                }
+            }
+            p.mask.assign(sc.length, '\xFF');
+            // the first byte stays fixed, leading wildcards would just be skipped
+            for (size_t i = 1; i < sc.length; i++) {
+                if (std::uniform_real_distribution<double>()(random) < sc.wildcards) {
+                    p.pattern[i] = '?';
+                    p.mask[i] = '\0';
+                }
+            }
+            for (size_t i = 0; i < count; i++)
+                planted->write(img.random_address(random, sc.length), p.pattern.data(), sc.length);
+        }
+
+        p.contents = planted ? planted : src.contents;
+        return p;
+    }
+
+    bool run(const options &opts, const source &src, const scenario &sc, const scan_fn &scan, const reference_fn &check, std::mt19937_64 &random) {
+        auto name = sc.name(src.synthetic);
+        if (!opts.filter.empty() && name.find(opts.filter) == std::string::npos)
+            return true;
+
+        auto p = prepare(src, sc, random);
+        auto io = std::make_shared<image_backend>(p.contents);
+        rmm::backend::attach(image_process, io);
+        rmm::memory memory(image_process);
+        if (opts.threads)
+            memory.set_scan_pool(&rmm::thread_pool::shared());
+
+        std::vector<uintptr_t> found;
+        double best = 0;
+        size_t syscalls = 0, allocated = 0, bytes = 0;
+        for (size_t i = 0; i < opts.repeat; i++) {
+            io->counters().reset();
+            auto allocated_before = allocations.load();
+            auto begin = std::chrono::steady_clock::now();
+            found = scan(memory, p);
+            auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+            if (i == 0) {
+                syscalls = io->counters().syscalls();
+                bytes = io->counters().bytes;
+                allocated = allocations.load() - allocated_before;
+            }
+            if (i == 0 || seconds < best)
+                best = seconds;
+        }
+        rmm::backend::detach(image_process);
+
+        auto expected = check(*p.contents, p);
+        bool correct = found == expected;
+        std::printf("%-44s %-14s %8.1f %9.2f %9zu %8zu %8zu  %s\n",
+            name.c_str(), src.name.c_str(), bytes / 1048576.0, best > 0 ? bytes / best / 1e9 : 0.0,
+            syscalls, allocated, found.size(), correct ? "ok" : "MISMATCH");
+        if (!correct)
+            std::printf("    expected %zu matches\n", expected.size());
+        return correct;
+    }
+
+    bool run_all(const options &opts, const source &src) {
+        std::mt19937_64 random(opts.seed);
+        bool ok = true;
+
+        auto exact = [](const rmm::memory &m, const prepared &p) { return addresses(m.find(p.pattern.data(), p.pattern.size())); };
+        auto exact_reference = [](const image &img, const prepared &p) { return reference::find(img, p.pattern.data(), p.pattern.size()); };
+        for (size_t length : { 4, 16, 64 })
+            for (size_t density : { 0, 64 })
+                ok &= run(opts, src, { "find", length, 0, density }, exact, exact_reference, random);
+
+        ok &= run(opts, src, { "find_first", 16, 0, 1 },
+            [](const rmm::memory &m, const prepared &p) { return single(m.find_first(p.pattern.data(), p.pattern.size())); },
+            [&](const image &img, const prepared &p) { return first_of(exact_reference(img, p)); }, random);
+        ok &= run(opts, src, { "find_last", 16, 0, 1 },
+            [](const rmm::memory &m, const prepared &p) { return single(m.find_last(p.pattern.data(), p.pattern.size())); },
+            [&](const image &img, const prepared &p) { return last_of(exact_reference(img, p)); }, random);
+
+        auto masked = [](const rmm::memory &m, const prepared &p) { return addresses(m.find_by_pattern(p.pattern.c_str(), p.mask.c_str())); };
+        auto masked_reference = [](const image &img, const prepared &p) { return reference::find_by_pattern(img, p.pattern.c_str(), p.mask.c_str()); };
+        for (size_t length : { 16, 64 })
+            for (double wildcards : { 0.1, 0.4 })
+                for (size_t density : { 0, 64 })
+                    ok &= run(opts, src, { "find_by_pattern", length, wildcards, density }, masked, masked_reference, random);
+
+        ok &= run(opts, src, { "find_first_by_pattern", 32, 0.25, 1 },
+            [](const rmm::memory &m, const prepared &p) { return single(m.find_first_by_pattern(p.pattern.c_str(), p.mask.c_str())); },
+            [&](const image &img, const prepared &p) { return first_of(masked_reference(img, p)); }, random);
+
+        // the compile-time matcher, chunked as memory::find chunks regions
+        for (size_t density : { 0, 64 }) {
+            ok &= run(opts, src, { "signature_matcher", code_matcher::length, 0, density },
+                [](const rmm::memory &m, const prepared &) {
+                    std::vector<uintptr_t> found;
+                    rmm::region_reader reader(m.begin().process(), m.scan_budget());
+                    for (auto &region : m.regions()) {
+                        reader.forward(region.begin(), region.end(), code_matcher::length - 1, [&](uintptr_t address, const char *chunk, size_t size) {
+                            for (auto p = code_matcher::first(chunk, size); p != nullptr; p = code_matcher::first(p + 1, chunk + size - (p + 1)))
+                                found.push_back(address + (p - chunk));
+                            return true;
+                        });
+                    }
+                    return found;
+                },
+                [](const image &img, const prepared &p) { return reference::find_masked(img, p.pattern.data(), p.mask.data(), p.pattern.size()); }, random);
+        }
+
+        for (size_t density : { 1, 64 }) {
+            ok &= run(opts, src, { "find_references", sizeof(uintptr_t), 0, density },
+                [](const rmm::memory &m, const prepared &p) { return addresses(m.find_references(p.target)); },
+                [](const image &img, const prepared &p) { return reference::find_references(img, p.target); }, random);
+            ok &= run(opts, src, { "find_call_references", 5, 0, density },
+                [](const rmm::memory &m, const prepared &p) { return addresses(m.find_call_references(p.target)); },
+                [](const image &img, const prepared &p) { return reference::find_call_references(img, p.target); }, random);
+        }
+        return ok;
+    }
+
+    void usage() {
+        std::fprintf(stderr, "usage: bench [--image <file>]... [--capture <pid> <file>] [--filter <text>] [--repeat <n>] [--size <MiB>] [--threads] [--seed <n>]\n");
+    }
+
+}
+
+int main(int argc, char **argv) {
+    options opts;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto has = [&](int n) { return i + n < argc; };
+        if (arg == "--image" && has(1)) {
+            opts.images.push_back(argv[++i]);
+        } else if (arg == "--capture" && has(2)) {
+            auto pid = (DWORD)std::strtoul(argv[i + 1], nullptr, 10);
+            auto process = rmm::backend::native().open(pid);
+            image::capture(process).save(argv[i + 2]);
+            rmm::backend::native().close(process);
+            return 0;
+        } else if (arg == "--filter" && has(1)) {
+            opts.filter = argv[++i];
+        } else if (arg == "--repeat" && has(1)) {
+            opts.repeat = (std::max)((size_t)1, (size_t)std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--size" && has(1)) {
+            opts.size = (std::max)((size_t)1, (size_t)std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--threads") {
+            opts.threads = true;
+        } else if (arg == "--seed" && has(1)) {
+            opts.seed = std::strtoull(argv[++i], nullptr, 10);
+        } else {
+            usage();
+            return 2;
+        }
+    }
+
+    std::vector<source> sources;
+    if (opts.images.empty()) {
+        // same amount of memory split into few large, some medium and many small regions
+        for (size_t region_size : { 4096 * 1024, 256 * 1024, 16 * 1024 }) {
+            image::synthetic_options so;
+            so.region_size = region_size;
+            so.regions = (std::max)((size_t)1, (opts.size << 20) / region_size);
+            so.seed = opts.seed;
+            auto name = std::to_string(so.regions) + "x" + std::to_string(region_size >> 10) + "K";
+            sources.push_back({ name, std::make_shared<const image>(image::synthetic(so)), true });
+        }
+    } else {
+        for (auto &path : opts.images) {
+            auto name = path.substr(path.find_last_of("/\\") + 1);
+            sources.push_back({ name, std::make_shared<const image>(image::load(path)), false });
+        }
+    }
+
+    std::printf("%-44s %-14s %8s %9s %9s %8s %8s  %s\n", "case", "image", "MiB", "GB/s", "syscalls", "allocs", "matches", "check");
+    bool ok = true;
+    for (auto &src : sources)
+        ok &= run_all(opts, src);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,77 @@
+#include "reference.h"
+
+#include <cstring>
+
+using namespace bench;
+
+namespace {
+
+    bool searched(const image::region &r) {
+        auto &info = r.info;
+        return r.readable()
+            && info.allocation_protect != 0
+            && info.protect != 0 && info.protect != PAGE_NOACCESS && !(info.protect & PAGE_GUARD)
+            && info.state == MEM_COMMIT;
+    }
+
+    template<typename F>
+    std::vector<uintptr_t> find_where(const image &image, size_t length, F &&matches) {
+        std::vector<uintptr_t> found;
+        for (auto &r : image.regions()) {
+            if (!searched(r) || r.data.size() < length)
+                continue;
+            for (size_t i = 0; i + length <= r.data.size(); i++)
+                if (matches(r.data.data() + i, r.info.begin + i))
+                    found.push_back(r.info.begin + i);
+        }
+        return found;
+    }
+
+}
+
+std::vector<uintptr_t> reference::find(const image &image, const char *data, size_t length) {
+    if (length == 0)
+        return {};
+    return find_where(image, length, [&](const char *p, uintptr_t) {
+        for (size_t i = 0; i < length; i++)
+            if (p[i] != data[i])
+                return false;
+        return true;
+    });
+}
+
+std::vector<uintptr_t> reference::find_by_pattern(const image &image, const char *pattern, const char *mask) {
+    while (*mask == '\x00' && *pattern != '\x00') {
+        pattern++;
+        mask++;
+    }
+    size_t length = 0;
+    while (pattern[length] != '\x00' || mask[length] != '\x00')
+        length++;
+    return find_masked(image, pattern, mask, length);
+}
+
+std::vector<uintptr_t> reference::find_masked(const image &image, const char *pattern, const char *mask, size_t length) {
+    if (length == 0)
+        return {};
+    return find_where(image, length, [&](const char *p, uintptr_t) {
+        for (size_t i = 0; i < length; i++)
+            if ((p[i] & mask[i]) != (pattern[i] & mask[i]))
+                return false;
+        return true;
+    });
+}
+
+std::vector<uintptr_t> reference::find_references(const image &image, uintptr_t ptr) {
+    return find(image, (const char*)&ptr, sizeof(ptr));
+}
+
+std::vector<uintptr_t> reference::find_call_references(const image &image, uintptr_t func) {
+    return find_where(image, 5, [&](const char *p, uintptr_t address) {
+        if ((unsigned char)p[0] != 0xE8)
+            return false;
+        int32_t rel;
+        std::memcpy(&rel, p + 1, sizeof(rel));
+        return address + 5 + rel == func;
+    });
+}
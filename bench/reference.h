@@ -0,0 +1,25 @@
+#pragma once
+
+#include "image.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace bench {
+
+    // Naive scanners over an image, byte by byte with no chunking, filtering or vectorization.
+    // They follow the conventions of the rmm::memory scanners they check: only committed, accessible regions
+    // are searched, a match never spans two regions, and pattern/mask strings end where both have a NUL
+    // with leading wildcards skipped.
+    namespace reference {
+
+        std::vector<uintptr_t> find(const image &image, const char *data, size_t length);
+        std::vector<uintptr_t> find_by_pattern(const image &image, const char *pattern, const char *mask);
+        // Pattern and mask of explicit length (as in rmm::signature), matches reported at the first byte.
+        std::vector<uintptr_t> find_masked(const image &image, const char *pattern, const char *mask, size_t length);
+        std::vector<uintptr_t> find_references(const image &image, uintptr_t ptr);
+        std::vector<uintptr_t> find_call_references(const image &image, uintptr_t func);
+
+    }
+
+}
@@ -0,0 +1,172 @@
+#include "async_scan.h"
+#include "region_reader.h"
+#include "statistics.h"
+
+#include <thread>
+
+using namespace rmm;
+
+async_scan::async_scan(const memory &memory, const scan_kernel &kernel, clock::time_point deadline)
+    : _memory(memory)
+    , _kernel(kernel)
+    , _deadline(deadline)
+    , _future(_promise.get_future().share())
+{}
+
+std::shared_ptr<async_scan> async_scan::start(const memory &memory, const scan_kernel &kernel, options &&options) {
+    std::shared_ptr<async_scan> scan(new async_scan(memory, kernel, options.deadline));
+    auto task = [scan] { scan->run(); };
+    if (options.executor)
+        options.executor(task);
+    else
+        std::thread(task).detach();
+    return scan;
+}
+
+std::shared_ptr<async_scan> async_scan::find(const memory &memory, const scan_kernel &kernel, options options) {
+    return start(memory, kernel, std::move(options));
+}
+
+std::shared_ptr<async_scan> async_scan::find(const memory &memory, const char *data, size_t length, options options) {
+    // an empty pattern has no matches, as with memory::find
+    return start(memory, scan_kernel(data, length), std::move(options));
+}
+
+std::shared_ptr<async_scan> async_scan::find(const memory &memory, const std::string &data, options options) {
+    return find(memory, data.c_str(), data.length() + 1, std::move(options));
+}
+
+std::shared_ptr<async_scan> async_scan::find_by_pattern(const memory &memory, const char *pattern, const char *mask, options options) {
+    size_t length;
+    if (!memory::prepare_pattern(pattern, mask, length))
+        return start(memory, scan_kernel(pattern, mask, 0), std::move(options));
+    return start(memory, scan_kernel(pattern, mask, length), std::move(options));
+}
+
+std::shared_ptr<async_scan> async_scan::find_references(const memory &memory, uintptr_t ptr, options options) {
+    return find(memory, (char*)&ptr, sizeof(ptr), std::move(options));
+}
+
+async_scan::progress_info async_scan::progress() const {
+    progress_info info;
+    info.bytes_scanned = _bytes_scanned.load(std::memory_order_relaxed);
+    info.bytes_total = _bytes_total.load(std::memory_order_relaxed);
+    info.regions_scanned = _regions_scanned.load(std::memory_order_relaxed);
+    info.regions_total = _regions_total.load(std::memory_order_relaxed);
+    info.matches = _match_count.load(std::memory_order_relaxed);
+    return info;
+}
+
+std::vector<pointer> async_scan::matches() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::vector<pointer> matches;
+    matches.reserve(_match_count.load(std::memory_order_relaxed));
+    for (auto &f : _found)
+        matches.insert(matches.end(), f.begin(), f.end());
+    return matches;
+}
+
+bool async_scan::stopping() {
+    return _cancel.load(std::memory_order_relaxed)
+        || (_deadline != clock::time_point() && clock::now() >= _deadline);
+}
+
+void async_scan::run() {
+    try {
+        statistics::scope scope(_memory._stats.get());
+        auto process = _memory._process;
+        auto budget = _memory._scan_budget;
+        auto pool = _memory._scan_pool;
+        auto length = _kernel.length();
+        auto overlap = length != 0 ? length - 1 : 0;
+
+        // Regions are split into pieces as by memory::find, so that there is something to spread over the pool
+        // and to stop between even where the reader maps the target instead of reading chunks.
+        std::vector<memory> pieces;
+        std::vector<uintptr_t> piece_end;   // end of the bytes counted for the piece, i.e. without its overlap
+        std::vector<size_t> piece_region;
+        uint64_t total = 0;
+        auto regions = length != 0 ? _memory.scan_regions(length, _kernel.matches_zero()) : std::vector<memory>();
+        for (size_t r = 0; r < regions.size(); r++) {
+            auto split = memory::split_regions({ regions[r] }, budget * 4, overlap, memory::forward);
+            for (size_t i = 0; i < split.size(); i++) {
+                pieces.push_back(split[i]);
+                piece_end.push_back(i + 1 < split.size() ? split[i + 1]._begin : split[i]._end);
+                piece_region.push_back(r);
+            }
+            total += regions[r].size();
+        }
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _found.resize(pieces.size());
+        }
+        _bytes_total.store(total, std::memory_order_relaxed);
+        _regions_total.store(regions.size(), std::memory_order_relaxed);
+
+        std::vector<std::atomic<size_t>> pieces_left(regions.size());
+        for (auto r : piece_region)
+            pieces_left[r].fetch_add(1, std::memory_order_relaxed);
+        std::atomic<bool> stopped{ false };
+
+        auto scan_piece = [&](size_t i, region_reader &reader) {
+            if (stopping()) {
+                stopped = true;
+                return;
+            }
+            auto &piece = pieces[i];
+            statistics::add(statistics::regions_visited);
+            statistics::timer timer(statistics::scan_region, piece.begin(), piece.end());
+
+            auto counted = piece._begin;
+            auto read = piece._begin;
+            std::vector<pointer> found;
+            reader.forward(piece._begin, piece._end, overlap, [&](uintptr_t address, const char *chunk, size_t size) {
+                found.clear();
+                for (auto p = _kernel.first(chunk, size); p != nullptr; p = _kernel.first(p + 1, chunk + size - (p + 1)))
+                    found.emplace_back(process, address + (p - chunk));
+                if (!found.empty()) {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    _found[i].insert(_found[i].end(), found.begin(), found.end());
+                    _match_count.fetch_add(found.size(), std::memory_order_relaxed);
+                }
+                read = address + size;
+                auto end = (std::min)(read, piece_end[i]);
+                if (end > counted) {
+                    _bytes_scanned.fetch_add(end - counted, std::memory_order_relaxed);
+                    counted = end;
+                }
+                return !stopping();
+            });
+            timer.stop(counted - piece._begin);
+
+            // matches near the end of the piece are only whole once its overlap has been read too
+            if (read < piece._end)
+                stopped = true;
+            else if (pieces_left[piece_region[i]].fetch_sub(1) == 1)
+                _regions_scanned.fetch_add(1, std::memory_order_relaxed);
+        };
+
+        if (pool == nullptr) {
+            region_reader reader(process, budget);
+            for (size_t i = 0; i < pieces.size(); i++)
+                scan_piece(i, reader);
+        } else {
+            std::vector<region_reader> readers(pool->concurrency(), region_reader(process, budget));
+            pool->parallel_for(pieces.size(), [&](size_t i, size_t worker) {
+                statistics::scope scope(_memory._stats.get());
+                scan_piece(i, readers[worker]);
+            });
+        }
+
+        if (!stopped)
+            _state.store(completed, std::memory_order_release);
+        else if (_cancel.load(std::memory_order_relaxed))
+            _state.store(cancelled, std::memory_order_release);
+        else
+            _state.store(expired, std::memory_order_release);
+        _promise.set_value(matches());
+    } catch (...) {
+        _state.store(failed, std::memory_order_release);
+        _promise.set_exception(std::current_exception());
+    }
+}
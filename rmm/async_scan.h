@@ -0,0 +1,113 @@
+#pragma once
+
+#include "typedefs.h"
+#include "pointer.h"
+#include "memory.h"
+#include "scan_kernel.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace rmm {
+
+    // Scan running in the background with the semantics of memory::find, find_by_pattern and find_references:
+    // the same matches in the same (ascending) order, read through the memory's budget, pool and statistics.
+    // Progress can be polled, the scan can be cancelled or given a deadline (both take effect between chunks),
+    // and the matches found so far are available at any time.
+    //
+    //     auto scan = async_scan::find(heap, "needle");
+    //     while (scan->wait_for(std::chrono::milliseconds(100)) == std::future_status::timeout)
+    //         show(scan->progress());
+    //     auto matches = scan->get();
+    //
+    // The scan keeps itself alive until it ends, whether or not anyone still holds it.
+    class async_scan {
+    public:
+        typedef std::chrono::steady_clock clock;
+        // Runs `task` on some thread. The default executor starts a new (detached) thread.
+        typedef std::function<void(std::function<void()> task)> executor;
+
+        struct options {
+            async_scan::executor executor;
+            // none if left at the clock's epoch
+            clock::time_point deadline;
+        };
+
+        enum status {
+            running,
+            completed,
+            cancelled,
+            expired,    // stopped at the deadline
+            failed,     // a read failed, get() rethrows the error
+        };
+
+        // Regions are counted once scanned in full; totals are 0 until the regions have been enumerated.
+        struct progress_info {
+            uint64_t bytes_scanned;
+            uint64_t bytes_total;
+            size_t regions_scanned;
+            size_t regions_total;
+            size_t matches;
+        };
+
+        static std::shared_ptr<async_scan> find(const memory &memory, const scan_kernel &kernel, options options = {});
+        static std::shared_ptr<async_scan> find(const memory &memory, const char *data, size_t length, options options = {});
+        static std::shared_ptr<async_scan> find(const memory &memory, const std::string &data, options options = {});
+        static std::shared_ptr<async_scan> find_by_pattern(const memory &memory, const char *pattern, const char *mask, options options = {});
+        static std::shared_ptr<async_scan> find_references(const memory &memory, uintptr_t ptr, options options = {});
+
+        async_scan(const async_scan&) = delete;
+        async_scan& operator=(const async_scan&) = delete;
+
+        // Asks the scan to stop after the chunks being searched.
+        inline void cancel() { _cancel.store(true, std::memory_order_relaxed); }
+
+        inline status state() const { return _state.load(std::memory_order_acquire); }
+        inline bool done() const { return state() != running; }
+        progress_info progress() const;
+
+        // Matches found so far in ascending order of address, all of them once completed.
+        std::vector<pointer> matches() const;
+
+        // Becomes ready when the scan ends, with the matches found until then (even if cancelled or expired).
+        inline std::shared_future<std::vector<pointer>> future() const { return _future; }
+        inline void wait() const { _future.wait(); }
+        template<typename Rep, typename Period>
+        inline std::future_status wait_for(const std::chrono::duration<Rep, Period> &timeout) const { return _future.wait_for(timeout); }
+        inline std::vector<pointer> get() const { return _future.get(); }
+
+    private:
+        async_scan(const memory &memory, const scan_kernel &kernel, clock::time_point deadline);
+
+        static std::shared_ptr<async_scan> start(const memory &memory, const scan_kernel &kernel, options &&options);
+        void run();
+        bool stopping();
+
+        memory _memory;
+        scan_kernel _kernel;
+        clock::time_point _deadline;
+
+        std::atomic<bool> _cancel{ false };
+        std::atomic<status> _state{ running };
+        std::atomic<uint64_t> _bytes_scanned{ 0 };
+        std::atomic<uint64_t> _bytes_total{ 0 };
+        std::atomic<size_t> _regions_scanned{ 0 };
+        std::atomic<size_t> _regions_total{ 0 };
+        std::atomic<size_t> _match_count{ 0 };
+
+        // matches per piece of the regions, pieces in ascending order of address
+        mutable std::mutex _mutex;
+        std::vector<std::vector<pointer>> _found;
+
+        std::promise<std::vector<pointer>> _promise;
+        std::shared_future<std::vector<pointer>> _future;
+    };
+
+}
@@ -0,0 +1,100 @@
+#include "backend.h"
+
+#ifdef _WIN32
+#include "win32_backend.h"
+#else
+#include "linux_backend.h"
+#endif
+
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+using namespace rmm;
+
+namespace {
+
+    std::shared_mutex attached_mutex;
+    std::unordered_map<HANDLE, std::shared_ptr<backend>> attached;
+    std::atomic<size_t> attached_count{ 0 };
+
+}
+
+void backend::read_vector(HANDLE process, io_vector *vectors, size_t count) {
+    for (size_t i = 0; i < count; i++)
+        vectors[i].status = read(process, vectors[i].address, vectors[i].buffer, vectors[i].size);
+}
+
+void backend::write_vector(HANDLE process, io_vector *vectors, size_t count) {
+    for (size_t i = 0; i < count; i++)
+        vectors[i].status = write(process, vectors[i].address, vectors[i].buffer, vectors[i].size);
+}
+
+const void* backend::view(HANDLE process, uintptr_t address, size_t size) {
+    return nullptr;
+}
+
+std::error_code backend::populated_pages(HANDLE process, uintptr_t begin, uintptr_t end, std::vector<uint64_t> &bitmap) {
+    return std::make_error_code(std::errc::not_supported);
+}
+
+std::error_code backend::clear_written(HANDLE process) {
+    return std::make_error_code(std::errc::not_supported);
+}
+
+std::error_code backend::written_pages(HANDLE process, uintptr_t begin, uintptr_t end, std::vector<uint64_t> &bitmap) {
+    return std::make_error_code(std::errc::not_supported);
+}
+
+std::vector<region_info> backend::regions(HANDLE process, uintptr_t begin, uintptr_t end) {
+    std::vector<region_info> regions;
+
+    for (uintptr_t base = begin; base < end; ) {
+        region_info ri;
+        if (auto ec = query(process, base, ri))
+            throw std::system_error(ec);
+
+        if (ri.begin < begin)
+            ri.begin = begin;
+        if (ri.end > end)
+            ri.end = end;
+        if (ri.end <= base)
+            break;
+
+        regions.push_back(ri);
+        base = ri.end;
+    }
+
+    return regions;
+}
+
+backend& backend::native() {
+#ifdef _WIN32
+    static win32_backend instance;
+#else
+    static linux_backend instance;
+#endif
+    return instance;
+}
+
+backend& backend::of(HANDLE process) {
+    if (attached_count.load(std::memory_order_acquire) != 0) {
+        std::shared_lock lock(attached_mutex);
+        if (auto it = attached.find(process); it != attached.end())
+            return *it->second;
+    }
+    return native();
+}
+
+void backend::attach(HANDLE process, std::shared_ptr<backend> impl) {
+    std::unique_lock lock(attached_mutex);
+    attached[process] = std::move(impl);
+    attached_count.store(attached.size(), std::memory_order_release);
+}
+
+void backend::detach(HANDLE process) {
+    std::unique_lock lock(attached_mutex);
+    attached.erase(process);
+    attached_count.store(attached.size(), std::memory_order_release);
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "typedefs.h"
+#include "platform.h"
+
+#include <memory>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace rmm {
+
+    // Description of a single region of the address space.
+    // Protection, state and type use Win32 values (PAGE_*, MEM_*) on every platform.
+    struct region_info {
+        uintptr_t begin;
+        uintptr_t end;
+        DWORD allocation_protect;
+        DWORD protect;
+        DWORD state;
+        DWORD type;
+    };
+
+    // Element of a vectored transfer: `size` bytes at `address` from/into `buffer`.
+    struct io_vector {
+        uintptr_t address;
+        void *buffer;
+        size_t size;
+        std::error_code status;
+    };
+
+    struct module_info {
+        std::wstring name;
+        uintptr_t begin;
+        uintptr_t end;
+    };
+
+    struct process_info {
+        DWORD id;
+        std::wstring name;
+    };
+
+    // Memory access backend: everything rmm does to another process goes through here.
+    // Primitive I/O reports errors via std::error_code (so callers may decide whether to throw),
+    // enumeration throws std::system_error.
+    class backend {
+    public:
+        virtual ~backend() = default;
+
+        virtual uintptr_t min_address() const = 0;
+        virtual uintptr_t max_address() const = 0;
+        virtual size_t page_size() const = 0;
+
+        virtual std::error_code read(HANDLE process, uintptr_t address, void *buffer, size_t size) = 0;
+        virtual std::error_code write(HANDLE process, uintptr_t address, const void *buffer, size_t size) = 0;
+        virtual std::error_code query(HANDLE process, uintptr_t address, region_info &info) = 0;
+        virtual std::error_code protect(HANDLE process, uintptr_t address, size_t size, DWORD new_prot, DWORD &old_prot) = 0;
+
+        // Transfers every element in order and sets its status.
+        // The defaults issue a read/write per element; backends with vectored I/O need far fewer calls.
+        virtual void read_vector(HANDLE process, io_vector *vectors, size_t count);
+        virtual void write_vector(HANDLE process, io_vector *vectors, size_t count);
+
+        // The `size` bytes at `address` if the backend holds them in local memory (e.g. a mapped file),
+        // so that scans can run over them in place; nullptr (the default) if they have to be read.
+        // Valid while the backend is alive.
+        virtual const void* view(HANDLE process, uintptr_t address, size_t size);
+
+        // Sets bit i of `bitmap` (resized to fit) for every page i of [begin, end) holding data, in memory or swapped out.
+        // Private pages left clear were never populated and read as zeros. `begin` and `end` are page aligned.
+        // Returns errc::not_supported (the default) if the backend cannot tell.
+        virtual std::error_code populated_pages(HANDLE process, uintptr_t begin, uintptr_t end, std::vector<uint64_t> &bitmap);
+
+        // Write tracking (soft-dirty bits on Linux): clear_written starts a new epoch for the whole process,
+        // written_pages sets bit i of `bitmap` (resized to fit) for every page i of [begin, end) written since.
+        // `begin` and `end` are page aligned. Both return errc::not_supported (the default) if writes cannot be tracked.
+        virtual std::error_code clear_written(HANDLE process);
+        virtual std::error_code written_pages(HANDLE process, uintptr_t begin, uintptr_t end, std::vector<uint64_t> &bitmap);
+
+        // Returns regions intersecting [begin, end) in ascending order, clipped to the range.
+        // Free ranges may be omitted.
+        virtual std::vector<region_info> regions(HANDLE process, uintptr_t begin, uintptr_t end);
+
+        virtual std::vector<module_info> modules(HANDLE process) = 0;
+        virtual std::vector<process_info> processes() = 0;
+        virtual HANDLE open(DWORD pid) = 0;
+        virtual void close(HANDLE process) = 0;
+
+        // Backend of the running platform (Win32 or Linux).
+        static backend& native();
+
+        // Backend serving `process`: the one attached to it, or the native one.
+        static backend& of(HANDLE process);
+
+        // Routes every access to `process` through `impl`.
+        // Must not race with operations in flight on the same handle.
+        static void attach(HANDLE process, std::shared_ptr<backend> impl);
+        static void detach(HANDLE process);
+    };
+
+}
@@ -0,0 +1,155 @@
+#include "batch.h"
+#include "backend.h"
+#include "page_cache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+using namespace rmm;
+
+namespace {
+
+    // Consecutive entries (in order of address) of a batch transferred as one range.
+    struct span {
+        uintptr_t begin;
+        uintptr_t end;
+        size_t first;
+        size_t last;
+        size_t scratch; // offset in the scratch buffer, if the range covers more than one entry
+    };
+
+    std::vector<size_t> sorted(const std::vector<batch_entry> &entries) {
+        std::vector<size_t> order(entries.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            auto pa = entries[a].ptr.process(), pb = entries[b].ptr.process();
+            if (pa != pb)
+                return pa < pb;
+            return (uintptr_t)entries[a].ptr < (uintptr_t)entries[b].ptr;
+        });
+        return order;
+    }
+
+    // Transfers the ranges of one process.
+    void transfer(HANDLE process, bool write, std::vector<io_vector> &vectors) {
+        if (vectors.empty())
+            return;
+        if (write)
+            backend::of(process).write_vector(process, vectors.data(), vectors.size());
+        else
+            backend::of(process).read_vector(process, vectors.data(), vectors.size());
+    }
+
+    size_t execute(std::vector<batch_entry> &entries, bool write) {
+        auto order = sorted(entries);
+        size_t failed = 0;
+
+        for (size_t group = 0; group < order.size(); ) {
+            auto process = entries[order[group]].ptr.process();
+            auto page_size = backend::of(process).page_size();
+            auto group_end = group;
+            while (group_end < order.size() && entries[order[group_end]].ptr.process() == process)
+                group_end++;
+
+            // Coalesce entries into spans.
+            std::vector<span> spans;
+            size_t scratch_size = 0;
+            for (auto i = group; i < group_end; i++) {
+                auto &e = entries[order[i]];
+                e.status = {};
+                if (e.size == 0)
+                    continue;
+                uintptr_t begin = e.ptr;
+                auto end = begin + e.size;
+                if (!spans.empty()) {
+                    auto &s = spans.back();
+                    // reads may also span a gap within the last page already being read
+                    auto reach = write ? s.end : (std::max)(s.end, (s.end + page_size - 1) & ~(uintptr_t)(page_size - 1));
+                    if (write ? begin == s.end : begin <= reach) {
+                        s.end = (std::max)(s.end, end);
+                        s.last = i;
+                        continue;
+                    }
+                }
+                spans.push_back({ begin, end, i, i, 0 });
+            }
+            for (auto &s : spans) {
+                if (s.first != s.last) {
+                    s.scratch = scratch_size;
+                    scratch_size += s.end - s.begin;
+                }
+            }
+
+            std::vector<char> scratch(scratch_size);
+            std::vector<io_vector> vectors;
+            vectors.reserve(spans.size());
+            for (auto &s : spans) {
+                if (s.first == s.last) {
+                    vectors.push_back({ s.begin, entries[order[s.first]].buffer, s.end - s.begin, {} });
+                    continue;
+                }
+                auto buffer = scratch.data() + s.scratch;
+                if (write) {
+                    for (auto i = s.first; i <= s.last; i++) {
+                        auto &e = entries[order[i]];
+                        if (e.size != 0)
+                            std::memcpy(buffer + ((uintptr_t)e.ptr - s.begin), e.buffer, e.size);
+                    }
+                }
+                vectors.push_back({ s.begin, buffer, s.end - s.begin, {} });
+            }
+
+            transfer(process, write, vectors);
+
+            // Distribute the results, entries of failed ranges are retried one by one.
+            std::vector<io_vector> retry;
+            std::vector<size_t> retry_entries;
+            for (size_t k = 0; k < spans.size(); k++) {
+                auto &s = spans[k];
+                auto &v = vectors[k];
+                if (s.first == s.last) {
+                    entries[order[s.first]].status = v.status;
+                    continue;
+                }
+                for (auto i = s.first; i <= s.last; i++) {
+                    auto &e = entries[order[i]];
+                    if (e.size == 0)
+                        continue;
+                    if (!v.status) {
+                        if (!write)
+                            std::memcpy(e.buffer, (const char*)v.buffer + ((uintptr_t)e.ptr - s.begin), e.size);
+                    } else {
+                        retry.push_back({ (uintptr_t)e.ptr, e.buffer, e.size, {} });
+                        retry_entries.push_back(order[i]);
+                    }
+                }
+            }
+            transfer(process, write, retry);
+            for (size_t k = 0; k < retry.size(); k++)
+                entries[retry_entries[k]].status = retry[k].status;
+
+            auto cache = write ? page_cache::of(process) : nullptr;
+            for (auto i = group; i < group_end; i++) {
+                auto &e = entries[order[i]];
+                if (e.status)
+                    failed++;
+                else if (cache && e.size != 0)
+                    cache->update(e.ptr, e.buffer, e.size);
+            }
+
+            group = group_end;
+        }
+
+        return failed;
+    }
+
+}
+
+size_t rmm::read_batch(std::vector<batch_entry> &entries) {
+    return execute(entries, false);
+}
+
+size_t rmm::write_batch(std::vector<batch_entry> &entries) {
+    return execute(entries, true);
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "typedefs.h"
+#include "pointer.h"
+
+#include <system_error>
+#include <vector>
+
+namespace rmm {
+
+    // Entry of a batched transfer: `size` bytes at `ptr` from/into `buffer`.
+    struct batch_entry {
+        batch_entry(pointer ptr, void *buffer, size_t size)
+            : ptr(ptr)
+            , buffer(buffer)
+            , size(size)
+        {}
+
+        template<typename T>
+        batch_entry(pointer ptr, T &value)
+            : batch_entry(ptr, &value, sizeof(T))
+        {}
+
+        pointer ptr;
+        void *buffer;
+        size_t size;
+        std::error_code status;
+    };
+
+    // Reads every entry and sets its status. Returns the number of entries which failed.
+    // Entries are grouped by process and sorted by address; entries overlapping or sharing a page are read as one range.
+    // The ranges of a process are transferred with as few vectored calls as the backend allows
+    // (process_vm_readv takes up to IOV_MAX of them at once).
+    // Entries of a range which could not be read are retried on their own.
+    size_t read_batch(std::vector<batch_entry> &entries);
+
+    // Writes every entry and sets its status. Returns the number of entries which failed.
+    // Adjacent entries are written as one range; overlapping entries are written in order of address.
+    // Unlike pointer::operator<<, page protection is left untouched.
+    size_t write_batch(std::vector<batch_entry> &entries);
+
+}
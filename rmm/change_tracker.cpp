@@ -0,0 +1,254 @@
+#include "change_tracker.h"
+#include "backend.h"
+#include "region_reader.h"
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <system_error>
+#include <unordered_map>
+
+using namespace rmm;
+
+namespace {
+
+    typedef change_tracker::page_range page_range;
+
+    // Trackers using write tracking, by process.
+    std::mutex trackers_mutex;
+    std::unordered_map<HANDLE, std::vector<change_tracker*>> trackers;
+
+    inline uint64_t rotate_left(uint64_t x, int r) {
+        return (x << r) | (x >> (64 - r));
+    }
+
+    // Four independent lanes over 64-bit words. Each step is a bijection of its lane,
+    // so pages differing in a single word never hash the same.
+    uint64_t hash_page(const char *data, size_t size) {
+        const uint64_t k = 0x9E3779B97F4A7C15ull;
+        uint64_t lanes[4] = { k, k + 1, k + 2, k + 3 };
+        for (size_t i = 0; i + 32 <= size; i += 32) {
+            for (size_t l = 0; l < 4; l++) {
+                uint64_t word;
+                std::memcpy(&word, data + i + l * 8, sizeof(word));
+                lanes[l] = rotate_left((lanes[l] ^ word) * k, 31);
+            }
+        }
+        uint64_t hash = 0;
+        for (auto lane : lanes)
+            hash = rotate_left((hash ^ lane) * k, 27);
+        return hash;
+    }
+
+    // Appends [begin, end) to ranges in ascending order, merging it with the last one if they touch.
+    void append(std::vector<page_range> &ranges, uintptr_t begin, uintptr_t end) {
+        if (!ranges.empty() && ranges.back().second >= begin)
+            ranges.back().second = (std::max)(ranges.back().second, end);
+        else
+            ranges.emplace_back(begin, end);
+    }
+
+    void normalize(std::vector<page_range> &ranges) {
+        std::sort(ranges.begin(), ranges.end());
+        std::vector<page_range> merged;
+        merged.reserve(ranges.size());
+        for (auto &r : ranges)
+            append(merged, r.first, r.second);
+        ranges = std::move(merged);
+    }
+
+    // Appends the parts of `a` not covered by `b` (both normalized) to `out`.
+    void subtract(const std::vector<page_range> &a, const std::vector<page_range> &b, std::vector<page_range> &out) {
+        size_t j = 0;
+        for (auto &r : a) {
+            auto begin = r.first;
+            while (j < b.size() && b[j].second <= begin)
+                j++;
+            for (auto k = j; k < b.size() && b[k].first < r.second; k++) {
+                if (b[k].first > begin)
+                    out.emplace_back(begin, b[k].first);
+                begin = (std::max)(begin, b[k].second);
+            }
+            if (begin < r.second)
+                out.emplace_back(begin, r.second);
+        }
+    }
+
+}
+
+change_tracker::change_tracker(const memory &memory, tracking_method method)
+    : _memory(memory)
+    , _method(method)
+    , _page_size(backend::of(memory.begin().process()).page_size())
+{
+    auto process = _memory.begin().process();
+    if (_method != hashing) {
+        // an empty range tells whether the backend tracks writes at all
+        std::vector<uint64_t> bitmap;
+        auto ec = backend::of(process).written_pages(process, 0, 0, bitmap);
+        if (ec && _method == written)
+            throw std::system_error(ec, "cannot track writes");
+        _method = ec ? hashing : written;
+    }
+    if (_method == written) {
+        std::lock_guard lock(trackers_mutex);
+        trackers[process].push_back(this);
+    }
+}
+
+change_tracker::~change_tracker() {
+    if (_method != written)
+        return;
+    std::lock_guard lock(trackers_mutex);
+    auto it = trackers.find(_memory.begin().process());
+    it->second.erase(std::find(it->second.begin(), it->second.end(), this));
+    if (it->second.empty())
+        trackers.erase(it);
+}
+
+std::vector<page_range> change_tracker::readable_ranges() const {
+    std::vector<page_range> ranges;
+    auto mask = ~(uintptr_t)(_page_size - 1);
+    for (auto &region : _memory.regions()) {
+        // regions are clipped to the tracked memory, which need not be page aligned
+        append(ranges, (uintptr_t)region.begin() & mask, ((uintptr_t)region.end() + _page_size - 1) & mask);
+    }
+    return ranges;
+}
+
+void change_tracker::collect_written(const std::vector<page_range> &ranges) {
+    auto process = _memory.begin().process();
+    auto &io = backend::of(process);
+    std::vector<uint64_t> bitmap;
+    for (auto &r : ranges) {
+        if (io.written_pages(process, r.first, r.second, bitmap)) {
+            _pending.push_back(r);
+            continue;
+        }
+        auto pages = (size_t)((r.second - r.first) / _page_size);
+        for (size_t i = 0; i < pages; i++) {
+            if (bitmap[i / 64] & (1ull << (i % 64)))
+                _pending.emplace_back(r.first + i * _page_size, r.first + (i + 1) * _page_size);
+        }
+    }
+    normalize(_pending);
+}
+
+void change_tracker::advance_written(const std::vector<page_range> &ranges) {
+    auto process = _memory.begin().process();
+    std::lock_guard lock(trackers_mutex);
+    // clearing the bits affects every tracker of the process
+    for (auto tracker : trackers[process]) {
+        if (tracker == this)
+            collect_written(ranges);
+        else
+            tracker->collect_written(tracker->readable_ranges());
+    }
+    if (auto ec = backend::of(process).clear_written(process))
+        throw std::system_error(ec, "cannot clear written pages");
+    _changes = std::move(_pending);
+    _pending.clear();
+}
+
+void change_tracker::advance_hashing(const std::vector<page_range> &ranges) {
+    struct piece {
+        uintptr_t begin;
+        uintptr_t end;
+        std::vector<page_hash> hashes;
+        bool failed;
+    };
+
+    auto process = _memory.begin().process();
+    // chunks of whole pages
+    auto budget = (std::max)(_memory.scan_budget() & ~(size_t)(_page_size - 1), _page_size);
+    std::vector<piece> pieces;
+    for (auto &r : ranges) {
+        for (auto begin = r.first; begin < r.second; ) {
+            auto end = r.second - begin > budget * 4 ? begin + budget * 4 : r.second;
+            pieces.push_back({ begin, end, {}, false });
+            begin = end;
+        }
+    }
+
+    auto hash = [&](region_reader &reader, piece &p) {
+        p.hashes.reserve((size_t)((p.end - p.begin) / _page_size));
+        try {
+            reader.forward(p.begin, p.end, 0, [&](uintptr_t address, const char *data, size_t size) {
+                for (size_t offset = 0; offset < size; offset += _page_size)
+                    p.hashes.push_back({ address + offset, hash_page(data + offset, _page_size) });
+                return true;
+            });
+        } catch (const std::system_error&) {
+            // unmapped in the meantime
+            p.hashes.clear();
+            p.failed = true;
+        }
+    };
+
+    auto pool = _memory.scan_pool();
+    if (pool == nullptr) {
+        region_reader reader(process, budget);
+        for (auto &p : pieces)
+            hash(reader, p);
+    } else {
+        std::vector<region_reader> readers(pool->concurrency(), region_reader(process, budget));
+        pool->parallel_for(pieces.size(), [&](size_t i, size_t worker) {
+            statistics::scope scope(_memory.stats_sink().get());
+            hash(readers[worker], pieces[i]);
+        });
+    }
+
+    std::vector<page_hash> hashes;
+    hashes.reserve(_hashes.size());
+    size_t previous = 0;
+    for (auto &p : pieces) {
+        // not hashed, so it counts as changed until it is
+        if (p.failed)
+            append(_changes, p.begin, p.end);
+        for (auto &h : p.hashes) {
+            while (previous < _hashes.size() && _hashes[previous].address < h.address)
+                previous++;
+            if (previous == _hashes.size() || _hashes[previous].address != h.address || _hashes[previous].hash != h.hash)
+                append(_changes, h.address, h.address + _page_size);
+            hashes.push_back(h);
+        }
+    }
+    _hashes = std::move(hashes);
+}
+
+size_t change_tracker::advance() {
+    statistics::scope scope(_memory.stats_sink().get());
+    auto ranges = readable_ranges();
+
+    _changes.clear();
+    if (_method == written)
+        advance_written(ranges);
+    else
+        advance_hashing(ranges);
+
+    if (_epoch == 0) {
+        _changes = ranges;
+    } else {
+        // pages which became readable or stopped being readable
+        subtract(ranges, _ranges, _changes);
+        subtract(_ranges, ranges, _changes);
+        normalize(_changes);
+    }
+    _ranges = std::move(ranges);
+
+    _changed_pages = 0;
+    for (auto &r : _changes)
+        _changed_pages += (size_t)((r.second - r.first) / _page_size);
+    _epoch++;
+    return _changed_pages;
+}
+
+bool change_tracker::changed(uintptr_t begin, uintptr_t end) const {
+    auto mask = ~(uintptr_t)(_page_size - 1);
+    if (_epoch == 0 || begin < ((uintptr_t)_memory.begin() & mask) || end > (((uintptr_t)_memory.end() + _page_size - 1) & mask))
+        return true;
+    auto it = std::upper_bound(_changes.begin(), _changes.end(), begin, [](uintptr_t address, const page_range &r) {
+        return address < r.second;
+    });
+    return it != _changes.end() && it->first < end;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "typedefs.h"
+#include "memory.h"
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace rmm {
+
+    // Pages of `memory` changed from one epoch to the next, so that follow-up scans re-read only those
+    // (see value_scan::set_tracker and tracked_scan).
+    //
+    // Uses the backend's write tracking if it has any (soft-dirty bits on Linux, see backend::clear_written),
+    // in which case no memory is read. Otherwise every page is hashed at each epoch and compared with its previous hash:
+    // everything is still read once per epoch, but unchanged pages are not matched again.
+    // Pages which became readable or stopped being readable count as changed too.
+    //
+    // Write tracking is per process: when a tracker starts a new epoch, the other trackers of the process
+    // collect the bits of their ranges first, so each of them still sees every write.
+    // A write racing with the start of an epoch may be missed until the page is written again.
+    class change_tracker {
+    public:
+        enum tracking_method {
+            automatic,  // write tracking if available, hashing otherwise
+            written,    // write tracking only, std::system_error if unavailable
+            hashing,
+        };
+
+        // Pages [first, second).
+        typedef std::pair<uintptr_t, uintptr_t> page_range;
+
+        explicit change_tracker(const memory &memory, tracking_method method = automatic);
+        ~change_tracker();
+
+        change_tracker(const change_tracker&) = delete;
+        change_tracker& operator=(const change_tracker&) = delete;
+
+        // Ends the epoch: collects the pages changed since the previous call (every readable page at the first one)
+        // and starts the next epoch. Returns the number of changed pages.
+        size_t advance();
+
+        inline tracking_method method() const { return _method; }
+        // Number of calls to advance.
+        inline uint64_t epoch() const { return _epoch; }
+        // Pages changed during the last epoch in ascending order, adjacent ones merged.
+        inline const std::vector<page_range>& changes() const { return _changes; }
+        inline size_t changed_pages() const { return _changed_pages; }
+        // Whether [begin, end) overlaps a page changed during the last epoch.
+        // Ranges outside the tracked memory are always reported as changed.
+        bool changed(uintptr_t begin, uintptr_t end) const;
+
+    private:
+        struct page_hash {
+            uintptr_t address;
+            uint64_t hash;
+        };
+
+        std::vector<page_range> readable_ranges() const;
+        void collect_written(const std::vector<page_range> &ranges);
+        void advance_written(const std::vector<page_range> &ranges);
+        void advance_hashing(const std::vector<page_range> &ranges);
+
+        memory _memory;
+        tracking_method _method;
+        size_t _page_size;
+        uint64_t _epoch = 0;
+        std::vector<page_range> _changes;
+        size_t _changed_pages = 0;
+        // readable pages at the end of the last epoch
+        std::vector<page_range> _ranges;
+        // writes collected since the last epoch (write tracking)
+        std::vector<page_range> _pending;
+        // hashes of the readable pages at the end of the last epoch in ascending order of address (hashing)
+        std::vector<page_hash> _hashes;
+    };
+
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstdint>
+
+namespace rmm {
+
+    // ELF structures (System V gABI), for reading core files and images on every platform.
+    // Headers shared by both classes are templated on the address type (uint32_t or uint64_t),
+    // natural alignment gives them the layout of the specification.
+    namespace elf {
+
+        const unsigned char magic[4] = { 0x7F, 'E', 'L', 'F' };
+
+        enum : unsigned char { class32 = 1, class64 = 2 };
+        enum : unsigned char { little_endian = 1 };
+        enum : unsigned char { ident_class = 4, ident_data = 5 };
+
+        enum : uint16_t { et_exec = 2, et_dyn = 3, et_core = 4 };
+        enum : uint16_t { em_386 = 3, em_arm = 40, em_x86_64 = 62, em_aarch64 = 183 };
+        enum : uint32_t { pt_load = 1, pt_dynamic = 2, pt_note = 4 };
+        enum : uint32_t { pf_x = 1, pf_w = 2, pf_r = 4 };
+        enum : uint32_t { sht_nobits = 8 };
+        enum : uint64_t { shf_write = 1, shf_alloc = 2, shf_execinstr = 4 };
+        enum : uint32_t { nt_gnu_build_id = 3, nt_file = 0x46494C45 };
+        enum : uint64_t {
+            dt_null = 0, dt_pltrelsz = 2, dt_hash = 4, dt_strtab = 5, dt_symtab = 6, dt_rela = 7, dt_relasz = 8,
+            dt_strsz = 10, dt_syment = 11, dt_rel = 17, dt_relsz = 18, dt_pltrel = 20, dt_jmprel = 23, dt_gnu_hash = 0x6FFFFEF5,
+            dt_versym = 0x6FFFFFF0,
+        };
+        enum : uint16_t { shn_undef = 0 };
+        enum : unsigned char { stb_local = 0, stt_section = 3, stt_file = 4 };
+
+        template<typename Addr>
+        struct file_header {
+            unsigned char ident[16];
+            uint16_t type;
+            uint16_t machine;
+            uint32_t version;
+            Addr entry;
+            Addr phoff;
+            Addr shoff;
+            uint32_t flags;
+            uint16_t ehsize;
+            uint16_t phentsize;
+            uint16_t phnum;
+            uint16_t shentsize;
+            uint16_t shnum;
+            uint16_t shstrndx;
+        };
+
+        struct program_header32 {
+            uint32_t type;
+            uint32_t offset;
+            uint32_t vaddr;
+            uint32_t paddr;
+            uint32_t filesz;
+            uint32_t memsz;
+            uint32_t flags;
+            uint32_t align;
+        };
+
+        struct program_header64 {
+            uint32_t type;
+            uint32_t flags;
+            uint64_t offset;
+            uint64_t vaddr;
+            uint64_t paddr;
+            uint64_t filesz;
+            uint64_t memsz;
+            uint64_t align;
+        };
+
+        template<typename Addr>
+        struct section_header {
+            uint32_t name;
+            uint32_t type;
+            Addr flags;
+            Addr addr;
+            Addr offset;
+            Addr size;
+            uint32_t link;
+            uint32_t info;
+            Addr addralign;
+            Addr entsize;
+        };
+
+        struct symbol32 {
+            uint32_t name;
+            uint32_t value;
+            uint32_t size;
+            unsigned char info;
+            unsigned char other;
+            uint16_t shndx;
+        };
+
+        struct symbol64 {
+            uint32_t name;
+            unsigned char info;
+            unsigned char other;
+            uint16_t shndx;
+            uint64_t value;
+            uint64_t size;
+        };
+
+        template<typename Addr>
+        struct dynamic_entry {
+            Addr tag;
+            Addr value;
+        };
+
+        // Elf_Rel, and Elf_Rela without the addend.
+        template<typename Addr>
+        struct relocation {
+            Addr offset;
+            Addr info;
+        };
+
+        struct note_header {
+            uint32_t namesz;
+            uint32_t descsz;
+            uint32_t type;
+        };
+
+        static_assert(sizeof(file_header<uint32_t>) == 52 && sizeof(file_header<uint64_t>) == 64, "ELF header layout");
+        static_assert(sizeof(program_header32) == 32 && sizeof(program_header64) == 56, "ELF program header layout");
+        static_assert(sizeof(symbol32) == 16 && sizeof(symbol64) == 24, "ELF symbol layout");
+        static_assert(sizeof(section_header<uint32_t>) == 40 && sizeof(section_header<uint64_t>) == 64, "ELF section header layout");
+
+    }
+
+}
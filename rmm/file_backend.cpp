@@ -0,0 +1,603 @@
+#include "file_backend.h"
+#include "elf_headers.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+using namespace rmm;
+
+namespace {
+
+    const size_t page = 0x1000;
+    const uintptr_t default_elf_base = 0x400000;
+
+    inline uint64_t align_up(uint64_t value, uint64_t alignment) {
+        return alignment == 0 ? value : (value + alignment - 1) / alignment * alignment;
+    }
+
+    DWORD protection(bool r, bool w, bool x) {
+        if (x)
+            return w ? PAGE_EXECUTE_READWRITE : r ? PAGE_EXECUTE_READ : PAGE_EXECUTE;
+        return w ? PAGE_READWRITE : r ? PAGE_READONLY : PAGE_NOACCESS;
+    }
+
+    inline bool readable(const region_info &region) {
+        return region.state == MEM_COMMIT && region.protect != PAGE_NOACCESS && !(region.protect & PAGE_GUARD);
+    }
+
+    inline region_info committed(uintptr_t begin, uintptr_t end, DWORD protect, DWORD type) {
+        return { begin, end, protect, protect, MEM_COMMIT, type };
+    }
+
+    std::wstring file_name(const std::string &path) {
+        auto slash = path.find_last_of("/\\");
+        return std::filesystem::path(slash == std::string::npos ? path : path.substr(slash + 1)).wstring();
+    }
+
+    // Bounds checked access to the mapped file.
+    class file_view {
+    public:
+        file_view(const char *data, size_t size, const std::filesystem::path &path)
+            : _data(data)
+            , _size(size)
+            , _path(path)
+        {}
+
+        template<typename T>
+        T get(uint64_t offset) const {
+            T value;
+            std::memcpy(&value, at(offset, sizeof(T)), sizeof(T));
+            return value;
+        }
+
+        const char* at(uint64_t offset, uint64_t size) const {
+            if (offset > _size || size > _size - offset)
+                fail("truncated");
+            return _data + offset;
+        }
+
+        [[noreturn]] void fail(const char *what) const {
+            throw std::runtime_error(std::string(what) + ": " + _path.string());
+        }
+
+    private:
+        const char *_data;
+        size_t _size;
+        const std::filesystem::path &_path;
+    };
+
+    struct segment {
+        uint32_t type;
+        uint32_t flags;
+        uint64_t offset;
+        uint64_t vaddr;
+        uint64_t filesz;
+        uint64_t memsz;
+    };
+
+    template<typename Addr, typename ProgramHeader>
+    std::vector<segment> program_headers(const file_view &file, const elf::file_header<Addr> &header) {
+        if (header.phnum != 0 && header.phentsize < sizeof(ProgramHeader))
+            file.fail("bad ELF program header size");
+        std::vector<segment> segments;
+        for (uint16_t i = 0; i < header.phnum; i++) {
+            auto ph = file.get<ProgramHeader>(header.phoff + (uint64_t)i * header.phentsize);
+            segments.push_back({ ph.type, ph.flags, ph.offset, ph.vaddr, ph.filesz, ph.memsz });
+        }
+        return segments;
+    }
+
+    inline DWORD protection(const segment &s) {
+        return protection((s.flags & elf::pf_r) != 0, (s.flags & elf::pf_w) != 0, (s.flags & elf::pf_x) != 0);
+    }
+
+    unsigned char elf_class(const file_view &file, size_t size) {
+        if (size < 16 || std::memcmp(file.at(0, 4), elf::magic, sizeof(elf::magic)) != 0)
+            return 0;
+        auto ident = file.at(0, 16);
+        if (ident[elf::ident_data] != elf::little_endian)
+            file.fail("big endian ELF is not supported");
+        if (ident[elf::ident_class] != elf::class32 && ident[elf::ident_class] != elf::class64)
+            file.fail("unknown ELF class");
+        return ident[elf::ident_class];
+    }
+
+    // One line of a raw dump table: begin-end perms offset [path]
+    bool parse_table_line(const std::string &line, region_info &region, uint64_t &offset, std::string &path) {
+        std::istringstream in(line);
+        std::string range, perms;
+        if (!(in >> range >> perms >> std::hex >> offset))
+            return false;
+        auto dash = range.find('-');
+        if (dash == std::string::npos || perms.size() < 3)
+            return false;
+        try {
+            region.begin = (uintptr_t)std::stoull(range.substr(0, dash), nullptr, 16);
+            region.end = (uintptr_t)std::stoull(range.substr(dash + 1), nullptr, 16);
+        } catch (const std::logic_error&) {
+            return false;
+        }
+        std::getline(in >> std::ws, path);
+        region.protect = protection(perms[0] == 'r', perms[1] == 'w', perms[2] == 'x');
+        region.allocation_protect = region.protect;
+        region.state = MEM_COMMIT;
+        region.type = path.empty() || path[0] == '[' ? MEM_PRIVATE : MEM_IMAGE;
+        return region.begin < region.end;
+    }
+
+}
+
+file_backend::file_backend(const std::filesystem::path &path)
+    : _path(path)
+{
+#ifdef _WIN32
+    _file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (_file == INVALID_HANDLE_VALUE) {
+        _file = nullptr;
+        throw std::system_error(GetLastError(), std::system_category(), path.string());
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(_file, &size)) {
+        auto error = GetLastError();
+        CloseHandle(_file);
+        throw std::system_error(error, std::system_category(), path.string());
+    }
+    _size = (size_t)size.QuadPart;
+    if (_size == 0)
+        return;
+    _file_mapping = CreateFileMappingW(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (_file_mapping != nullptr)
+        _data = (const char*)MapViewOfFile(_file_mapping, FILE_MAP_READ, 0, 0, 0);
+    if (_data == nullptr) {
+        auto error = GetLastError();
+        if (_file_mapping != nullptr)
+            CloseHandle(_file_mapping);
+        CloseHandle(_file);
+        throw std::system_error(error, std::system_category(), path.string());
+    }
+#else
+    auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        throw std::system_error(errno, std::system_category(), path.string());
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        auto error = errno;
+        ::close(fd);
+        throw std::system_error(error, std::system_category(), path.string());
+    }
+    _size = (size_t)st.st_size;
+    if (_size != 0) {
+        auto data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            auto error = errno;
+            ::close(fd);
+            throw std::system_error(error, std::system_category(), path.string());
+        }
+        _data = (const char*)data;
+    }
+    ::close(fd);
+#endif
+}
+
+file_backend::~file_backend() {
+#ifdef _WIN32
+    if (_data != nullptr)
+        UnmapViewOfFile(_data);
+    if (_file_mapping != nullptr)
+        CloseHandle(_file_mapping);
+    if (_file != nullptr)
+        CloseHandle(_file);
+#else
+    if (_data != nullptr)
+        munmap((void*)_data, _size);
+#endif
+}
+
+std::shared_ptr<file_backend> file_backend::core(const std::filesystem::path &path) {
+    std::shared_ptr<file_backend> result(new file_backend(path));
+    result->load_core();
+    return result;
+}
+
+std::shared_ptr<file_backend> file_backend::raw(const std::filesystem::path &path, const std::filesystem::path &table) {
+    std::shared_ptr<file_backend> result(new file_backend(path));
+    result->load_raw(table);
+    return result;
+}
+
+std::shared_ptr<file_backend> file_backend::image(const std::filesystem::path &path, uintptr_t base) {
+    std::shared_ptr<file_backend> result(new file_backend(path));
+    result->load_image(base);
+    return result;
+}
+
+HANDLE file_backend::attach(std::shared_ptr<file_backend> impl) {
+    // the object's address is unique for as long as it is attached
+    auto handle = (HANDLE)impl.get();
+    backend::attach(handle, std::move(impl));
+    return handle;
+}
+
+void file_backend::load_core() {
+    file_view file(_data, _size, _path);
+    auto cls = elf_class(file, _size);
+    if (cls == elf::class64)
+        load_elf_core<uint64_t, elf::program_header64>();
+    else if (cls == elf::class32)
+        load_elf_core<uint32_t, elf::program_header32>();
+    else
+        file.fail("not an ELF core file");
+}
+
+template<typename Addr, typename ProgramHeader>
+void file_backend::load_elf_core() {
+    file_view file(_data, _size, _path);
+    auto header = file.get<elf::file_header<Addr>>(0);
+    if (header.type != elf::et_core)
+        file.fail("not an ELF core file");
+    auto segments = program_headers<Addr, ProgramHeader>(file, header);
+
+    // NT_FILE: count, page size, `count` (start, end, page offset) triples, then `count` names
+    std::unordered_map<std::string, size_t> index;
+    for (auto &s : segments) {
+        if (s.type != elf::pt_note)
+            continue;
+        for (uint64_t offset = s.offset; offset + sizeof(elf::note_header) <= s.offset + s.filesz; ) {
+            auto note = file.get<elf::note_header>(offset);
+            auto desc = offset + sizeof(note) + align_up(note.namesz, 4);
+            offset = desc + align_up(note.descsz, 4);
+            if (note.type != elf::nt_file || note.descsz < 2 * sizeof(Addr))
+                continue;
+
+            auto count = (uint64_t)file.get<Addr>(desc);
+            if (count > note.descsz / (3 * sizeof(Addr)))
+                file.fail("corrupt NT_FILE note");
+            auto names = desc + 2 * sizeof(Addr) + count * 3 * sizeof(Addr);
+            auto names_end = desc + note.descsz;
+            for (uint64_t i = 0; i < count && names < names_end; i++) {
+                auto entry = desc + 2 * sizeof(Addr) + i * 3 * sizeof(Addr);
+                auto begin = (uintptr_t)file.get<Addr>(entry);
+                auto end = (uintptr_t)file.get<Addr>(entry + sizeof(Addr));
+                auto chars = file.at(names, names_end - names);
+                std::string path(chars, strnlen(chars, (size_t)(names_end - names)));
+                names += path.size() + 1;
+
+                if (auto it = index.find(path); it != index.end()) {
+                    auto &m = _modules[it->second];
+                    m.begin = (std::min)(m.begin, begin);
+                    m.end = (std::max)(m.end, end);
+                } else {
+                    index.emplace(path, _modules.size());
+                    _modules.push_back({ file_name(path), begin, end });
+                }
+            }
+        }
+    }
+
+    for (auto &s : segments) {
+        if (s.type != elf::pt_load || s.memsz == 0)
+            continue;
+        auto begin = (uintptr_t)s.vaddr;
+        auto end = (uintptr_t)(s.vaddr + s.memsz);
+        DWORD type = MEM_PRIVATE;
+        for (auto &m : _modules) {
+            if (m.begin <= begin && end <= m.end)
+                type = MEM_IMAGE;
+        }
+
+        // the kernel leaves out segments it does not dump (see coredump_filter), and the file may be truncated
+        auto present = s.offset < _size ? (std::min)({ s.filesz, s.memsz, (uint64_t)_size - s.offset }) : 0;
+        if (present != 0)
+            add(committed(begin, begin + (uintptr_t)present, protection(s), type), s.offset, present);
+        if (present < s.memsz) {
+            region_info missing = { begin + (uintptr_t)present, end, protection(s), PAGE_NOACCESS, MEM_RESERVE, type };
+            add(missing, 0, 0);
+        }
+    }
+
+    finish();
+}
+
+void file_backend::load_raw(const std::filesystem::path &table) {
+    std::ifstream in(table);
+    if (!in)
+        throw std::runtime_error("cannot open region table " + table.string());
+
+    std::unordered_map<std::string, size_t> index;
+    std::string line;
+    for (size_t number = 1; std::getline(in, line); number++) {
+        if (line.empty() || line[0] == '#' || line.find_first_not_of(" \t\r") == std::string::npos)
+            continue;
+        region_info region;
+        uint64_t offset;
+        std::string path;
+        if (!parse_table_line(line, region, offset, path))
+            throw std::runtime_error("bad region at " + table.string() + ":" + std::to_string(number));
+        auto size = (uint64_t)(region.end - region.begin);
+        if (offset > _size || size > _size - offset)
+            throw std::runtime_error("region outside of the dump at " + table.string() + ":" + std::to_string(number));
+        add(region, offset, size);
+
+        if (region.type != MEM_IMAGE)
+            continue;
+        if (auto it = index.find(path); it != index.end()) {
+            auto &m = _modules[it->second];
+            m.begin = (std::min)(m.begin, region.begin);
+            m.end = (std::max)(m.end, region.end);
+        } else {
+            index.emplace(path, _modules.size());
+            _modules.push_back({ file_name(path), region.begin, region.end });
+        }
+    }
+
+    finish();
+}
+
+void file_backend::load_image(uintptr_t base) {
+    file_view file(_data, _size, _path);
+    auto cls = elf_class(file, _size);
+    if (cls == elf::class64)
+        load_elf_image<uint64_t, elf::program_header64>(base);
+    else if (cls == elf::class32)
+        load_elf_image<uint32_t, elf::program_header32>(base);
+    else
+        load_pe_image(base);
+}
+
+template<typename Addr, typename ProgramHeader>
+void file_backend::load_elf_image(uintptr_t base) {
+    file_view file(_data, _size, _path);
+    auto header = file.get<elf::file_header<Addr>>(0);
+    if (header.type != elf::et_exec && header.type != elf::et_dyn)
+        file.fail("not an ELF executable or shared object");
+
+    auto segments = program_headers<Addr, ProgramHeader>(file, header);
+    uint64_t lowest = UINT64_MAX;
+    uint64_t highest = 0;
+    for (auto &s : segments) {
+        if (s.type != elf::pt_load || s.memsz == 0)
+            continue;
+        lowest = (std::min)(lowest, s.vaddr & ~(uint64_t)(page - 1));
+        highest = (std::max)(highest, align_up(s.vaddr + s.memsz, page));
+    }
+    if (lowest == UINT64_MAX)
+        file.fail("ELF image has nothing to load");
+    if (base == 0)
+        base = lowest != 0 ? (uintptr_t)lowest : default_elf_base;
+    auto bias = (uint64_t)base - lowest;
+
+    // whole pages of each segment, as the loader maps them (headers included, they are in the first one)
+    for (auto &s : segments) {
+        if (s.type != elf::pt_load || s.memsz == 0)
+            continue;
+        auto head = s.vaddr % page;
+        if (s.offset < head)
+            file.fail("misaligned ELF segment");
+        auto begin = (uintptr_t)(s.vaddr - head + bias);
+        auto end = (uintptr_t)(align_up(s.vaddr + s.memsz, page) + bias);
+        auto offset = s.offset - head;
+        auto present = offset < _size ? (std::min)(s.filesz + head, (uint64_t)_size - offset) : 0;
+        add(committed(begin, end, protection(s), MEM_IMAGE), offset, present);
+    }
+
+    _modules.push_back({ file_name(_path.string()), base, (uintptr_t)(highest + bias) });
+    finish();
+}
+
+void file_backend::load_pe_image(uintptr_t base) {
+    file_view file(_data, _size, _path);
+    if (_size < sizeof(IMAGE_DOS_HEADER))
+        file.fail("not a PE or ELF image");
+    auto dos = file.get<IMAGE_DOS_HEADER>(0);
+    if (dos.e_magic != IMAGE_DOS_SIGNATURE)
+        file.fail("not a PE or ELF image");
+    auto nt = (uint64_t)(uint32_t)dos.e_lfanew;
+    if (file.get<DWORD>(nt) != IMAGE_NT_SIGNATURE)
+        file.fail("not a PE image");
+
+    auto file_header = file.get<IMAGE_FILE_HEADER>(nt + sizeof(DWORD));
+    auto optional = nt + sizeof(DWORD) + sizeof(IMAGE_FILE_HEADER);
+    uint64_t image_base;
+    DWORD image_size, headers_size, alignment;
+    if (file.get<WORD>(optional) == IMAGE_NT_OPTIONAL_HDR64_MAGIC) {
+        auto oh = file.get<IMAGE_OPTIONAL_HEADER64>(optional);
+        image_base = oh.ImageBase;
+        image_size = oh.SizeOfImage;
+        headers_size = oh.SizeOfHeaders;
+        alignment = oh.SectionAlignment;
+    } else if (file.get<WORD>(optional) == IMAGE_NT_OPTIONAL_HDR32_MAGIC) {
+        auto oh = file.get<IMAGE_OPTIONAL_HEADER32>(optional);
+        image_base = oh.ImageBase;
+        image_size = oh.SizeOfImage;
+        headers_size = oh.SizeOfHeaders;
+        alignment = oh.SectionAlignment;
+    } else {
+        file.fail("unknown PE optional header");
+    }
+    if (base == 0)
+        base = (uintptr_t)image_base;
+
+    auto headers = (std::min)((uint64_t)headers_size, (uint64_t)_size);
+    add(committed(base, base + (uintptr_t)align_up(headers_size, page), PAGE_READONLY, MEM_IMAGE), 0, headers);
+
+    auto sections = optional + file_header.SizeOfOptionalHeader;
+    for (WORD i = 0; i < file_header.NumberOfSections; i++) {
+        auto sh = file.get<IMAGE_SECTION_HEADER>(sections + i * sizeof(IMAGE_SECTION_HEADER));
+        auto size = sh.Misc.VirtualSize != 0 ? sh.Misc.VirtualSize : sh.SizeOfRawData;
+        if (size == 0)
+            continue;
+        auto length = align_up(size, (std::max)(alignment, (DWORD)page));
+        auto present = (std::min)((uint64_t)sh.SizeOfRawData, length);
+        if (sh.PointerToRawData >= _size)
+            present = 0;
+        else
+            present = (std::min)(present, (uint64_t)(_size - sh.PointerToRawData));
+        auto protect = protection((sh.Characteristics & IMAGE_SCN_MEM_READ) != 0, (sh.Characteristics & IMAGE_SCN_MEM_WRITE) != 0,
+            (sh.Characteristics & IMAGE_SCN_MEM_EXECUTE) != 0);
+        add(committed(base + sh.VirtualAddress, base + sh.VirtualAddress + (uintptr_t)length, protect, MEM_IMAGE), sh.PointerToRawData, present);
+    }
+
+    _modules.push_back({ file_name(_path.string()), base, base + (uintptr_t)align_up(image_size, page) });
+    finish();
+}
+
+void file_backend::add(const region_info &region, uint64_t offset, uint64_t size) {
+    if (region.begin >= region.end)
+        return;
+    // zero fill gets a region of its own, so the rest can be viewed in place
+    auto length = (uint64_t)(region.end - region.begin);
+    if (size == 0 || size >= length) {
+        _mappings.push_back({ region, offset, (std::min)(size, length) });
+        return;
+    }
+    auto head = region;
+    head.end = region.begin + (uintptr_t)size;
+    auto tail = region;
+    tail.begin = head.end;
+    _mappings.push_back({ head, offset, size });
+    _mappings.push_back({ tail, 0, 0 });
+}
+
+void file_backend::finish() {
+    std::stable_sort(_mappings.begin(), _mappings.end(), [](const mapping &a, const mapping &b) {
+        return a.region.begin < b.region.begin;
+    });
+    // overlapping regions (only in malformed files) are clipped, the earlier one wins
+    std::vector<mapping> clipped;
+    for (auto m : _mappings) {
+        if (!clipped.empty() && m.region.begin < clipped.back().region.end) {
+            auto skip = (uint64_t)(clipped.back().region.end - m.region.begin);
+            if (m.region.end <= clipped.back().region.end)
+                continue;
+            m.region.begin = clipped.back().region.end;
+            m.offset += skip;
+            m.size = m.size > skip ? m.size - skip : 0;
+        }
+        clipped.push_back(m);
+    }
+    _mappings = std::move(clipped);
+}
+
+const file_backend::mapping* file_backend::find(uintptr_t address) const {
+    auto it = std::upper_bound(_mappings.begin(), _mappings.end(), address, [](uintptr_t address, const mapping &m) {
+        return address < m.region.end;
+    });
+    if (it == _mappings.end() || address < it->region.begin)
+        return nullptr;
+    return &*it;
+}
+
+uintptr_t file_backend::min_address() const {
+    return _mappings.empty() ? 0 : _mappings.front().region.begin;
+}
+
+uintptr_t file_backend::max_address() const {
+    return _mappings.empty() ? 0 : _mappings.back().region.end;
+}
+
+size_t file_backend::page_size() const {
+    return page;
+}
+
+std::error_code file_backend::read(HANDLE process, uintptr_t address, void *buffer, size_t size) {
+    auto out = (char*)buffer;
+    while (size != 0) {
+        auto m = find(address);
+        if (m == nullptr || !readable(m->region))
+            return std::make_error_code(std::errc::bad_address);
+        auto n = (std::min)(size, (size_t)(m->region.end - address));
+        auto offset = (uint64_t)(address - m->region.begin);
+        auto present = offset < m->size ? (std::min)((size_t)(m->size - offset), n) : 0;
+        std::memcpy(out, _data + m->offset + offset, present);
+        std::memset(out + present, 0, n - present);
+        out += n;
+        address += n;
+        size -= n;
+    }
+    return {};
+}
+
+std::error_code file_backend::write(HANDLE process, uintptr_t address, const void *buffer, size_t size) {
+    return std::make_error_code(std::errc::read_only_file_system);
+}
+
+std::error_code file_backend::query(HANDLE process, uintptr_t address, region_info &info) {
+    auto it = std::upper_bound(_mappings.begin(), _mappings.end(), address, [](uintptr_t address, const mapping &m) {
+        return address < m.region.end;
+    });
+    if (it != _mappings.end() && it->region.begin <= address) {
+        info = it->region;
+        return {};
+    }
+    if (address >= max_address())
+        return std::make_error_code(std::errc::invalid_argument);
+    // free gap up to the next region
+    info.begin = it == _mappings.begin() ? min_address() : std::prev(it)->region.end;
+    info.end = it->region.begin;
+    info.allocation_protect = 0;
+    info.protect = PAGE_NOACCESS;
+    info.state = MEM_FREE;
+    info.type = 0;
+    return {};
+}
+
+std::error_code file_backend::protect(HANDLE process, uintptr_t address, size_t size, DWORD new_prot, DWORD &old_prot) {
+    auto m = find(address);
+    if (m == nullptr)
+        return std::make_error_code(std::errc::bad_address);
+    old_prot = m->region.protect;
+    return new_prot == old_prot ? std::error_code() : std::make_error_code(std::errc::read_only_file_system);
+}
+
+const void* file_backend::view(HANDLE process, uintptr_t address, size_t size) {
+    auto m = find(address);
+    if (m == nullptr || !readable(m->region) || size > m->region.end - address)
+        return nullptr;
+    auto offset = (uint64_t)(address - m->region.begin);
+    // zero fill is not backed by the file
+    if (offset + size > m->size)
+        return nullptr;
+    return _data + m->offset + offset;
+}
+
+std::vector<region_info> file_backend::regions(HANDLE process, uintptr_t begin, uintptr_t end) {
+    std::vector<region_info> result;
+    for (auto &m : _mappings) {
+        if (m.region.end <= begin || m.region.begin >= end)
+            continue;
+        auto info = m.region;
+        info.begin = (std::max)(info.begin, begin);
+        info.end = (std::min)(info.end, end);
+        result.push_back(info);
+    }
+    return result;
+}
+
+std::vector<module_info> file_backend::modules(HANDLE process) {
+    return _modules;
+}
+
+std::vector<process_info> file_backend::processes() {
+    return {};
+}
+
+HANDLE file_backend::open(DWORD pid) {
+    throw std::system_error(std::make_error_code(std::errc::operation_not_supported), "file backend");
+}
+
+void file_backend::close(HANDLE process) {
+}
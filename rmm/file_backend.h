@@ -0,0 +1,96 @@
+#pragma once
+
+#include "backend.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+namespace rmm {
+
+    // Read-only backend serving a file mapped into memory instead of a live process:
+    // an ELF core dump, a raw dump of regions described by a sidecar table, or a PE/ELF image laid out as loaded.
+    // Reads copy straight from the mapping and scans run over it in place (see backend::view); writes fail.
+    // Attach it to a pseudo handle to use it with memory, pointer and module:
+    //     auto dump = file_backend::attach(file_backend::core("app.core"));
+    //     auto matches = memory(dump).find(...);
+    class file_backend : public backend {
+    public:
+        // Region of the address space and where its bytes are in the file.
+        // The first `size` bytes of the region come from `offset`, the rest read as zero.
+        struct mapping {
+            region_info region;
+            uint64_t offset;
+            uint64_t size;
+        };
+
+        // ELF core file (kernel core dump, gcore): PT_LOAD segments, modules from the NT_FILE note.
+        // Parts of segments left out of the dump are inaccessible.
+        static std::shared_ptr<file_backend> core(const std::filesystem::path &path);
+        // Raw dump of regions listed in `table`, one per line in the form of /proc/<pid>/maps:
+        //     begin-end perms offset [path]
+        // with hexadecimal addresses and `offset` the position of the region's bytes in the dump.
+        // Lines starting with '#' are ignored, regions with a path make up modules.
+        static std::shared_ptr<file_backend> raw(const std::filesystem::path &path, const std::filesystem::path &table);
+        // PE or ELF (executable or shared object) image laid out as the loader would (by section or segment), at `base`.
+        // 0 is the preferred base: ImageBase, or the load address of an ELF image (0x400000 if position independent).
+        // module::sections() lists the PE sections, or the PT_LOAD segments of an ELF image (as for core dumps).
+        static std::shared_ptr<file_backend> image(const std::filesystem::path &path, uintptr_t base = 0);
+
+        // Attaches `impl` to a new pseudo handle (see backend::attach), backend::detach releases it.
+        static HANDLE attach(std::shared_ptr<file_backend> impl);
+
+        ~file_backend();
+
+        file_backend(const file_backend&) = delete;
+        file_backend& operator=(const file_backend&) = delete;
+
+        inline const std::filesystem::path& path() const { return _path; }
+        // Regions in ascending order of address.
+        inline const std::vector<mapping>& mappings() const { return _mappings; }
+
+        uintptr_t min_address() const override;
+        uintptr_t max_address() const override;
+        size_t page_size() const override;
+
+        std::error_code read(HANDLE process, uintptr_t address, void *buffer, size_t size) override;
+        std::error_code write(HANDLE process, uintptr_t address, const void *buffer, size_t size) override;
+        std::error_code query(HANDLE process, uintptr_t address, region_info &info) override;
+        std::error_code protect(HANDLE process, uintptr_t address, size_t size, DWORD new_prot, DWORD &old_prot) override;
+        const void* view(HANDLE process, uintptr_t address, size_t size) override;
+        std::vector<region_info> regions(HANDLE process, uintptr_t begin, uintptr_t end) override;
+
+        std::vector<module_info> modules(HANDLE process) override;
+        std::vector<process_info> processes() override;
+        HANDLE open(DWORD pid) override;
+        void close(HANDLE process) override;
+
+    private:
+        explicit file_backend(const std::filesystem::path &path);
+
+        void load_core();
+        void load_raw(const std::filesystem::path &table);
+        void load_image(uintptr_t base);
+        template<typename Addr, typename ProgramHeader>
+        void load_elf_core();
+        template<typename Addr, typename ProgramHeader>
+        void load_elf_image(uintptr_t base);
+        void load_pe_image(uintptr_t base);
+
+        void add(const region_info &region, uint64_t offset, uint64_t size);
+        void finish();
+        const mapping* find(uintptr_t address) const;
+
+        std::filesystem::path _path;
+        const char *_data = nullptr;
+        size_t _size = 0;
+#ifdef _WIN32
+        HANDLE _file = nullptr;
+        HANDLE _file_mapping = nullptr;
+#endif
+        std::vector<mapping> _mappings;
+        std::vector<module_info> _modules;
+    };
+
+}
@@ -0,0 +1,536 @@
+#ifdef __linux__
+
+#include "linux_backend.h"
+#include "statistics.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <filesystem>
+
+using namespace rmm;
+
+namespace {
+
+    inline std::error_code error(int code) {
+        return std::error_code(code, std::system_category());
+    }
+
+    std::string proc_path(pid_t pid, const char *entry) {
+        return "/proc/" + std::to_string(pid) + "/" + entry;
+    }
+
+    std::error_code read_file(const std::string &path, std::string &content) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            return error(errno);
+        content.clear();
+        char buffer[16384];
+        while (true) {
+            auto n = ::read(fd, buffer, sizeof(buffer));
+            if (n < 0) {
+                if (errno == EINTR)
+                    continue;
+                auto ec = error(errno);
+                ::close(fd);
+                return ec;
+            }
+            if (n == 0)
+                break;
+            content.append(buffer, n);
+        }
+        ::close(fd);
+        return {};
+    }
+
+    DWORD protection_from_perms(const char *perms) {
+        bool r = perms[0] == 'r';
+        bool w = perms[1] == 'w';
+        bool x = perms[2] == 'x';
+        if (x) {
+            if (w)
+                return PAGE_EXECUTE_READWRITE;
+            return r ? PAGE_EXECUTE_READ : PAGE_EXECUTE;
+        }
+        if (w)
+            return PAGE_READWRITE;
+        return r ? PAGE_READONLY : PAGE_NOACCESS;
+    }
+
+    int prot_from_protection(DWORD protection) {
+        switch (protection & 0xFF) {
+        case PAGE_READONLY:
+            return PROT_READ;
+        case PAGE_READWRITE:
+        case PAGE_WRITECOPY:
+            return PROT_READ | PROT_WRITE;
+        case PAGE_EXECUTE:
+            return PROT_EXEC;
+        case PAGE_EXECUTE_READ:
+            return PROT_READ | PROT_EXEC;
+        case PAGE_EXECUTE_READWRITE:
+        case PAGE_EXECUTE_WRITECOPY:
+            return PROT_READ | PROT_WRITE | PROT_EXEC;
+        default:
+            return PROT_NONE;
+        }
+    }
+
+    std::error_code parse_maps(pid_t pid, std::vector<linux_backend::map_entry> &entries) {
+        std::string content;
+        statistics::add(statistics::query_calls);
+        if (auto ec = read_file(proc_path(pid, "maps"), content))
+            return ec;
+
+        entries.clear();
+        const char *p = content.c_str();
+        while (*p != '\0') {
+            // begin-end perms offset dev inode path
+            char *next;
+            linux_backend::map_entry entry;
+            entry.region.begin = std::strtoull(p, &next, 16);
+            entry.region.end = std::strtoull(next + 1, &next, 16);
+            const char *perms = next + 1;
+            entry.offset = std::strtoull(perms + 5, &next, 16);
+            std::strtoul(next + 1, &next, 16); // dev major
+            std::strtoul(next + 1, &next, 16); // dev minor
+            std::strtoull(next, &next, 10); // inode
+            while (*next == ' ')
+                ++next;
+            auto eol = next;
+            while (*eol != '\n' && *eol != '\0')
+                ++eol;
+            entry.path.assign(next, eol);
+
+            entry.region.protect = protection_from_perms(perms);
+            // [vvar] is mapped readable but cannot be accessed through process_vm_readv or /proc/<pid>/mem.
+            if (entry.path.compare(0, 5, "[vvar") == 0 || entry.path == "[vsyscall]")
+                entry.region.protect = PAGE_NOACCESS;
+            entry.region.allocation_protect = entry.region.protect;
+            entry.region.state = MEM_COMMIT;
+            // shared anonymous memory may be named too ("[anon_shmem:<name>]"), sharing is told by the perms alone
+            if (perms[3] == 's')
+                entry.region.type = MEM_MAPPED;
+            else if (entry.path.empty() || entry.path[0] == '[')
+                entry.region.type = MEM_PRIVATE;
+            else
+                entry.region.type = MEM_IMAGE;
+
+            entries.push_back(std::move(entry));
+            p = *eol == '\n' ? eol + 1 : eol;
+        }
+        return {};
+    }
+
+    // /proc/<pid>/pagemap entry
+    const uint64_t pagemap_soft_dirty = 1ull << 55;
+    const uint64_t pagemap_swapped = 1ull << 62;
+    const uint64_t pagemap_present = 1ull << 63;
+
+    // Touched pages of a new mapping are soft-dirty, unless the kernel lacks CONFIG_MEM_SOFT_DIRTY:
+    // clear_refs still accepts "4" then, but no page ever reads as dirty.
+    bool soft_dirty_supported() {
+        static const bool supported = [] {
+            auto page = (size_t)sysconf(_SC_PAGESIZE);
+            auto p = (volatile char*)mmap(nullptr, page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (p == MAP_FAILED)
+                return false;
+            p[0] = 1;
+            uint64_t entry = 0;
+            int fd = ::open("/proc/self/pagemap", O_RDONLY | O_CLOEXEC);
+            if (fd >= 0) {
+                if (pread(fd, &entry, sizeof(entry), (off_t)((uintptr_t)p / page * sizeof(entry))) != sizeof(entry))
+                    entry = 0;
+                ::close(fd);
+            }
+            munmap((void*)p, page);
+            return (entry & pagemap_soft_dirty) != 0;
+        }();
+        return supported;
+    }
+
+    std::wstring file_name(std::string path) {
+        const std::string deleted = " (deleted)";
+        if (path.size() > deleted.size() && path.compare(path.size() - deleted.size(), deleted.size(), deleted) == 0)
+            path.resize(path.size() - deleted.size());
+        return std::filesystem::path(path).filename().wstring();
+    }
+
+}
+
+linux_backend::linux_backend()
+    : _page_size((size_t)sysconf(_SC_PAGESIZE))
+{}
+
+linux_backend::~linux_backend() {
+    for (auto &[pid, fd] : _mem_fds)
+        ::close(fd);
+}
+
+uintptr_t linux_backend::min_address() const {
+    return 0x10000;
+}
+
+uintptr_t linux_backend::max_address() const {
+#if UINTPTR_MAX == UINT64_MAX
+    return 0x00007FFFFFFFFFFF;
+#else
+    return 0xBFFFFFFF;
+#endif
+}
+
+size_t linux_backend::page_size() const {
+    return _page_size;
+}
+
+pid_t linux_backend::pid_of(HANDLE process) {
+    auto id = (intptr_t)process;
+    if (id == -1)
+        return getpid();
+    return (pid_t)id;
+}
+
+int linux_backend::mem_fd(pid_t pid) {
+    std::lock_guard lock(_mem_fds_mutex);
+    if (auto it = _mem_fds.find(pid); it != _mem_fds.end())
+        return it->second;
+
+    auto path = proc_path(pid, "mem");
+    int fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+    if (fd < 0)
+        fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return -1;
+    _mem_fds.emplace(pid, fd);
+    return fd;
+}
+
+std::error_code linux_backend::read(HANDLE process, uintptr_t address, void *buffer, size_t size) {
+    if (size == 0)
+        return {};
+
+    auto pid = pid_of(process);
+    size_t done = 0;
+    auto fail = [](int code) {
+        statistics::add(statistics::failed_reads);
+        return error(code);
+    };
+
+    iovec local{ buffer, size };
+    iovec remote{ (void*)address, size };
+    auto n = process_vm_readv(pid, &local, 1, &remote, 1, 0);
+    statistics::add(statistics::read_calls);
+    if (n == (ssize_t)size) {
+        statistics::add(statistics::bytes_read, size);
+        return {};
+    }
+    int code = n < 0 ? errno : EFAULT;
+    if (n > 0)
+        done = n;
+    if (code == ESRCH)
+        return fail(code);
+
+    int fd = mem_fd(pid);
+    if (fd < 0)
+        return fail(code);
+    while (done < size) {
+        auto m = pread64(fd, (char*)buffer + done, size - done, (off64_t)(address + done));
+        statistics::add(statistics::read_calls);
+        if (m < 0 && errno == EINTR)
+            continue;
+        if (m <= 0)
+            return fail(m < 0 ? errno : EIO);
+        done += m;
+    }
+    statistics::add(statistics::bytes_read, size);
+    return {};
+}
+
+std::error_code linux_backend::write(HANDLE process, uintptr_t address, const void *buffer, size_t size) {
+    if (size == 0)
+        return {};
+
+    auto pid = pid_of(process);
+    size_t done = 0;
+    auto fail = [](int code) {
+        statistics::add(statistics::failed_writes);
+        return error(code);
+    };
+
+    iovec local{ const_cast<void*>(buffer), size };
+    iovec remote{ (void*)address, size };
+    auto n = process_vm_writev(pid, &local, 1, &remote, 1, 0);
+    statistics::add(statistics::write_calls);
+    if (n == (ssize_t)size) {
+        statistics::add(statistics::bytes_written, size);
+        return {};
+    }
+    int code = n < 0 ? errno : EFAULT;
+    if (n > 0)
+        done = n;
+    if (code == ESRCH)
+        return fail(code);
+
+    int fd = mem_fd(pid);
+    if (fd < 0)
+        return fail(code);
+    while (done < size) {
+        auto m = pwrite64(fd, (const char*)buffer + done, size - done, (off64_t)(address + done));
+        statistics::add(statistics::write_calls);
+        if (m < 0 && errno == EINTR)
+            continue;
+        if (m <= 0)
+            return fail(m < 0 ? errno : EIO);
+        done += m;
+    }
+    statistics::add(statistics::bytes_written, size);
+    return {};
+}
+
+template<typename Transfer, typename Single>
+void linux_backend::transfer_vector(HANDLE process, io_vector *vectors, size_t count, bool write, Transfer &&transfer, Single &&single) {
+    auto pid = pid_of(process);
+    iovec local[IOV_MAX];
+    iovec remote[IOV_MAX];
+
+    // Up to IOV_MAX elements per call. The transfer stops at the first element which cannot be accessed:
+    // that one is retried on its own (falling back to /proc/<pid>/mem), the rest of the batch continues after it.
+    for (size_t i = 0; i < count; ) {
+        size_t n = 0;
+        for (; n < IOV_MAX && i + n < count; n++) {
+            local[n] = { vectors[i + n].buffer, vectors[i + n].size };
+            remote[n] = { (void*)vectors[i + n].address, vectors[i + n].size };
+        }
+
+        auto transferred = transfer(pid, local, (unsigned long)n, remote, (unsigned long)n, 0);
+        statistics::add(write ? statistics::write_calls : statistics::read_calls);
+        if (transferred < 0) {
+            if (errno == ESRCH) {
+                statistics::add(write ? statistics::failed_writes : statistics::failed_reads, count - i);
+                for (; i < count; i++)
+                    vectors[i].status = error(ESRCH);
+                return;
+            }
+            transferred = 0;
+        }
+
+        size_t done = (size_t)transferred;
+        size_t completed = 0;
+        for (; n != 0 && done >= vectors[i].size; n--, i++) {
+            done -= vectors[i].size;
+            completed += vectors[i].size;
+            vectors[i].status = {};
+        }
+        statistics::add(write ? statistics::bytes_written : statistics::bytes_read, completed);
+        if (n != 0) {
+            vectors[i].status = single(vectors[i]);
+            i++;
+        }
+    }
+}
+
+void linux_backend::read_vector(HANDLE process, io_vector *vectors, size_t count) {
+    transfer_vector(process, vectors, count, false, process_vm_readv, [&](io_vector &v) {
+        return read(process, v.address, v.buffer, v.size);
+    });
+}
+
+void linux_backend::write_vector(HANDLE process, io_vector *vectors, size_t count) {
+    transfer_vector(process, vectors, count, true, process_vm_writev, [&](io_vector &v) {
+        return write(process, v.address, v.buffer, v.size);
+    });
+}
+
+std::error_code linux_backend::query(HANDLE process, uintptr_t address, region_info &info) {
+    if (address > max_address())
+        return error(EINVAL);
+
+    std::vector<map_entry> entries;
+    if (auto ec = parse_maps(pid_of(process), entries))
+        return ec;
+
+    auto it = std::upper_bound(entries.begin(), entries.end(), address, [](uintptr_t address, const map_entry &entry) {
+        return address < entry.region.end;
+    });
+    if (it != entries.end() && it->region.begin <= address) {
+        info = it->region;
+        return {};
+    }
+
+    info.begin = it == entries.begin() ? 0 : std::prev(it)->region.end;
+    info.end = it == entries.end() ? max_address() + 1 : it->region.begin;
+    info.allocation_protect = 0;
+    info.protect = PAGE_NOACCESS;
+    info.state = MEM_FREE;
+    info.type = 0;
+    return {};
+}
+
+std::error_code linux_backend::protect(HANDLE process, uintptr_t address, size_t size, DWORD new_prot, DWORD &old_prot) {
+    region_info ri;
+    if (auto ec = query(process, address, ri))
+        return ec;
+    old_prot = ri.protect;
+
+    if (pid_of(process) != getpid())
+        return {};
+
+    auto begin = address & ~(uintptr_t)(_page_size - 1);
+    auto end = (address + size + _page_size - 1) & ~(uintptr_t)(_page_size - 1);
+    statistics::add(statistics::protect_calls);
+    if (mprotect((void*)begin, end - begin, prot_from_protection(new_prot)) != 0)
+        return error(errno);
+    return {};
+}
+
+std::vector<region_info> linux_backend::regions(HANDLE process, uintptr_t begin, uintptr_t end) {
+    std::vector<region_info> regions;
+    for (auto &entry : maps(process)) {
+        auto ri = entry.region;
+        if (ri.end <= begin || ri.begin >= end)
+            continue;
+        if (ri.begin < begin)
+            ri.begin = begin;
+        if (ri.end > end)
+            ri.end = end;
+        regions.push_back(ri);
+    }
+    return regions;
+}
+
+std::error_code linux_backend::clear_written(HANDLE process) {
+    if (!soft_dirty_supported())
+        return std::make_error_code(std::errc::not_supported);
+
+    int fd = ::open(proc_path(pid_of(process), "clear_refs").c_str(), O_WRONLY | O_CLOEXEC);
+    if (fd < 0)
+        return error(errno);
+    // 4: clear soft-dirty bits
+    auto n = ::write(fd, "4", 1);
+    auto ec = n == 1 ? std::error_code() : error(errno);
+    ::close(fd);
+    return ec;
+}
+
+std::error_code linux_backend::written_pages(HANDLE process, uintptr_t begin, uintptr_t end, std::vector<uint64_t> &bitmap) {
+    if (!soft_dirty_supported())
+        return std::make_error_code(std::errc::not_supported);
+    return read_pagemap(process, begin, end, pagemap_soft_dirty, bitmap);
+}
+
+std::error_code linux_backend::populated_pages(HANDLE process, uintptr_t begin, uintptr_t end, std::vector<uint64_t> &bitmap) {
+    return read_pagemap(process, begin, end, pagemap_present | pagemap_swapped, bitmap);
+}
+
+// Sets the bits of pages whose pagemap entry has any of `bits`.
+std::error_code linux_backend::read_pagemap(HANDLE process, uintptr_t begin, uintptr_t end, uint64_t bits, std::vector<uint64_t> &bitmap) {
+    auto first = begin / _page_size;
+    auto count = (size_t)((end - begin) / _page_size);
+    bitmap.assign((count + 63) / 64, 0);
+
+    int fd = ::open(proc_path(pid_of(process), "pagemap").c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return error(errno);
+    uint64_t entries[512];
+    for (size_t i = 0; i < count; ) {
+        auto n = (std::min)(count - i, (size_t)512);
+        auto size = pread(fd, entries, n * sizeof(uint64_t), (off_t)((first + i) * sizeof(uint64_t)));
+        statistics::add(statistics::query_calls);
+        if (size <= 0) {
+            auto ec = error(size < 0 ? errno : EIO);
+            ::close(fd);
+            return ec;
+        }
+        n = (size_t)size / sizeof(uint64_t);
+        for (size_t k = 0; k < n; k++, i++) {
+            if (entries[k] & bits)
+                bitmap[i / 64] |= 1ull << (i % 64);
+        }
+    }
+    ::close(fd);
+    return {};
+}
+
+std::vector<linux_backend::map_entry> linux_backend::maps(HANDLE process) const {
+    std::vector<map_entry> entries;
+    if (auto ec = parse_maps(pid_of(process), entries))
+        throw std::system_error(ec);
+    return entries;
+}
+
+std::vector<module_info> linux_backend::modules(HANDLE process) {
+    std::vector<module_info> modules;
+    std::unordered_map<std::string, size_t> index;
+
+    for (auto &entry : maps(process)) {
+        if (entry.path.empty() || entry.path[0] != '/')
+            continue;
+        if (auto it = index.find(entry.path); it != index.end()) {
+            auto &m = modules[it->second];
+            m.begin = (std::min)(m.begin, entry.region.begin);
+            m.end = (std::max)(m.end, entry.region.end);
+        } else {
+            index.emplace(entry.path, modules.size());
+            modules.push_back({ file_name(entry.path), entry.region.begin, entry.region.end });
+        }
+    }
+
+    return modules;
+}
+
+std::vector<process_info> linux_backend::processes() {
+    statistics::add(statistics::enumeration_calls);
+    auto dir = opendir("/proc");
+    if (!dir)
+        throw std::system_error(errno, std::system_category());
+
+    std::vector<process_info> processes;
+    while (auto de = readdir(dir)) {
+        char *end;
+        auto pid = std::strtoul(de->d_name, &end, 10);
+        if (*end != '\0' || end == de->d_name)
+            continue;
+
+        char exe[4096];
+        auto n = readlink(proc_path(pid, "exe").c_str(), exe, sizeof(exe) - 1);
+        if (n > 0) {
+            processes.push_back({ (DWORD)pid, file_name(std::string(exe, n)) });
+            continue;
+        }
+
+        // Not permitted to resolve the executable (or a kernel thread); the short name will do.
+        std::string comm;
+        if (read_file(proc_path(pid, "comm"), comm))
+            continue;
+        if (!comm.empty() && comm.back() == '\n')
+            comm.pop_back();
+        processes.push_back({ (DWORD)pid, std::filesystem::path(comm).wstring() });
+    }
+    closedir(dir);
+
+    return processes;
+}
+
+HANDLE linux_backend::open(DWORD pid) {
+    if (access(proc_path(pid, "maps").c_str(), R_OK) != 0)
+        throw std::system_error(errno, std::system_category());
+    return (HANDLE)(intptr_t)pid;
+}
+
+void linux_backend::close(HANDLE process) {
+    auto pid = pid_of(process);
+    std::lock_guard lock(_mem_fds_mutex);
+    if (auto it = _mem_fds.find(pid); it != _mem_fds.end()) {
+        ::close(it->second);
+        _mem_fds.erase(it);
+    }
+}
+
+#endif
@@ -0,0 +1,74 @@
+#pragma once
+
+#ifdef __linux__
+
+#include "backend.h"
+
+#include <sys/types.h>
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace rmm {
+
+    // Linux backend.
+    // A process HANDLE is its pid cast to a pointer (GetCurrentProcess() is the calling process).
+    // I/O goes through process_vm_readv/process_vm_writev and falls back to /proc/<pid>/mem,
+    // the address space layout comes from /proc/<pid>/maps.
+    // Protection of another process cannot be changed without injecting code into it;
+    // for remote processes protect() only reports the current protection.
+    // That is sufficient for writes, since /proc/<pid>/mem ignores page protection.
+    class linux_backend : public backend {
+    public:
+        struct map_entry {
+            region_info region;
+            uintptr_t offset;
+            std::string path;
+        };
+
+        linux_backend();
+        ~linux_backend();
+
+        uintptr_t min_address() const override;
+        uintptr_t max_address() const override;
+        size_t page_size() const override;
+
+        std::error_code read(HANDLE process, uintptr_t address, void *buffer, size_t size) override;
+        std::error_code write(HANDLE process, uintptr_t address, const void *buffer, size_t size) override;
+        std::error_code query(HANDLE process, uintptr_t address, region_info &info) override;
+        std::error_code protect(HANDLE process, uintptr_t address, size_t size, DWORD new_prot, DWORD &old_prot) override;
+        void read_vector(HANDLE process, io_vector *vectors, size_t count) override;
+        void write_vector(HANDLE process, io_vector *vectors, size_t count) override;
+        std::vector<region_info> regions(HANDLE process, uintptr_t begin, uintptr_t end) override;
+        // Present and swapped bits of /proc/<pid>/pagemap.
+        std::error_code populated_pages(HANDLE process, uintptr_t begin, uintptr_t end, std::vector<uint64_t> &bitmap) override;
+        // Soft-dirty bits through /proc/<pid>/clear_refs and /proc/<pid>/pagemap
+        // (not supported unless the kernel is built with CONFIG_MEM_SOFT_DIRTY).
+        std::error_code clear_written(HANDLE process) override;
+        std::error_code written_pages(HANDLE process, uintptr_t begin, uintptr_t end, std::vector<uint64_t> &bitmap) override;
+
+        std::vector<module_info> modules(HANDLE process) override;
+        std::vector<process_info> processes() override;
+        HANDLE open(DWORD pid) override;
+        void close(HANDLE process) override;
+
+        // Parsed /proc/<pid>/maps.
+        std::vector<map_entry> maps(HANDLE process) const;
+
+        static pid_t pid_of(HANDLE process);
+
+    private:
+        int mem_fd(pid_t pid);
+        std::error_code read_pagemap(HANDLE process, uintptr_t begin, uintptr_t end, uint64_t bits, std::vector<uint64_t> &bitmap);
+        template<typename Transfer, typename Single>
+        void transfer_vector(HANDLE process, io_vector *vectors, size_t count, bool write, Transfer &&transfer, Single &&single);
+
+        size_t _page_size;
+        std::mutex _mem_fds_mutex;
+        std::unordered_map<pid_t, int> _mem_fds;
+    };
+
+}
+
+#endif
@@ -0,0 +1,124 @@
+#include "match_range.h"
+#include "memory.h"
+#include "backend.h"
+
+#include <algorithm>
+#include <system_error>
+
+using namespace rmm;
+
+match_range::match_range(const memory &memory, size_t overlap, matcher matcher, bool matches_zero)
+    : _process(memory.begin().process())
+    , _stats(memory.stats_sink())
+    , _overlap(overlap)
+    , _budget(memory.scan_budget())
+    , _matcher(std::move(matcher))
+{
+    for (auto &region : matches_zero ? memory.regions() : memory.populated_regions(overlap))
+        _regions.emplace_back(region.begin(), region.end());
+    if (!_regions.empty())
+        _address = _regions.front().first;
+}
+
+match_range& match_range::take(size_t count) {
+    _left = count;
+    return *this;
+}
+
+match_range& match_range::take_while(std::function<bool(const pointer&)> predicate) {
+    _predicate = std::move(predicate);
+    return *this;
+}
+
+bool match_range::fill() {
+    if (_stopped || _left == 0)
+        return false;
+
+    while (_match == _matches.size()) {
+        if (_region == _regions.size())
+            return false;
+
+        auto end = _regions[_region].second;
+        if (_address == end) {
+            if (++_region == _regions.size())
+                return false;
+            _address = _regions[_region].first;
+            _kept = 0;
+            continue;
+        }
+
+        // same chunking as region_reader::forward, including regions viewed in place
+        if (_address == _regions[_region].first) {
+            auto data = (const char*)backend::of(_process).view(_process, _address, end - _address);
+            if (data != nullptr) {
+                statistics::scope scope(_stats.get());
+                statistics::add(statistics::chunks_read);
+                _matches.clear();
+                _match = 0;
+                _checked = false;
+                _matcher(_address, data, end - _address, _matches);
+                _address = end;
+                _kept = 0;
+                continue;
+            }
+        }
+        if (_buffer.empty()) {
+            auto page_size = backend::of(_process).page_size();
+            _buffer.resize((std::max)(_budget, _overlap + page_size));
+        }
+        auto n = _buffer.size() - _kept;
+        if (n > end - _address)
+            n = end - _address;
+        statistics::scope scope(_stats.get());
+        statistics::add(statistics::chunks_read);
+        statistics::timer timer(statistics::read_chunk, _address, _address + n);
+        if (auto ec = backend::of(_process).read(_process, _address, _buffer.data() + _kept, n))
+            throw std::system_error(ec);
+        timer.stop(n);
+
+        auto size = _kept + n;
+        _matches.clear();
+        _match = 0;
+        _checked = false;
+        _matcher(_address - _kept, _buffer.data(), size, _matches);
+
+        _address += n;
+        _kept = _overlap < size ? _overlap : size;
+        std::copy(_buffer.data() + size - _kept, _buffer.data() + size, _buffer.data());
+    }
+
+    if (_predicate && !_checked) {
+        if (!_predicate(pointer(_process, _matches[_match]))) {
+            _stopped = true;
+            return false;
+        }
+        _checked = true;
+    }
+    return true;
+}
+
+pointer match_range::current() {
+    return pointer(_process, _matches[_match]);
+}
+
+void match_range::advance() {
+    _match++;
+    _checked = false;
+    if (_left != SIZE_MAX)
+        _left--;
+}
+
+pointer match_range::next() {
+    if (!fill())
+        return pointer(_process, nullptr);
+    auto match = current();
+    advance();
+    return match;
+}
+
+std::vector<pointer> match_range::to_vector() {
+    std::vector<pointer> matches;
+    for (auto match : *this)
+        matches.push_back(match);
+    return matches;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "typedefs.h"
+#include "platform.h"
+#include "pointer.h"
+#include "statistics.h"
+
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace rmm {
+
+    class memory;
+
+    // Matches within memory, found lazily: regions are read one chunk at a time as the matches are consumed,
+    // so scanning stops as soon as the consumer does (or `take`/`take_while` end the range).
+    // Matches are yielded in ascending order of address; a read failure throws std::system_error.
+    // Single pass: iterating consumes the range.
+    class match_range {
+    public:
+        // Appends the address of every match lying entirely within the chunk.
+        typedef std::function<void(uintptr_t address, const char *chunk, size_t size, std::vector<uintptr_t> &matches)> matcher;
+
+        class iterator {
+        public:
+            typedef std::input_iterator_tag iterator_category;
+            typedef ::rmm::pointer value_type;
+            typedef std::ptrdiff_t difference_type;
+            typedef const ::rmm::pointer* pointer;
+            typedef ::rmm::pointer reference;
+
+            inline ::rmm::pointer operator*() const { return _range->current(); }
+            inline iterator& operator++() { _range->advance(); return *this; }
+            inline void operator++(int) { _range->advance(); }
+            inline bool operator==(const iterator &rhs) const { return done() == rhs.done(); }
+            inline bool operator!=(const iterator &rhs) const { return !(*this == rhs); }
+
+        private:
+            friend class match_range;
+            iterator(match_range *range)
+                : _range(range)
+            {}
+            inline bool done() const { return _range == nullptr || !_range->fill(); }
+
+            match_range *_range;
+        };
+
+        // `overlap` bytes of each chunk are carried over to the next one (pattern length - 1).
+        // Unless `matches_zero`, the matcher never matches zero-filled data and only memory::populated_regions are read.
+        match_range(const memory &memory, size_t overlap, matcher matcher, bool matches_zero = true);
+
+        iterator begin() { return iterator(this); }
+        iterator end() { return iterator(nullptr); }
+
+        // Ends the range after `count` more matches.
+        match_range& take(size_t count);
+        // Ends the range at the first match not satisfying `predicate`.
+        match_range& take_while(std::function<bool(const pointer&)> predicate);
+
+        // Next match, nullptr if there are no more.
+        pointer next();
+        std::vector<pointer> to_vector();
+
+    private:
+        bool fill();
+        pointer current();
+        void advance();
+
+        HANDLE _process;
+        std::shared_ptr<statistics::sink> _stats;
+        std::vector<std::pair<uintptr_t, uintptr_t>> _regions;
+        size_t _overlap;
+        size_t _budget;
+        matcher _matcher;
+
+        size_t _region = 0;
+        uintptr_t _address = 0;
+        size_t _kept = 0;
+        std::vector<char> _buffer;
+
+        std::vector<uintptr_t> _matches;
+        size_t _match = 0;
+
+        size_t _left = SIZE_MAX;
+        std::function<bool(const pointer&)> _predicate;
+        bool _checked = false; // current match satisfies the predicate
+        bool _stopped = false;
+    };
+
+}
@@ -1,23 +1,24 @@
 #include "memory.h"
 #include "module.h"
+#include "scan_kernel.h"
+#include "region_map.h"
 
 #include <vector>
 #include <algorithm>
 #include <functional>
+#include <stdexcept>
+#include <system_error>
+#include <cstring>
+#include <atomic>
+#include <iterator>
 
 using namespace rmm;
 
-const SYSTEM_INFO memory::sys_info = [] {
-    SYSTEM_INFO sys_info;
-    GetSystemInfo(&sys_info);
-    return sys_info;
-}(); 
-
 memory::memory(HANDLE process) :
     memory(
         process,
-        (uintptr_t)sys_info.lpMinimumApplicationAddress,
-        (uintptr_t)sys_info.lpMaximumApplicationAddress
+        backend::of(process).min_address(),
+        backend::of(process).max_address()
     )
 {}
 
@@ -26,135 +27,138 @@ memory::memory(HANDLE process, uintptr_t begin, uintptr_t end, bool continuous)
     , _begin(begin)
     , _end(end)
     , _continuous(continuous)
+    , _scan_budget(region_reader::default_budget)
+    , _scan_pool(nullptr)
 {}
 
-std::vector<memory> memory::regions() const {
-    MEMORY_BASIC_INFORMATION mi;
-    std::vector<memory> regions;
+void memory::collect_stats(bool enable) {
+    if (!enable)
+        _stats.reset();
+    else if (!_stats)
+        _stats = std::make_shared<statistics::sink>();
+}
 
-    auto min_ptr = _begin;
-    if(min_ptr < (uintptr_t)sys_info.lpMinimumApplicationAddress)
-        min_ptr = (uintptr_t)sys_info.lpMinimumApplicationAddress;
+statistics::snapshot memory::stats() const {
+    return _stats ? _stats->load() : statistics::snapshot();
+}
 
-    auto max_ptr = _end;
-    if(max_ptr > (uintptr_t)sys_info.lpMaximumApplicationAddress)
-        max_ptr = (uintptr_t)sys_info.lpMaximumApplicationAddress;
+void memory::reset_stats() {
+    if (_stats)
+        _stats->reset();
+}
 
-    for(uintptr_t base = min_ptr; base < max_ptr; ) {
-        if(!VirtualQueryEx(_process, (LPCVOID)base, &mi, sizeof(mi)))
-            throw std::system_error(GetLastError(), std::system_category());
+std::vector<region_info> memory::readable_regions() const {
+    statistics::scope scope(_stats.get());
+    auto &io = backend::of(_process);
+    std::vector<region_info> regions;
 
-        auto base_end = (uintptr_t)mi.BaseAddress + mi.RegionSize;
-        if(base_end > max_ptr)
-            base_end = max_ptr;
+    auto min_ptr = _begin;
+    if(min_ptr < io.min_address())
+        min_ptr = io.min_address();
 
-        if(mi.AllocationProtect != 0 &&
-           mi.Protect != 0 && mi.Protect != PAGE_NOACCESS && !(mi.Protect & PAGE_GUARD) &&
-           mi.State == MEM_COMMIT) {
-            regions.emplace_back(_process, base, base_end, true);
+    auto max_ptr = _end;
+    if(max_ptr > io.max_address())
+        max_ptr = io.max_address();
+
+    statistics::timer timer(statistics::enumerate_regions, min_ptr, max_ptr);
+    auto map = region_map::of(_process);
+    auto all = map ? map->regions(min_ptr, max_ptr) : io.regions(_process, min_ptr, max_ptr);
+    for(auto &ri : all) {
+        if(ri.allocation_protect != 0 &&
+           ri.protect != 0 && ri.protect != PAGE_NOACCESS && !(ri.protect & PAGE_GUARD) &&
+           ri.state == MEM_COMMIT) {
+            regions.push_back(ri);
         }
-
-        base = base_end;
     }
 
     return regions;
 }
 
-pointer memory::find_single_in_region(const memory &region, const char *data, size_t length, uintptr_t offset, search_direction direction) {
-    if (!region.continuous())
-        throw std::runtime_error("region is not continuous");
-
-    if (region.size() <= offset)
-        return pointer(region._process, nullptr);
-
-    std::vector<char> mem(region.size() - offset);
-    if (!ReadProcessMemory(region._process, region.begin() + offset, mem.data(), mem.size(), NULL))
-        throw std::system_error(GetLastError(), std::system_category());
-
-    std::vector<char>::iterator it;
-    if (direction != backward) {
-        it = std::search(mem.begin(), mem.end(), data, data + length);
-    } else {
-        it = std::find_end(mem.begin(), mem.end(), data, data + length);
+std::vector<memory> memory::regions() const {
+    std::vector<memory> regions;
+    for (auto &ri : readable_regions()) {
+        regions.emplace_back(_process, ri.begin, ri.end, true);
+        regions.back()._scan_budget = _scan_budget;
+        regions.back()._scan_pool = _scan_pool;
+        regions.back()._stats = _stats;
     }
-    if (it == mem.end())
-        return pointer(region._process, nullptr);
-
-    return region.begin() + offset + (it - mem.begin());
+    return regions;
 }
 
-pointer memory::find_single_in_region_by_pattern(const memory &region, const char *pattern, const char *mask, uintptr_t offset, search_direction direction) {
-    if (!region.continuous())
-        throw std::runtime_error("region is not continuous");
+std::vector<memory> memory::populated_regions(size_t overlap) const {
+    // smaller regions are cheaper to read than to look up
+    const size_t min_pages = 16;
 
-    if (region.size() <= offset)
-        return pointer(region._process, nullptr);
-
-    std::vector<char> mem(region.size() - offset);
-    if (!ReadProcessMemory(region._process, region.begin() + offset, mem.data(), mem.size(), NULL))
-        throw std::system_error(GetLastError(), std::system_category());
-
-    // fix dummy mask (if it begins with 00's)
-    while (*mask == '\x00') {
-        mask++;
-        pattern++;
-    }
-    if(*pattern == '\x00' && *mask != '\xFF')
-        return pointer(region._process, nullptr);
-    auto length = pattern_length(pattern, mask);
+    statistics::scope scope(_stats.get());
+    auto &io = backend::of(_process);
+    auto page_size = io.page_size();
+    auto page_mask = ~(uintptr_t)(page_size - 1);
+    bool supported = true;
+    std::vector<uint64_t> bitmap;
+    std::vector<memory> regions;
 
-    int shift;
-    char *p, *p_end;
-    if (direction != backward) {
-        shift = +1;
-        p = mem.data();
-        p_end = mem.data() + mem.size() - length + 1;
-    } else {
-        shift = -1;
-        p = mem.data() + mem.size() - length;
-        p_end = mem.data() - 1;
-    }
-    while (true) {
-        for (; p != p_end; p += shift)
-            if (*p == *pattern)
-                break;
-        if (p == p_end) {
-            break;
+    auto add = [&](uintptr_t begin, uintptr_t end) {
+        regions.emplace_back(_process, begin, end, true);
+        regions.back()._scan_budget = _scan_budget;
+        regions.back()._scan_pool = _scan_pool;
+        regions.back()._stats = _stats;
+    };
+
+    for (auto &ri : readable_regions()) {
+        auto begin = ri.begin & page_mask;
+        auto end = (ri.end + page_size - 1) & page_mask;
+        if (!supported || ri.type != MEM_PRIVATE || end - begin < min_pages * page_size) {
+            add(ri.begin, ri.end);
+            continue;
         }
-        if (pattern_matches(p + 1, pattern + 1, mask + 1)) {
-            return region.begin() + offset + (p - mem.data());
+        if (auto ec = io.populated_pages(_process, begin, end, bitmap)) {
+            supported = ec != std::errc::not_supported;
+            add(ri.begin, ri.end);
+            continue;
         }
-        ++p;
-    }
-
-    return pointer(region._process, nullptr);
-}
-
-std::vector<pointer> memory::find(const char *data, size_t length) const {
-    std::vector<pointer> matches;
 
-    for(auto &region : regions()) {
-        for (uintptr_t offset = 0; offset < region.size(); ) {
-            auto p = find_single_in_region(region, data, length, offset);
-            if (p == nullptr)
-                break;
-            matches.emplace_back(p);
-            offset = p - region.begin() + 1;
+        // runs of populated pages, widened by `overlap` and clipped to the region
+        auto first = regions.size();
+        auto pages = (size_t)((end - begin) / page_size);
+        for (size_t i = 0; i < pages; ) {
+            if (!(bitmap[i / 64] & (1ull << (i % 64)))) {
+                i++;
+                continue;
+            }
+            auto run = i;
+            while (i < pages && (bitmap[i / 64] & (1ull << (i % 64))))
+                i++;
+            auto run_begin = begin + run * page_size;
+            auto run_end = begin + i * page_size;
+            run_begin = run_begin - ri.begin > overlap ? run_begin - overlap : ri.begin;
+            run_end = ri.end - run_end > overlap ? run_end + overlap : ri.end;
+            if (regions.size() > first && regions.back()._end >= run_begin)
+                regions.back()._end = run_end;
+            else
+                add(run_begin, run_end);
         }
+
+        size_t kept = 0;
+        for (auto r = regions.begin() + first; r != regions.end(); ++r)
+            kept += r->size();
+        statistics::add(statistics::bytes_skipped, (ri.end - ri.begin) - kept);
     }
+    return regions;
+}
 
-    return matches;
+std::vector<memory> memory::scan_regions(size_t length, bool matches_zero) const {
+    if (matches_zero || length == 0)
+        return regions();
+    return populated_regions(length - 1);
 }
 
-pointer memory::find_single(const char *data, size_t length, uintptr_t start, search_direction direction) const {
+std::vector<memory> memory::regions_from(std::vector<memory> all_regions, uintptr_t start, search_direction direction) const {
     if (start == 0) {
         if (direction != backward)
             start = _begin;
         else
             start = _end;
     }
-    
-    auto all_regions = regions();
 
     decltype(all_regions)::iterator region;
     std::function<bool(const memory &region, uintptr_t start)> comp;
@@ -174,31 +178,246 @@ pointer memory::find_single(const char *data, size_t length, uintptr_t start, se
         comp
     );
 
-    if (region == all_regions.end() || region->begin() > start || region->end() < start)
-        return pointer(_process, nullptr);
+    // `start` may lie in a gap between regions (or before the first one),
+    // in that case the search continues from the nearest region in `direction`.
+    if (direction != backward) {
+        if (region == all_regions.end())
+            return {};
+        if (region->begin() < start)
+            region->_begin = start;
+        return std::vector<memory>(region, all_regions.end());
+    }
 
-    // all_regions returns temp vector of memory regions, so we can safely edit it.
-    if(direction != backward)
-        *region = memory(_process, start, region->end(), true);
-    else
-        *region = memory(_process, region->begin(), start, true);
-
-    while (true) {
-        auto p = find_single_in_region(*region, data, length, 0, direction);
-        if (p != nullptr)
-            return p;
-        if (direction != backward) {
-            region++;
-            if (region == all_regions.end())
-                break;
-        } else {
-            if (region == all_regions.begin())
-                break;
-            region--;
+    if (region == all_regions.end() || region->begin() >= start) {
+        if (region == all_regions.begin())
+            return {};
+        region--;
+    }
+    if (region->end() > start)
+        region->_end = start;
+    return std::vector<memory>(std::make_reverse_iterator(region + 1), all_regions.rend());
+}
+
+std::vector<memory> memory::split_regions(const std::vector<memory> &regions, size_t piece, size_t overlap, search_direction direction) {
+    std::vector<memory> pieces;
+    for (auto &region : regions) {
+        auto first = pieces.size();
+        for (auto begin = region._begin; begin < region._end; ) {
+            auto end = region._end - begin > piece ? begin + piece : region._end;
+            // matches starting in [begin, end) are whole in [begin, end + overlap)
+            auto read_end = region._end - end > overlap ? end + overlap : region._end;
+            pieces.push_back(region);
+            pieces.back()._begin = begin;
+            pieces.back()._end = read_end;
+            begin = end;
         }
+        if (direction == backward)
+            std::reverse(pieces.begin() + first, pieces.end());
     }
+    return pieces;
+}
+
+namespace {
+
+    // Searches a region (or a piece of it) on behalf of a scan, counting and timing it.
+    template<typename F>
+    auto visit_region(const memory &region, F &&search) {
+        statistics::add(statistics::regions_visited);
+        statistics::timer timer(statistics::scan_region, region.begin(), region.end());
+        auto result = search();
+        timer.stop(region.size());
+        return result;
+    }
+
+}
+
+template<typename F>
+pointer memory::find_single_with(uintptr_t start, search_direction direction, size_t length, bool matches_zero, F &&search) const {
+    statistics::scope scope(_stats.get());
+    auto ordered = regions_from(scan_regions(length, matches_zero), start, direction);
+
+    if (_scan_pool == nullptr) {
+        region_reader reader(_process, _scan_budget);
+        for (auto &region : ordered) {
+            auto p = visit_region(region, [&] { return search(reader, region); });
+            if (p != nullptr)
+                return p;
+        }
+        return pointer(_process, nullptr);
+    }
+
+    // Pieces are ordered in `direction`, so the match of the lowest piece wins
+    // and pieces after a piece with a match need not be scanned at all.
+    auto pieces = split_regions(ordered, _scan_budget, length != 0 ? length - 1 : 0, direction);
+    std::vector<uintptr_t> found(pieces.size(), 0);
+    std::atomic<size_t> best{ pieces.size() };
+    std::vector<region_reader> readers(_scan_pool->concurrency(), region_reader(_process, _scan_budget));
+
+    _scan_pool->parallel_for(pieces.size(), [&](size_t i, size_t worker) {
+        if (i > best.load(std::memory_order_relaxed))
+            return;
+        statistics::scope scope(_stats.get());
+        auto p = visit_region(pieces[i], [&] { return search(readers[worker], pieces[i]); });
+        if (p == nullptr)
+            return;
+        found[i] = p;
+        auto b = best.load();
+        while (i < b && !best.compare_exchange_weak(b, i))
+            ;
+    });
+
+    if (best == pieces.size())
+        return pointer(_process, nullptr);
+    return pointer(_process, found[best]);
+}
+
+template<typename F>
+std::vector<pointer> memory::find_all_with(size_t length, bool matches_zero, F &&search) const {
+    statistics::scope scope(_stats.get());
+    std::vector<pointer> matches;
+    auto all_regions = scan_regions(length, matches_zero);
+
+    if (_scan_pool == nullptr) {
+        region_reader reader(_process, _scan_budget);
+        for (auto &region : all_regions)
+            visit_region(region, [&] { search(reader, region, matches); return true; });
+        return matches;
+    }
+
+    auto pieces = split_regions(all_regions, _scan_budget * 4, length != 0 ? length - 1 : 0, forward);
+    std::vector<std::vector<pointer>> found(pieces.size());
+    std::vector<region_reader> readers(_scan_pool->concurrency(), region_reader(_process, _scan_budget));
+
+    _scan_pool->parallel_for(pieces.size(), [&](size_t i, size_t worker) {
+        statistics::scope scope(_stats.get());
+        visit_region(pieces[i], [&] { search(readers[worker], pieces[i], found[i]); return true; });
+    });
+
+    size_t total = 0;
+    for (auto &f : found)
+        total += f.size();
+    matches.reserve(total);
+    for (auto &f : found)
+        matches.insert(matches.end(), f.begin(), f.end());
+    return matches;
+}
 
-    return pointer(_process, nullptr);
+pointer memory::find_single_in_region(const memory &region, const char *data, size_t length, uintptr_t offset, search_direction direction) {
+    region_reader reader(region._process, region._scan_budget);
+    return find_single_in_region(reader, region, data, length, offset, direction);
+}
+
+pointer memory::find_single_in_region(region_reader &reader, const memory &region, const char *data, size_t length, uintptr_t offset, search_direction direction) {
+    if (!region.continuous())
+        throw std::runtime_error("region is not continuous");
+
+    if (region.size() <= offset || length == 0)
+        return pointer(region._process, nullptr);
+
+    return find_single_in_region(reader, region, scan_kernel(data, length), offset, direction);
+}
+
+pointer memory::find_single_in_region_by_pattern(const memory &region, const char *pattern, const char *mask, uintptr_t offset, search_direction direction) {
+    region_reader reader(region._process, region._scan_budget);
+    return find_single_in_region_by_pattern(reader, region, pattern, mask, offset, direction);
+}
+
+pointer memory::find_single_in_region_by_pattern(region_reader &reader, const memory &region, const char *pattern, const char *mask, uintptr_t offset, search_direction direction) {
+    if (!region.continuous())
+        throw std::runtime_error("region is not continuous");
+
+    size_t length;
+    if (region.size() <= offset || !prepare_pattern(pattern, mask, length))
+        return pointer(region._process, nullptr);
+
+    return find_single_in_region(reader, region, scan_kernel(pattern, mask, length), offset, direction);
+}
+
+pointer memory::find_single_in_region(region_reader &reader, const memory &region, const scan_kernel &kernel, uintptr_t offset, search_direction direction) {
+    if (!region.continuous())
+        throw std::runtime_error("region is not continuous");
+
+    auto length = kernel.length();
+    if (region.size() <= offset || length == 0)
+        return pointer(region._process, nullptr);
+
+    uintptr_t match = 0;
+    auto search = [&](uintptr_t address, const char *chunk, size_t size) {
+        auto p = direction != backward ? kernel.first(chunk, size) : kernel.last(chunk, size);
+        if (p == nullptr)
+            return true;
+        match = address + (p - chunk);
+        return false;
+    };
+
+    if (direction != backward)
+        reader.forward(region._begin + offset, region._end, length - 1, search);
+    else
+        reader.backward(region._begin + offset, region._end, length - 1, search);
+
+    return pointer(region._process, match);
+}
+
+void memory::find_in_region(region_reader &reader, const memory &region, const char *data, size_t length, std::vector<pointer> &matches) {
+    if (!region.continuous())
+        throw std::runtime_error("region is not continuous");
+
+    if (length == 0)
+        return;
+
+    find_in_region(reader, region, scan_kernel(data, length), matches);
+}
+
+void memory::find_in_region_by_pattern(region_reader &reader, const memory &region, const char *pattern, const char *mask, std::vector<pointer> &matches) {
+    if (!region.continuous())
+        throw std::runtime_error("region is not continuous");
+
+    size_t length;
+    if (!prepare_pattern(pattern, mask, length))
+        return;
+
+    find_in_region(reader, region, scan_kernel(pattern, mask, length), matches);
+}
+
+void memory::find_in_region(region_reader &reader, const memory &region, const scan_kernel &kernel, std::vector<pointer> &matches) {
+    if (!region.continuous())
+        throw std::runtime_error("region is not continuous");
+
+    auto length = kernel.length();
+    if (length == 0)
+        return;
+
+    reader.forward(region._begin, region._end, length - 1, [&](uintptr_t address, const char *chunk, size_t size) {
+        for (auto p = kernel.first(chunk, size); p != nullptr; p = kernel.first(p + 1, chunk + size - (p + 1)))
+            matches.emplace_back(region._process, address + (p - chunk));
+        return true;
+    });
+}
+
+std::vector<pointer> memory::find(const scan_kernel &kernel) const {
+    return find_all_with(kernel.length(), kernel.matches_zero(), [&](region_reader &reader, const memory &region, std::vector<pointer> &matches) {
+        find_in_region(reader, region, kernel, matches);
+    });
+}
+
+pointer memory::find_single(const scan_kernel &kernel, uintptr_t start, search_direction direction) const {
+    return find_single_with(start, direction, kernel.length(), kernel.matches_zero(), [&](region_reader &reader, const memory &region) {
+        return find_single_in_region(reader, region, kernel, 0, direction);
+    });
+}
+
+// The kernel is compiled once per scan rather than once per region.
+
+std::vector<pointer> memory::find(const char *data, size_t length) const {
+    if (length == 0)
+        return {};
+    return find(scan_kernel(data, length));
+}
+
+pointer memory::find_single(const char *data, size_t length, uintptr_t start, search_direction direction) const {
+    if (length == 0)
+        return pointer(_process, nullptr);
+    return find_single(scan_kernel(data, length), start, direction);
 }
 
 pointer memory::find_first(const char *data, size_t length) const {
@@ -266,74 +485,17 @@ pointer memory::find_last(const std::wstring &data) const {
 }
 
 std::vector<pointer> memory::find_by_pattern(const char *pattern, const char *mask) const {
-    std::vector<pointer> matches;
-
-    for(auto &region : regions()) {
-        for (uintptr_t offset = 0; offset < region.size(); ) {
-            auto p = find_single_in_region_by_pattern(region, pattern, mask, offset);
-            if (p == nullptr)
-                break;
-            matches.emplace_back(p);
-            offset = p - region.begin() + 1;
-        }
-    }
-
-    return matches;
+    size_t length;
+    if (!prepare_pattern(pattern, mask, length))
+        return {};
+    return find(scan_kernel(pattern, mask, length));
 }
 
 pointer memory::find_single_by_pattern(const char *pattern, const char *mask, uintptr_t start, search_direction direction) const {
-    if (start == 0) {
-        if (direction != backward)
-            start = _begin;
-        else
-            start = _end;
-    }
-    
-    auto all_regions = regions();
-
-    decltype(all_regions)::iterator region;
-    std::function<bool(const memory &region, uintptr_t start)> comp;
-    if (direction != backward) {
-        comp = [](const memory &region, uintptr_t start) -> bool {
-            return region.end() <= start;
-        };
-    } else {
-        comp = [](const memory &region, uintptr_t start) -> bool {
-            return region.end() < start;
-        };
-    }
-    region = std::lower_bound(
-        all_regions.begin(),
-        all_regions.end(),
-        start,
-        comp
-    );
-
-    if (region == all_regions.end() || region->begin() > start || region->end() < start)
+    size_t length;
+    if (!prepare_pattern(pattern, mask, length))
         return pointer(_process, nullptr);
-
-    // all_regions returns temp vector of memory regions, so we can safely edit it.
-    if(direction != backward)
-        *region = memory(_process, start, region->end(), true);
-    else
-        *region = memory(_process, region->begin(), start, true);
-
-    while (true) {
-        auto p = find_single_in_region_by_pattern(*region, pattern, mask);
-        if (p != nullptr)
-            return p;
-        if (direction != backward) {
-            region++;
-            if (region == all_regions.end())
-                break;
-        } else {
-            if (region == all_regions.begin())
-                break;
-            region--;
-        }
-    }
-
-    return pointer(_process, nullptr);
+    return find_single(scan_kernel(pattern, mask, length), start, direction);
 }
 
 pointer memory::find_first_by_pattern(const char *pattern, const char *mask) const {
@@ -364,49 +526,89 @@ pointer memory::find_last_reference(uintptr_t ptr) const {
     return find_last((char*)&ptr, sizeof(ptr));
 }
 
-std::vector<pointer> memory::find_call_references(uintptr_t func) const {
-    const byte asm_instr_call = 0xE8;
+namespace {
 
-    std::vector<pointer> matches;
-
-    for(auto &&region : regions()) {
-        std::vector<char> mem(region.size());
-        if (!ReadProcessMemory(region._process, region.begin(), mem.data(), mem.size(), NULL))
-            throw std::system_error(GetLastError(), std::system_category());
-
-        char *p = mem.data();
-        char *p_end = mem.data() + mem.size() - 5;
-        while(true) {
-            for(; p != p_end; ++p)
-                if(*p == asm_instr_call)
-                    break;
-            if(p == p_end) {
-                break;
-            }
-            ++p;
-            if(*(uintptr_t*)p == func - (uintptr_t)p - 5 + 1) { // CALL dest - (src + 5)
-                matches.emplace_back(_process, p - 1);
-            }
+    const byte asm_instr_call = 0xE8;
+    const size_t asm_instr_call_size = 5;
+
+    template<typename F>
+    void find_calls_in_chunk(uintptr_t address, const char *chunk, size_t size, uintptr_t func, F &&found) {
+        if (size < asm_instr_call_size)
+            return;
+        auto p_end = chunk + size - asm_instr_call_size + 1;
+        for (auto p = chunk; (p = (const char*)std::memchr(p, asm_instr_call, p_end - p)) != nullptr; ++p) {
+            int32_t rel;
+            std::memcpy(&rel, p + 1, sizeof(rel));
+            auto src = address + (p - chunk);
+            if (src + asm_instr_call_size + rel == func) // CALL dest - (src + 5)
+                found(src);
         }
     }
 
-    return matches;
+}
+
+std::vector<pointer> memory::find_call_references(uintptr_t func) const {
+    // E8 rel32 is never all zero
+    return find_all_with(asm_instr_call_size, false, [&](region_reader &reader, const memory &region, std::vector<pointer> &matches) {
+        reader.forward(region._begin, region._end, asm_instr_call_size - 1, [&](uintptr_t address, const char *chunk, size_t size) {
+            find_calls_in_chunk(address, chunk, size, func, [&](uintptr_t src) {
+                matches.emplace_back(_process, src);
+            });
+            return true;
+        });
+    });
+}
+
+match_range memory::scan(const char *data, size_t length) const {
+    return scan(scan_kernel(data, length));
+}
+
+match_range memory::scan_by_pattern(const char *pattern, const char *mask) const {
+    size_t length;
+    if (!prepare_pattern(pattern, mask, length))
+        return scan(scan_kernel(pattern, mask, 0));
+    return scan(scan_kernel(pattern, mask, length));
+}
+
+match_range memory::scan(const scan_kernel &kernel) const {
+    auto length = kernel.length();
+    if (length == 0)
+        return match_range(*this, 0, [](uintptr_t, const char*, size_t, std::vector<uintptr_t>&) {});
+    return match_range(*this, length - 1, [kernel](uintptr_t address, const char *chunk, size_t size, std::vector<uintptr_t> &matches) {
+        for (auto p = kernel.first(chunk, size); p != nullptr; p = kernel.first(p + 1, chunk + size - (p + 1)))
+            matches.push_back(address + (p - chunk));
+    }, kernel.matches_zero());
+}
+
+match_range memory::scan_references(uintptr_t ptr) const {
+    return scan((char*)&ptr, sizeof(ptr));
+}
+
+match_range memory::scan_call_references(uintptr_t func) const {
+    return match_range(*this, asm_instr_call_size - 1, [func](uintptr_t address, const char *chunk, size_t size, std::vector<uintptr_t> &matches) {
+        find_calls_in_chunk(address, chunk, size, func, [&](uintptr_t src) {
+            matches.push_back(src);
+        });
+    }, false);
 }
 
 bool memory::is_valid_address(uintptr_t ptr, size_t size) {
-    MEMORY_BASIC_INFORMATION mi;
+    if (auto map = region_map::of(_process))
+        return map->is_valid(ptr, size);
 
-    if (VirtualQueryEx(_process, (LPCVOID)ptr, &mi, sizeof(mi)) == 0)
+    region_info ri;
+
+    if (backend::of(_process).query(_process, ptr, ri))
         return false;
 
-    if (mi.State != MEM_COMMIT)
+    if (ri.state != MEM_COMMIT)
         return false;
 
-    if (mi.Protect == PAGE_NOACCESS)
+    if (ri.protect == PAGE_NOACCESS)
         return false;
 
     auto ptr_end = ptr + size;
-    auto reg_end = (uintptr_t)mi.BaseAddress + mi.RegionSize;
+    auto reg_end = ri.end;
     if (ptr_end > reg_end)
         return is_valid_address(reg_end, ptr_end - reg_end);
 
@@ -414,10 +616,21 @@ bool memory::is_valid_address(uintptr_t ptr, size_t size) {
 }
 
 DWORD memory::get_protection(uintptr_t ptr) {
-    MEMORY_BASIC_INFORMATION mi;
-    if (!VirtualQueryEx(_process, (LPCVOID)ptr, &mi, sizeof(mi)))
-        throw std::system_error(GetLastError(), std::system_category());
-    return mi.Protect;
+    if (auto map = region_map::of(_process))
+        return map->protection(ptr);
+    region_info ri;
+    if (auto ec = backend::of(_process).query(_process, ptr, ri))
+        throw std::system_error(ec);
+    return ri.protect;
+}
+
+bool memory::prepare_pattern(const char *&pattern, const char *&mask, size_t &length) {
+    while (*mask == '\x00' && *pattern != '\x00') {
+        mask++;
+        pattern++;
+    }
+    length = pattern_length(pattern, mask);
+    return length != 0;
 }
 
 size_t memory::pattern_length(const char *pattern, const char *mask) {
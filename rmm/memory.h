@@ -1,18 +1,28 @@
 #pragma once
 
 #include "typedefs.h"
+#include "platform.h"
+#include "backend.h"
 #include "pointer.h"
-
-#include <Windows.h>
-
+#include "region_reader.h"
+#include "match_range.h"
+#include "scan_kernel.h"
+#include "signature.h"
+#include "statistics.h"
+#include "thread_pool.h"
+
+#include <memory>
 #include <string>
 #include <vector>
 
 namespace rmm {
 
     class module;
+    class async_scan;
 
     class memory {
+        friend class async_scan;
+
     public:
         enum search_direction {
             forward,
@@ -28,10 +38,41 @@ namespace rmm {
         inline bool has(pointer address) const { return _process == address.process() && _begin <= address && address < _end; }
         inline uintptr_t size() const { return _end - _begin; }
 
+        // Upper bound of the buffer used to scan a region (see region_reader).
+        inline size_t scan_budget() const { return _scan_budget; }
+        inline void set_scan_budget(size_t budget) { _scan_budget = budget; }
+
+        // Scans are spread over `pool` (e.g. &thread_pool::shared()) if set, and run on the calling thread otherwise.
+        // Large regions are split into pieces, results are the same either way.
+        inline thread_pool* scan_pool() const { return _scan_pool; }
+        inline void set_scan_pool(thread_pool *pool) { _scan_pool = pool; }
+
+        // Collects statistics (see statistics) of the work done through this object, its copies and its regions,
+        // on whichever threads it runs. Disabled by default.
+        void collect_stats(bool enable = true);
+        statistics::snapshot stats() const;
+        void reset_stats();
+        inline const std::shared_ptr<statistics::sink>& stats_sink() const { return _stats; }
+
         std::vector<memory> regions() const;
+        // The same regions as the backend describes them, protection and type included.
+        std::vector<region_info> readable_regions() const;
+        // Readable regions without the private pages the backend reports as never populated (see backend::populated_pages),
+        // which read as zeros, but for the `overlap` bytes on either side of populated pages.
+        // Searches which cannot match zero-filled data (see scan_kernel::matches_zero) use these, so that untouched
+        // reservations are neither read nor faulted into the target.
+        std::vector<memory> populated_regions(size_t overlap) const;
 
         static pointer find_single_in_region(const memory &region, const char *data, size_t length, uintptr_t offset = 0, search_direction direction = forward);
         static pointer find_single_in_region_by_pattern(const memory &region, const char *pattern, const char *mask, uintptr_t offset = 0, search_direction direction = forward);
+        static pointer find_single_in_region(region_reader &reader, const memory &region, const char *data, size_t length, uintptr_t offset = 0, search_direction direction = forward);
+        static pointer find_single_in_region_by_pattern(region_reader &reader, const memory &region, const char *pattern, const char *mask, uintptr_t offset = 0, search_direction direction = forward);
+
+        // Appends every match within `region` to `matches`, reading the region once.
+        static void find_in_region(region_reader &reader, const memory &region, const char *data, size_t length, std::vector<pointer> &matches);
+        static void find_in_region_by_pattern(region_reader &reader, const memory &region, const char *pattern, const char *mask, std::vector<pointer> &matches);
+        static pointer find_single_in_region(region_reader &reader, const memory &region, const scan_kernel &kernel, uintptr_t offset = 0, search_direction direction = forward);
+        static void find_in_region(region_reader &reader, const memory &region, const scan_kernel &kernel, std::vector<pointer> &matches);
 
         std::vector<pointer> find(const char *data, size_t length) const;
         pointer find_single(const char *data, size_t length, uintptr_t start = 0, search_direction direction = forward) const;
@@ -61,17 +102,46 @@ namespace rmm {
         pointer find_prev_by_pattern(const char *pattern, const char *mask, uintptr_t start = 0) const;
         pointer find_last_by_pattern(const char *pattern, const char *mask) const;
 
+        // Compiled patterns (see scan_kernel and signature): the length is explicit and matches are reported
+        // at the first byte of the pattern, wildcards included.
+        std::vector<pointer> find(const scan_kernel &kernel) const;
+        pointer find_single(const scan_kernel &kernel, uintptr_t start = 0, search_direction direction = forward) const;
+        match_range scan(const scan_kernel &kernel) const;
+
+        template<size_t N>
+        inline std::vector<pointer> find(const signature<N> &signature) const { return find(signature.kernel()); }
+        template<size_t N>
+        inline pointer find_first(const signature<N> &signature) const { return find_single(signature.kernel()); }
+        template<size_t N>
+        inline pointer find_next(const signature<N> &signature, uintptr_t start = 0) const { return find_single(signature.kernel(), start, forward); }
+        template<size_t N>
+        inline pointer find_prev(const signature<N> &signature, uintptr_t start = 0) const { return find_single(signature.kernel(), start, backward); }
+        template<size_t N>
+        inline pointer find_last(const signature<N> &signature) const { return find_single(signature.kernel(), 0, backward); }
+        template<size_t N>
+        inline match_range scan(const signature<N> &signature) const { return scan(signature.kernel()); }
+
         std::vector<pointer> find_references(uintptr_t ptr) const;
         pointer find_first_reference(uintptr_t ptr) const;
         pointer find_last_reference(uintptr_t ptr) const;
 
         std::vector<pointer> find_call_references(uintptr_t func) const;
 
+        // Lazy counterparts of find, find_by_pattern, find_references and find_call_references:
+        // matches are found as they are consumed (see match_range).
+        match_range scan(const char *data, size_t length) const;
+        match_range scan_by_pattern(const char *pattern, const char *mask) const;
+        match_range scan_references(uintptr_t ptr) const;
+        match_range scan_call_references(uintptr_t func) const;
+
         void redirect_call(uintptr_t dest, uintptr_t src);
 
         bool is_valid_address(uintptr_t ptr, size_t size = sizeof(uintptr_t));
         DWORD get_protection(uintptr_t ptr);
 
+        // Skips leading wildcards ("dummy mask"), so matches are reported at the first non-wildcard byte.
+        // Returns false if nothing is left to match.
+        static bool prepare_pattern(const char *&pattern, const char *&mask, size_t &length);
         static size_t pattern_length(const char *pattern, const char *mask);
         static bool pattern_matches(const char *data, const char *pattern, const char *mask);
 
@@ -80,9 +150,22 @@ namespace rmm {
         uintptr_t _begin;
         uintptr_t _end;
         bool _continuous;
-
-    private:
-        static const SYSTEM_INFO sys_info;
+        size_t _scan_budget;
+        thread_pool *_scan_pool;
+        std::shared_ptr<statistics::sink> _stats;
+
+        // Regions searched for a pattern of `length` bytes: populated_regions if it cannot match zeros, regions otherwise.
+        std::vector<memory> scan_regions(size_t length, bool matches_zero) const;
+        // Regions searched by find_single*: `regions` from `start` on, clipped at `start` and ordered in `direction`.
+        std::vector<memory> regions_from(std::vector<memory> regions, uintptr_t start, search_direction direction) const;
+        // Splits regions into pieces of `piece` bytes, each extended by `overlap` bytes (within its region).
+        static std::vector<memory> split_regions(const std::vector<memory> &regions, size_t piece, size_t overlap, search_direction direction);
+
+        // `search` looks for matches of `length` bytes, which are never all zero unless `matches_zero`.
+        template<typename F>
+        pointer find_single_with(uintptr_t start, search_direction direction, size_t length, bool matches_zero, F &&search) const;
+        template<typename F>
+        std::vector<pointer> find_all_with(size_t length, bool matches_zero, F &&search) const;
     };
 
 }
@@ -1,8 +1,6 @@
 #include "module.h"
-
-#include <Windows.h>
-#include <Psapi.h>
-#include <TlHelp32.h>
+#include "module_image.h"
+#include "statistics.h"
 
 using namespace rmm;
 
@@ -10,34 +8,20 @@ module::module(HANDLE process, const std::wstring &name)
     : memory(process)
     , name(name)
 {
-    auto hSnapshot = CreateToolhelp32Snapshot(TH32CS_SNAPMODULE | TH32CS_SNAPMODULE32, GetProcessId(process));
-    if (!hSnapshot)
-        throw std::system_error(GetLastError(), std::system_category());
-
-    bool found = false;
-    MODULEENTRY32 me;
-    me.dwSize = sizeof(me);
-    if (!Module32First(hSnapshot, &me))
-        throw std::system_error(GetLastError(), std::system_category());
-    do {
-        if (name == me.szModule) {
-            found = true;
-            break;
+    statistics::add(statistics::modules_resolved);
+    statistics::timer timer(statistics::resolve_module);
+    for (auto &mi : backend::of(process).modules(process)) {
+        if (name == mi.name) {
+            _begin = mi.begin;
+            _end = mi.end;
+            _continuous = true;
+            return;
         }
-    } while (Module32Next(hSnapshot, &me));
-    if (GetLastError() != ERROR_NO_MORE_FILES)
-        throw std::system_error(GetLastError(), std::system_category());
-
-    if (!found) {
-        _begin = 0;
-        _end = 0;
-        _continuous = false;
-        return;
     }
 
-    _begin = (uintptr_t)me.modBaseAddr;
-    _end = (uintptr_t)me.modBaseAddr + me.modBaseSize;
-    _continuous = true;
+    _begin = 0;
+    _end = 0;
+    _continuous = false;
 }
 
 module::module(HANDLE process, const std::wstring & name, uintptr_t begin, uintptr_t end)
@@ -51,29 +35,10 @@ bool module::is_valid() const {
 
 const std::map<std::string, ::rmm::section>& module::sections() {
     if(_sections.size() == 0) {
-        auto pDosHeader = begin();
-        if (!pDosHeader.is_valid(sizeof(IMAGE_DOS_HEADER)))
-            return _sections;
-
-        IMAGE_DOS_HEADER dosHeader;
-        pDosHeader >> dosHeader;
-
-        auto pNtHeaders = begin() + dosHeader.e_lfanew;
-        if (!pNtHeaders.is_valid(sizeof(IMAGE_NT_HEADERS)))
-            return _sections;
-
-        IMAGE_NT_HEADERS ntHeaders;
-        pNtHeaders >> ntHeaders;
-
-        auto pSections = begin() + dosHeader.e_lfanew + FIELD_OFFSET(IMAGE_NT_HEADERS, OptionalHeader) + ntHeaders.FileHeader.SizeOfOptionalHeader;
-        if (!pSections.is_valid(sizeof(IMAGE_SECTION_HEADER) * ntHeaders.FileHeader.NumberOfSections))
-            return _sections;
-
-        std::vector<IMAGE_SECTION_HEADER> sections(ntHeaders.FileHeader.NumberOfSections);
-        for(int i = 0; i < ntHeaders.FileHeader.NumberOfSections; i++) {
-            (pSections + i * sizeof(IMAGE_SECTION_HEADER)) >> sections[i];
-            auto &header = sections[i];
-            auto s = ::rmm::section(begin(), header);
+        // the header block is read at once rather than header by header
+        auto image = module_image::parse(*this, false);
+        for(auto &entry : image->sections()) {
+            auto s = ::rmm::section(_process, entry.name, entry.begin, entry.end, entry.protect);
             _sections.emplace(s.name, std::move(s));
         }
     }
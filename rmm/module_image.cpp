@@ -0,0 +1,488 @@
+#include "module_image.h"
+#include "backend.h"
+#include "elf_headers.h"
+#include "section.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+using namespace rmm;
+
+namespace {
+
+    const size_t block_size = 0x10000;
+    const size_t page = 0x1000;
+
+    // Sanity limits for counts read from the image.
+    const size_t max_descriptors = 0x1000;
+    const size_t max_thunks = 0x10000;
+    const size_t max_entries = 0x100000;
+    const size_t max_string = 0x1000;
+
+    DWORD segment_protection(uint32_t flags) {
+        bool r = (flags & elf::pf_r) != 0;
+        bool w = (flags & elf::pf_w) != 0;
+        if (flags & elf::pf_x)
+            return w ? PAGE_EXECUTE_READWRITE : r ? PAGE_EXECUTE_READ : PAGE_EXECUTE;
+        return w ? PAGE_READWRITE : r ? PAGE_READONLY : PAGE_NOACCESS;
+    }
+
+    bool equal_nocase(const std::string &a, const std::string &b) {
+        return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+            return std::tolower((unsigned char)x) == std::tolower((unsigned char)y);
+        });
+    }
+
+    // Relocation type filling a GOT slot with the address of a symbol (R_*_GLOB_DAT), 0 if unknown.
+    uint32_t glob_dat(uint16_t machine) {
+        switch (machine) {
+        case elf::em_386: return 6;
+        case elf::em_x86_64: return 6;
+        case elf::em_arm: return 21;
+        case elf::em_aarch64: return 1025;
+        }
+        return 0;
+    }
+
+}
+
+// Image fetched lazily in blocks, each read (or viewed) once; unreadable pages of a block are told apart.
+class module_image::reader {
+public:
+    reader(HANDLE process, uintptr_t begin, uintptr_t end)
+        : _process(process)
+        , _begin(begin)
+        , _size(end - begin)
+        , _io(backend::of(process))
+    {}
+
+    inline uint64_t size() const { return _size; }
+
+    bool read(uint64_t rva, void *buffer, size_t size) {
+        auto out = (char*)buffer;
+        while (size != 0) {
+            auto data = at(rva);
+            if (data == nullptr)
+                return false;
+            auto n = (std::min)(size, (size_t)(page - rva % page));
+            std::memcpy(out, data, n);
+            out += n;
+            rva += n;
+            size -= n;
+        }
+        return true;
+    }
+
+    template<typename T>
+    inline bool get(uint64_t rva, T &value) {
+        return read(rva, &value, sizeof(T));
+    }
+
+    template<typename T>
+    bool array(uint64_t rva, size_t count, std::vector<T> &values) {
+        if (count > max_entries || count * sizeof(T) > _size)
+            return false;
+        values.resize(count);
+        return read(rva, values.data(), count * sizeof(T));
+    }
+
+    // NUL-terminated string, empty if unreadable.
+    std::string string(uint64_t rva) {
+        std::string s;
+        while (s.size() < max_string) {
+            auto data = at(rva);
+            if (data == nullptr)
+                return {};
+            auto n = (size_t)(page - rva % page);
+            auto length = strnlen(data, n);
+            s.append(data, length);
+            if (length < n)
+                return s;
+            rva += n;
+        }
+        return {};
+    }
+
+private:
+    struct block {
+        const char *data;
+        std::vector<char> storage;
+        std::vector<bool> readable;
+    };
+
+    // Byte at `rva`, readable up to the end of its page; nullptr if unreadable.
+    const char* at(uint64_t rva) {
+        if (rva >= _size)
+            return nullptr;
+        auto &b = load(rva / block_size);
+        auto offset = (size_t)(rva % block_size);
+        return b.readable[offset / page] ? b.data + offset : nullptr;
+    }
+
+    block& load(uint64_t index) {
+        auto it = _blocks.find(index);
+        if (it != _blocks.end())
+            return it->second;
+
+        auto &b = _blocks[index];
+        auto address = _begin + (uintptr_t)(index * block_size);
+        auto size = (size_t)(std::min)((uint64_t)block_size, _size - index * block_size);
+        auto pages = (size + page - 1) / page;
+        if ((b.data = (const char*)_io.view(_process, address, size)) != nullptr) {
+            b.readable.assign(pages, true);
+            return b;
+        }
+        b.storage.resize(size);
+        b.data = b.storage.data();
+        if (!_io.read(_process, address, b.storage.data(), size)) {
+            b.readable.assign(pages, true);
+            return b;
+        }
+        // some pages are not readable (gaps between ELF segments, guard pages), tell them apart
+        b.readable.resize(pages);
+        for (size_t i = 0; i < pages; i++) {
+            auto n = (std::min)(page, size - i * page);
+            b.readable[i] = !_io.read(_process, address + i * page, b.storage.data() + i * page, n);
+        }
+        return b;
+    }
+
+    HANDLE _process;
+    uintptr_t _begin;
+    uint64_t _size;
+    backend &_io;
+    std::unordered_map<uint64_t, block> _blocks;
+};
+
+module_image::module_image(HANDLE process, uintptr_t begin, uintptr_t end)
+    : _process(process)
+    , _begin(begin)
+    , _end(end)
+{}
+
+std::shared_ptr<const module_image> module_image::parse(HANDLE process, uintptr_t begin, uintptr_t end, bool symbols) {
+    std::shared_ptr<module_image> image(new module_image(process, begin, end));
+    if (end <= begin)
+        return image;
+
+    reader r(process, begin, end);
+    unsigned char ident[16];
+    if (r.get(0, ident) && std::memcmp(ident, elf::magic, sizeof(elf::magic)) == 0 && ident[elf::ident_data] == elf::little_endian) {
+        if (ident[elf::ident_class] == elf::class64)
+            image->parse_elf<uint64_t, elf::program_header64, elf::symbol64>(r, symbols);
+        else if (ident[elf::ident_class] == elf::class32)
+            image->parse_elf<uint32_t, elf::program_header32, elf::symbol32>(r, symbols);
+    } else {
+        image->parse_pe(r, symbols);
+    }
+    image->index();
+    return image;
+}
+
+std::shared_ptr<const module_image> module_image::parse(const memory &module, bool symbols) {
+    return parse(module.begin().process(), module.begin(), module.end(), symbols);
+}
+
+void module_image::parse_pe(reader &image, bool symbols) {
+    IMAGE_DOS_HEADER dos;
+    if (!image.get(0, dos) || dos.e_magic != IMAGE_DOS_SIGNATURE || dos.e_lfanew < 0)
+        return;
+    auto nt = (uint64_t)dos.e_lfanew;
+    DWORD signature;
+    IMAGE_FILE_HEADER file_header;
+    WORD magic;
+    auto optional = nt + sizeof(DWORD) + sizeof(IMAGE_FILE_HEADER);
+    if (!image.get(nt, signature) || signature != IMAGE_NT_SIGNATURE || !image.get(nt + sizeof(DWORD), file_header) || !image.get(optional, magic))
+        return;
+
+    IMAGE_DATA_DIRECTORY directories[IMAGE_NUMBEROF_DIRECTORY_ENTRIES] = {};
+    DWORD directory_count;
+    if (magic == IMAGE_NT_OPTIONAL_HDR64_MAGIC) {
+        IMAGE_OPTIONAL_HEADER64 oh;
+        if (!image.get(optional, oh))
+            return;
+        directory_count = oh.NumberOfRvaAndSizes;
+        std::copy(oh.DataDirectory, oh.DataDirectory + IMAGE_NUMBEROF_DIRECTORY_ENTRIES, directories);
+        _64bit = true;
+    } else if (magic == IMAGE_NT_OPTIONAL_HDR32_MAGIC) {
+        IMAGE_OPTIONAL_HEADER32 oh;
+        if (!image.get(optional, oh))
+            return;
+        directory_count = oh.NumberOfRvaAndSizes;
+        std::copy(oh.DataDirectory, oh.DataDirectory + IMAGE_NUMBEROF_DIRECTORY_ENTRIES, directories);
+    } else {
+        return;
+    }
+    _format = pe_format;
+
+    if (!image.array(optional + file_header.SizeOfOptionalHeader, file_header.NumberOfSections, _section_headers))
+        _section_headers.clear();
+    for (auto &header : _section_headers) {
+        auto name = (const char*)header.Name;
+        auto begin = _begin + header.VirtualAddress;
+        auto end = begin + (std::max)(header.Misc.VirtualSize, header.SizeOfRawData);
+        _sections.push_back({ std::string(name, strnlen(name, sizeof(header.Name))), begin, end, section::protection(header.Characteristics) });
+    }
+
+    if (!symbols)
+        return;
+    if (directory_count > IMAGE_DIRECTORY_ENTRY_EXPORT)
+        parse_pe_exports(image, directories[IMAGE_DIRECTORY_ENTRY_EXPORT]);
+    if (directory_count > IMAGE_DIRECTORY_ENTRY_IMPORT) {
+        if (_64bit)
+            parse_pe_imports<uint64_t>(image, directories[IMAGE_DIRECTORY_ENTRY_IMPORT]);
+        else
+            parse_pe_imports<uint32_t>(image, directories[IMAGE_DIRECTORY_ENTRY_IMPORT]);
+    }
+}
+
+void module_image::parse_pe_exports(reader &image, const IMAGE_DATA_DIRECTORY &directory) {
+    IMAGE_EXPORT_DIRECTORY exports;
+    if (directory.VirtualAddress == 0 || directory.Size == 0 || !image.get(directory.VirtualAddress, exports))
+        return;
+
+    std::vector<DWORD> functions, names;
+    std::vector<WORD> ordinals;
+    if (!image.array(exports.AddressOfFunctions, exports.NumberOfFunctions, functions)
+        || !image.array(exports.AddressOfNames, exports.NumberOfNames, names)
+        || !image.array(exports.AddressOfNameOrdinals, exports.NumberOfNames, ordinals))
+        return;
+
+    // one entry per function, and one more for each of its names but the first
+    std::vector<size_t> entry_of(functions.size(), SIZE_MAX);
+    for (size_t i = 0; i < functions.size(); i++) {
+        auto rva = functions[i];
+        if (rva == 0)
+            continue;
+        export_entry entry{ {}, 0, exports.Base + (DWORD)i, {}, false };
+        if (rva >= directory.VirtualAddress && rva - directory.VirtualAddress < directory.Size)
+            entry.forwarder = image.string(rva);
+        else
+            entry.address = _begin + rva;
+        entry_of[i] = _exports.size();
+        _exports.push_back(std::move(entry));
+    }
+    for (size_t i = 0; i < names.size(); i++) {
+        if (ordinals[i] >= entry_of.size() || entry_of[ordinals[i]] == SIZE_MAX)
+            continue;
+        auto name = image.string(names[i]);
+        auto &entry = _exports[entry_of[ordinals[i]]];
+        if (entry.name.empty()) {
+            entry.name = std::move(name);
+        } else {
+            auto alias = entry;
+            alias.name = std::move(name);
+            _exports.push_back(std::move(alias));
+        }
+    }
+}
+
+template<typename Thunk>
+void module_image::parse_pe_imports(reader &image, const IMAGE_DATA_DIRECTORY &directory) {
+    if (directory.VirtualAddress == 0 || directory.Size == 0)
+        return;
+    const Thunk ordinal_flag = (Thunk)1 << (sizeof(Thunk) * 8 - 1);
+
+    for (size_t d = 0; d < max_descriptors; d++) {
+        IMAGE_IMPORT_DESCRIPTOR descriptor;
+        if (!image.get(directory.VirtualAddress + d * sizeof(descriptor), descriptor) || (descriptor.Name == 0 && descriptor.FirstThunk == 0))
+            break;
+        auto module = image.string(descriptor.Name);
+        // without the lookup table the names are gone, the loader has overwritten the IAT
+        auto lookup = descriptor.OriginalFirstThunk != 0 ? descriptor.OriginalFirstThunk : descriptor.FirstThunk;
+
+        for (size_t i = 0; i < max_thunks; i++) {
+            Thunk thunk;
+            if (!image.get(lookup + i * sizeof(Thunk), thunk) || thunk == 0)
+                break;
+            import_entry entry{ module, {}, 0, _begin + descriptor.FirstThunk + (uintptr_t)(i * sizeof(Thunk)) };
+            if (thunk & ordinal_flag)
+                entry.ordinal = (DWORD)(thunk & 0xFFFF);
+            else if (thunk < image.size())
+                entry.name = image.string(thunk + sizeof(WORD)); // IMAGE_IMPORT_BY_NAME: hint, then the name
+            _imports.push_back(std::move(entry));
+        }
+    }
+}
+
+template<typename Addr, typename ProgramHeader, typename Symbol>
+void module_image::parse_elf(reader &image, bool symbols) {
+    elf::file_header<Addr> header;
+    std::vector<ProgramHeader> segments;
+    if (!image.get(0, header) || header.phentsize != sizeof(ProgramHeader) || !image.array(header.phoff, header.phnum, segments))
+        return;
+    _format = elf_format;
+    _64bit = sizeof(Addr) == 8;
+
+    uint64_t lowest = UINT64_MAX;
+    const ProgramHeader *dynamic = nullptr;
+    for (auto &s : segments) {
+        if (s.type == elf::pt_load)
+            lowest = (std::min)(lowest, (uint64_t)s.vaddr & ~(uint64_t)(page - 1));
+        else if (s.type == elf::pt_dynamic)
+            dynamic = &s;
+    }
+    if (lowest == UINT64_MAX)
+        return;
+
+    // The section headers are not mapped by the loader, the sections are the PT_LOAD segments (LOAD0, LOAD1, ...).
+    for (auto &s : segments) {
+        if (s.type != elf::pt_load)
+            continue;
+        auto begin = _begin + (uintptr_t)(s.vaddr - lowest);
+        _sections.push_back({ "LOAD" + std::to_string(_sections.size()), begin, begin + (uintptr_t)s.memsz, segment_protection(s.flags) });
+    }
+
+    if (!symbols || dynamic == nullptr || dynamic->vaddr < lowest)
+        return;
+
+    // The dynamic linker relocates pointers in .dynamic in place (glibc does, where it is writable),
+    // so they are either addresses or, as in the file, virtual addresses of the image.
+    auto rva = [&](uint64_t value) -> uint64_t {
+        return value >= _begin && value < _end ? value - _begin : value - lowest;
+    };
+
+    std::vector<elf::dynamic_entry<Addr>> entries;
+    if (!image.array(dynamic->vaddr - lowest, dynamic->memsz / sizeof(elf::dynamic_entry<Addr>), entries))
+        return;
+    uint64_t tags[elf::dt_jmprel + 1] = {};
+    bool present[elf::dt_jmprel + 1] = {};
+    uint64_t gnu_hash = 0;
+    uint64_t versym = 0;
+    for (auto &entry : entries) {
+        if (entry.tag == elf::dt_null)
+            break;
+        if (entry.tag <= elf::dt_jmprel) {
+            tags[entry.tag] = entry.value;
+            present[entry.tag] = true;
+        } else if (entry.tag == elf::dt_gnu_hash) {
+            gnu_hash = rva(entry.value);
+        } else if (entry.tag == elf::dt_versym) {
+            versym = rva(entry.value);
+        }
+    }
+    if (!present[elf::dt_symtab] || !present[elf::dt_strtab])
+        return;
+    auto symtab = rva(tags[elf::dt_symtab]);
+    auto strtab = rva(tags[elf::dt_strtab]);
+
+    // The number of symbols is only known from the hash tables: nchain of DT_HASH, or the end of the last DT_GNU_HASH chain.
+    size_t count = 0;
+    uint32_t words[4];
+    if (present[elf::dt_hash] && image.get(rva(tags[elf::dt_hash]), words)) {
+        count = words[1];
+    } else if (gnu_hash != 0 && image.get(gnu_hash, words)) {
+        auto buckets_rva = gnu_hash + sizeof(words) + (uint64_t)words[2] * sizeof(Addr);
+        std::vector<uint32_t> buckets;
+        if (image.array(buckets_rva, words[0], buckets)) {
+            uint32_t last = 0;
+            for (auto b : buckets)
+                last = (std::max)(last, b);
+            if (last >= words[1]) {
+                auto chains = buckets_rva + (uint64_t)words[0] * sizeof(uint32_t) - (uint64_t)words[1] * sizeof(uint32_t);
+                uint32_t chain = 0;
+                while (last < max_entries && image.get(chains + (uint64_t)last * sizeof(uint32_t), chain) && !(chain & 1))
+                    last++;
+            }
+            count = (size_t)last + 1;
+        }
+    } else if (strtab > symtab) {
+        count = (size_t)((strtab - symtab) / sizeof(Symbol));
+    }
+
+    std::vector<Symbol> table;
+    std::vector<char> strings;
+    if (!image.array(symtab, count, table) || !image.array(strtab, (size_t)tags[elf::dt_strsz], strings))
+        return;
+    auto name_of = [&](uint32_t symbol) -> std::string {
+        if (symbol >= table.size() || table[symbol].name >= strings.size())
+            return {};
+        auto name = strings.data() + table[symbol].name;
+        return std::string(name, strnlen(name, strings.size() - table[symbol].name));
+    };
+
+    // Older versions of a symbol (memcpy@GLIBC_2.2.5 next to memcpy@@GLIBC_2.14) are hidden, only the default one is exported.
+    std::vector<uint16_t> versions;
+    if (versym != 0 && !image.array(versym, table.size(), versions))
+        versions.clear();
+    const uint16_t version_hidden = 0x8000;
+
+    const unsigned char stt_tls = 6;
+    const unsigned char stt_gnu_ifunc = 10;
+    for (size_t i = 1; i < table.size(); i++) {
+        auto &s = table[i];
+        auto bind = s.info >> 4;
+        auto type = s.info & 0xF;
+        if (s.shndx == elf::shn_undef || bind == elf::stb_local || type == elf::stt_section || type == elf::stt_file || type == stt_tls)
+            continue;
+        if (i < versions.size() && (versions[i] & version_hidden))
+            continue;
+        auto name = name_of((uint32_t)i);
+        if (!name.empty())
+            _exports.push_back({ std::move(name), _begin + (uintptr_t)(s.value - lowest), 0, {}, type == stt_gnu_ifunc });
+    }
+
+    // PLT slots are every relocation of DT_JMPREL, GOT slots the GLOB_DAT ones of DT_RELA/DT_REL.
+    auto relocations = [&](uint64_t table_rva, uint64_t size, bool addend, bool plt) {
+        auto entry = sizeof(elf::relocation<Addr>) + (addend ? sizeof(Addr) : 0);
+        std::vector<Addr> fields;
+        if (!image.array(table_rva, (size_t)(size / entry) * (entry / sizeof(Addr)), fields))
+            return;
+        auto got = glob_dat(header.machine);
+        for (size_t i = 0; i + 1 < fields.size(); i += entry / sizeof(Addr)) {
+            uint64_t info = fields[i + 1];
+            auto symbol = (uint32_t)(sizeof(Addr) == 8 ? info >> 32 : info >> 8);
+            auto type = (uint32_t)(sizeof(Addr) == 8 ? info & 0xFFFFFFFF : info & 0xFF);
+            if (symbol == 0 || (!plt && (got == 0 || type != got)))
+                continue;
+            _imports.push_back({ {}, name_of(symbol), 0, _begin + (uintptr_t)(fields[i] - lowest) });
+        }
+    };
+    if (present[elf::dt_jmprel])
+        relocations(rva(tags[elf::dt_jmprel]), tags[elf::dt_pltrelsz], tags[elf::dt_pltrel] == elf::dt_rela, true);
+    if (present[elf::dt_rela])
+        relocations(rva(tags[elf::dt_rela]), tags[elf::dt_relasz], true, false);
+    if (present[elf::dt_rel])
+        relocations(rva(tags[elf::dt_rel]), tags[elf::dt_relsz], false, false);
+}
+
+void module_image::index() {
+    _exports_by_name.reserve(_exports.size());
+    for (size_t i = 0; i < _exports.size(); i++) {
+        if (!_exports[i].name.empty())
+            _exports_by_name.emplace(_exports[i].name, i);
+        if (_format == pe_format)
+            _exports_by_ordinal.emplace(_exports[i].ordinal, i);
+    }
+    for (size_t i = 0; i < _imports.size(); i++) {
+        if (!_imports[i].name.empty())
+            _imports_by_name[_imports[i].name].push_back(i);
+    }
+}
+
+const module_image::export_entry* module_image::find_export(const std::string &name) const {
+    auto it = _exports_by_name.find(name);
+    return it != _exports_by_name.end() ? &_exports[it->second] : nullptr;
+}
+
+const module_image::export_entry* module_image::find_export(DWORD ordinal) const {
+    auto it = _exports_by_ordinal.find(ordinal);
+    return it != _exports_by_ordinal.end() ? &_exports[it->second] : nullptr;
+}
+
+const module_image::import_entry* module_image::find_import(const std::string &name) const {
+    auto it = _imports_by_name.find(name);
+    return it != _imports_by_name.end() ? &_imports[it->second.front()] : nullptr;
+}
+
+const module_image::import_entry* module_image::find_import(const std::string &module, const std::string &name) const {
+    auto it = _imports_by_name.find(name);
+    if (it == _imports_by_name.end())
+        return nullptr;
+    for (auto i : it->second) {
+        if (equal_nocase(_imports[i].module, module))
+            return &_imports[i];
+    }
+    return nullptr;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "typedefs.h"
+#include "platform.h"
+#include "memory.h"
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace rmm {
+
+    // Headers and symbol tables of a PE or ELF image loaded in a process, parsed in one go.
+    // The image is fetched in blocks of 64 KiB (or viewed in place, see backend::view), so the header block,
+    // the export/import directories or the dynamic symbol and relocation tables take a handful of reads
+    // instead of one per structure. Exports and imports are indexed by name, lookups are O(1).
+    class module_image {
+    public:
+        enum image_format {
+            unknown_format,
+            pe_format,
+            elf_format,
+        };
+
+        struct section_entry {
+            std::string name;
+            uintptr_t begin;
+            uintptr_t end;
+            DWORD protect;
+        };
+
+        // PE export, or defined global ELF dynamic symbol.
+        struct export_entry {
+            std::string name;      // empty if exported by ordinal only
+            uintptr_t address;     // 0 for forwarders
+            DWORD ordinal;         // PE only
+            std::string forwarder; // PE forwarder ("module.name" or "module.#ordinal")
+            bool indirect;         // ELF STT_GNU_IFUNC: `address` is that of the resolver, not of the function
+        };
+
+        // Slot the loader fills with an imported address: PE IAT entry, ELF GOT or PLT slot.
+        struct import_entry {
+            std::string module;    // PE only: the DLL it is imported from
+            std::string name;      // empty if imported by ordinal
+            DWORD ordinal;
+            uintptr_t slot;
+        };
+
+        // Parses the image at [begin, end), with its exports and imports unless `symbols` is false.
+        // Whatever cannot be read or is malformed is left out, an unrecognized image yields unknown_format and nothing else.
+        static std::shared_ptr<const module_image> parse(HANDLE process, uintptr_t begin, uintptr_t end, bool symbols = true);
+        static std::shared_ptr<const module_image> parse(const memory &module, bool symbols = true);
+
+        inline HANDLE process() const { return _process; }
+        inline uintptr_t begin() const { return _begin; }
+        inline uintptr_t end() const { return _end; }
+        inline image_format format() const { return _format; }
+        inline bool is_64bit() const { return _64bit; }
+
+        // PE section table (empty for ELF images), and the sections by name, address and protection:
+        // those of the table, or the PT_LOAD segments of an ELF image (LOAD0, LOAD1, ... in program header order).
+        inline const std::vector<IMAGE_SECTION_HEADER>& section_headers() const { return _section_headers; }
+        inline const std::vector<section_entry>& sections() const { return _sections; }
+        inline const std::vector<export_entry>& exports() const { return _exports; }
+        inline const std::vector<import_entry>& imports() const { return _imports; }
+
+        // Export named `name` (the first one), nullptr if none.
+        const export_entry* find_export(const std::string &name) const;
+        const export_entry* find_export(DWORD ordinal) const;
+        // Import slot of `name` (the first one, from any module), nullptr if none.
+        const import_entry* find_import(const std::string &name) const;
+        // Import slot of `name` from `module` (case insensitive, PE only), nullptr if none.
+        const import_entry* find_import(const std::string &module, const std::string &name) const;
+
+    private:
+        module_image(HANDLE process, uintptr_t begin, uintptr_t end);
+
+        class reader;
+        void parse_pe(reader &image, bool symbols);
+        template<typename Thunk>
+        void parse_pe_imports(reader &image, const IMAGE_DATA_DIRECTORY &directory);
+        void parse_pe_exports(reader &image, const IMAGE_DATA_DIRECTORY &directory);
+        template<typename Addr, typename ProgramHeader, typename Symbol>
+        void parse_elf(reader &image, bool symbols);
+        void index();
+
+        HANDLE _process;
+        uintptr_t _begin;
+        uintptr_t _end;
+        image_format _format = unknown_format;
+        bool _64bit = false;
+        std::vector<IMAGE_SECTION_HEADER> _section_headers;
+        std::vector<section_entry> _sections;
+        std::vector<export_entry> _exports;
+        std::vector<import_entry> _imports;
+        std::unordered_map<std::string, size_t> _exports_by_name;
+        std::unordered_map<DWORD, size_t> _exports_by_ordinal;
+        std::unordered_map<std::string, std::vector<size_t>> _imports_by_name;
+    };
+
+}
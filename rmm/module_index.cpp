@@ -0,0 +1,96 @@
+#include "module_index.h"
+#include "backend.h"
+#include "module.h"
+
+#include <algorithm>
+
+using namespace rmm;
+
+module_index::module_index(HANDLE process)
+    : _process(process)
+{}
+
+std::shared_ptr<const module_index> module_index::build(HANDLE process, const module_index *previous) {
+    auto modules = backend::of(process).modules(process);
+    std::sort(modules.begin(), modules.end(), [](const module_info &a, const module_info &b) {
+        return a.begin < b.begin;
+    });
+
+    std::shared_ptr<module_index> index(new module_index(process));
+    index->_modules.reserve(modules.size());
+    for (auto &mi : modules) {
+        module_entry entry{ mi.name, mi.begin, mi.end, index->_sections.size(), 0 };
+
+        const module_entry *loaded = nullptr;
+        if (previous != nullptr && previous->_process == process) {
+            auto l = previous->find(mi.begin);
+            if (l && l.module->begin == mi.begin && l.module->end == mi.end && l.module->name == mi.name)
+                loaded = l.module;
+        }
+
+        if (loaded != nullptr) {
+            auto sections = previous->sections(*loaded);
+            index->_sections.insert(index->_sections.end(), sections.begin(), sections.end());
+        } else {
+            ::rmm::module m(process, mi.name, mi.begin, mi.end);
+            for (auto &s : m.sections())
+                index->_sections.push_back({ s.first, s.second.begin(), s.second.end() });
+            std::sort(index->_sections.begin() + entry.first_section, index->_sections.end(), [](const section_entry &a, const section_entry &b) {
+                return a.begin < b.begin;
+            });
+        }
+        entry.section_count = index->_sections.size() - entry.first_section;
+        index->_modules.push_back(std::move(entry));
+    }
+
+    index->_by_name.resize(index->_modules.size());
+    for (size_t i = 0; i < index->_by_name.size(); i++)
+        index->_by_name[i] = i;
+    std::stable_sort(index->_by_name.begin(), index->_by_name.end(), [&](size_t a, size_t b) {
+        return index->_modules[a].name < index->_modules[b].name;
+    });
+
+    return index;
+}
+
+module_index::view<module_index::section_entry> module_index::sections(const module_entry &module) const {
+    auto first = _sections.data() + module.first_section;
+    return { first, first + module.section_count };
+}
+
+module_index::location module_index::find(uintptr_t address) const {
+    location result{ nullptr, nullptr, 0 };
+
+    auto m = std::upper_bound(_modules.begin(), _modules.end(), address, [](uintptr_t address, const module_entry &m) {
+        return address < m.begin;
+    });
+    if (m == _modules.begin() || address >= (--m)->end)
+        return result;
+    result.module = &*m;
+    result.rva = address - m->begin;
+
+    auto sections = this->sections(*m);
+    auto s = std::upper_bound(sections.begin(), sections.end(), address, [](uintptr_t address, const section_entry &s) {
+        return address < s.begin;
+    });
+    if (s != sections.begin() && address < (s - 1)->end)
+        result.section = s - 1;
+    return result;
+}
+
+const module_index::module_entry* module_index::find(const std::wstring &name) const {
+    auto it = std::lower_bound(_by_name.begin(), _by_name.end(), name, [&](size_t i, const std::wstring &name) {
+        return _modules[i].name < name;
+    });
+    if (it == _by_name.end() || _modules[*it].name != name)
+        return nullptr;
+    return &_modules[*it];
+}
+
+const module_index::section_entry* module_index::find_section(const module_entry &module, const std::string &name) const {
+    for (auto &s : sections(module)) {
+        if (s.name == name)
+            return &s;
+    }
+    return nullptr;
+}
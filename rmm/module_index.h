@@ -0,0 +1,76 @@
+#pragma once
+
+#include "typedefs.h"
+#include "platform.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace rmm {
+
+    // Immutable snapshot of the modules of a process and their sections, sorted by address.
+    // Address lookups and lookups by name are binary searches; results point into the snapshot,
+    // which stays alive as long as a std::shared_ptr to it does.
+    // A new snapshot is built from the previous one re-reading only the sections of modules which were (re)loaded.
+    class module_index {
+    public:
+        template<typename T>
+        class view {
+        public:
+            view(const T *begin, const T *end)
+                : _begin(begin)
+                , _end(end)
+            {}
+            inline const T* begin() const { return _begin; }
+            inline const T* end() const { return _end; }
+            inline size_t size() const { return _end - _begin; }
+            inline bool empty() const { return _begin == _end; }
+            inline const T& operator[](size_t i) const { return _begin[i]; }
+        private:
+            const T *_begin;
+            const T *_end;
+        };
+
+        struct section_entry {
+            std::string name;
+            uintptr_t begin;
+            uintptr_t end;
+        };
+
+        struct module_entry {
+            std::wstring name;
+            uintptr_t begin;
+            uintptr_t end;
+            size_t first_section;
+            size_t section_count;
+        };
+
+        struct location {
+            const module_entry *module;   // nullptr if the address is not within a module
+            const section_entry *section; // nullptr if not within a section (e.g. headers)
+            uintptr_t rva;
+            explicit operator bool() const { return module != nullptr; }
+        };
+
+        static std::shared_ptr<const module_index> build(HANDLE process, const module_index *previous = nullptr);
+
+        inline HANDLE process() const { return _process; }
+        inline view<module_entry> modules() const { return { _modules.data(), _modules.data() + _modules.size() }; }
+        view<section_entry> sections(const module_entry &module) const;
+
+        location find(uintptr_t address) const;
+        // Module named `name` (the first one, if there are several), nullptr if none.
+        const module_entry* find(const std::wstring &name) const;
+        const section_entry* find_section(const module_entry &module, const std::string &name) const;
+
+    private:
+        explicit module_index(HANDLE process);
+
+        HANDLE _process;
+        std::vector<module_entry> _modules;
+        std::vector<section_entry> _sections;
+        std::vector<size_t> _by_name;
+    };
+
+}
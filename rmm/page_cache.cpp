@@ -0,0 +1,165 @@
+#include "page_cache.h"
+
+#include <cstring>
+#include <shared_mutex>
+
+using namespace rmm;
+
+namespace {
+
+    std::shared_mutex attached_mutex;
+    std::unordered_map<HANDLE, std::shared_ptr<page_cache>> attached;
+    std::atomic<size_t> attached_count{ 0 };
+
+}
+
+page_cache::page_cache(HANDLE process, size_t capacity, clock::duration ttl)
+    : _process(process)
+    , _page_size(backend::of(process).page_size())
+    , _capacity(capacity != 0 ? capacity : 1)
+    , _ttl(ttl)
+{}
+
+bool page_cache::fresh(const page &page) const {
+    if (page.epoch != _epoch.load(std::memory_order_acquire))
+        return false;
+    auto ttl = _ttl.load(std::memory_order_relaxed);
+    if (ttl != clock::duration::zero() && clock::now() - page.fetched > ttl)
+        return false;
+    return true;
+}
+
+std::error_code page_cache::read(uintptr_t address, void *buffer, size_t size) {
+    auto out = (char*)buffer;
+    while (size != 0) {
+        auto base = address & ~(uintptr_t)(_page_size - 1);
+        auto offset = (size_t)(address - base);
+        auto n = _page_size - offset;
+        if (n > size)
+            n = size;
+        if (auto ec = read_page(base, offset, out, n))
+            return ec;
+        address += n;
+        out += n;
+        size -= n;
+    }
+    return {};
+}
+
+std::error_code page_cache::read_page(uintptr_t base, size_t offset, void *buffer, size_t size) {
+    uint64_t writes;
+    {
+        std::lock_guard lock(_mutex);
+        auto it = _pages.find(base);
+        if (it != _pages.end() && fresh(it->second)) {
+            std::memcpy(buffer, it->second.data.get() + offset, size);
+            _lru.splice(_lru.begin(), _lru, it->second.use);
+            _hits.fetch_add(1, std::memory_order_relaxed);
+            return {};
+        }
+        writes = _writes;
+    }
+
+    _misses.fetch_add(1, std::memory_order_relaxed);
+
+    // the page is fetched without holding the lock
+    page fetched;
+    fetched.epoch = _epoch.load(std::memory_order_acquire);
+    fetched.fetched = clock::now();
+    fetched.data = std::make_unique<char[]>(_page_size);
+    if (auto ec = backend::of(_process).read(_process, base, fetched.data.get(), _page_size))
+        return ec;
+    std::memcpy(buffer, fetched.data.get() + offset, size);
+
+    std::lock_guard lock(_mutex);
+    if (_writes != writes)
+        return {};
+    auto it = _pages.find(base);
+    if (it == _pages.end()) {
+        if (_pages.size() >= _capacity) {
+            _pages.erase(_lru.back());
+            _lru.pop_back();
+        }
+        _lru.push_front(base);
+        fetched.use = _lru.begin();
+        _pages.emplace(base, std::move(fetched));
+    } else {
+        _lru.splice(_lru.begin(), _lru, it->second.use);
+        fetched.use = it->second.use;
+        it->second = std::move(fetched);
+    }
+    return {};
+}
+
+void page_cache::update(uintptr_t address, const void *buffer, size_t size) {
+    auto in = (const char*)buffer;
+    std::lock_guard lock(_mutex);
+    _writes++;
+    while (size != 0) {
+        auto base = address & ~(uintptr_t)(_page_size - 1);
+        auto offset = (size_t)(address - base);
+        auto n = _page_size - offset;
+        if (n > size)
+            n = size;
+        if (auto it = _pages.find(base); it != _pages.end())
+            std::memcpy(it->second.data.get() + offset, in, n);
+        address += n;
+        in += n;
+        size -= n;
+    }
+}
+
+void page_cache::invalidate(uintptr_t address, size_t size) {
+    if (size == 0)
+        return;
+    auto begin = address & ~(uintptr_t)(_page_size - 1);
+    auto end = address + size;
+    std::lock_guard lock(_mutex);
+    _writes++;
+    for (auto base = begin; base < end && base >= begin; base += _page_size) {
+        if (auto it = _pages.find(base); it != _pages.end()) {
+            _lru.erase(it->second.use);
+            _pages.erase(it);
+        }
+    }
+}
+
+void page_cache::clear() {
+    std::lock_guard lock(_mutex);
+    _writes++;
+    _pages.clear();
+    _lru.clear();
+}
+
+void page_cache::reset_counters() {
+    _hits.store(0, std::memory_order_relaxed);
+    _misses.store(0, std::memory_order_relaxed);
+}
+
+size_t page_cache::size() const {
+    std::lock_guard lock(_mutex);
+    return _pages.size();
+}
+
+std::shared_ptr<page_cache> page_cache::attach(HANDLE process, size_t capacity, clock::duration ttl) {
+    auto cache = std::make_shared<page_cache>(process, capacity, ttl);
+    std::unique_lock lock(attached_mutex);
+    attached[process] = cache;
+    attached_count.store(attached.size(), std::memory_order_release);
+    return cache;
+}
+
+void page_cache::detach(HANDLE process) {
+    std::unique_lock lock(attached_mutex);
+    attached.erase(process);
+    attached_count.store(attached.size(), std::memory_order_release);
+}
+
+std::shared_ptr<page_cache> page_cache::of(HANDLE process) {
+    if (attached_count.load(std::memory_order_acquire) == 0)
+        return nullptr;
+    std::shared_lock lock(attached_mutex);
+    if (auto it = attached.find(process); it != attached.end())
+        return it->second;
+    return nullptr;
+}
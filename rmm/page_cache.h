@@ -0,0 +1,89 @@
+#pragma once
+
+#include "typedefs.h"
+#include "platform.h"
+#include "backend.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <unordered_map>
+
+namespace rmm {
+
+    // Read-through cache of remote memory with page granularity.
+    // A miss fetches the whole page, subsequent reads of the page are served locally.
+    // Cached pages expire when the epoch is advanced (e.g. once per frame) or, if a TTL is set, when they get older than it.
+    //
+    // Once attached to a process, pointer::operator>>, pointer::operator* and pointer::remote_value of that process
+    // read through the cache, and writes made through pointer::operator<< are applied to the cached pages.
+    class page_cache {
+    public:
+        typedef std::chrono::steady_clock clock;
+
+        static constexpr size_t default_capacity = 4096; // pages
+
+        explicit page_cache(HANDLE process, size_t capacity = default_capacity, clock::duration ttl = clock::duration::zero());
+
+        std::error_code read(uintptr_t address, void *buffer, size_t size);
+        // Applies a write made to the process to the cached pages.
+        void update(uintptr_t address, const void *buffer, size_t size);
+        // Drops the cached pages spanning [address, address + size).
+        void invalidate(uintptr_t address, size_t size);
+        // Drops every cached page.
+        void clear();
+
+        // Starts a new epoch, pages cached during previous epochs are refetched on next use.
+        inline void advance() { _epoch.fetch_add(1, std::memory_order_acq_rel); }
+        inline uint64_t epoch() const { return _epoch.load(std::memory_order_acquire); }
+
+        // Zero TTL means pages expire only with the epoch.
+        inline clock::duration ttl() const { return _ttl.load(std::memory_order_relaxed); }
+        inline void set_ttl(clock::duration ttl) { _ttl.store(ttl, std::memory_order_relaxed); }
+
+        inline uint64_t hits() const { return _hits.load(std::memory_order_relaxed); }
+        inline uint64_t misses() const { return _misses.load(std::memory_order_relaxed); }
+        void reset_counters();
+
+        // Number of cached pages.
+        size_t size() const;
+
+        // Routes reads of `process` through a (new) page cache and returns it.
+        static std::shared_ptr<page_cache> attach(HANDLE process, size_t capacity = default_capacity, clock::duration ttl = clock::duration::zero());
+        static void detach(HANDLE process);
+        // Page cache attached to `process`, nullptr if none.
+        static std::shared_ptr<page_cache> of(HANDLE process);
+
+    private:
+        struct page {
+            std::unique_ptr<char[]> data;
+            uint64_t epoch;
+            clock::time_point fetched;
+            std::list<uintptr_t>::iterator use;
+        };
+
+        bool fresh(const page &page) const;
+        std::error_code read_page(uintptr_t base, size_t offset, void *buffer, size_t size);
+
+        HANDLE _process;
+        size_t _page_size;
+        size_t _capacity;
+        std::atomic<clock::duration> _ttl;
+
+        mutable std::mutex _mutex;
+        std::unordered_map<uintptr_t, page> _pages;
+        // page bases, most recently used first
+        std::list<uintptr_t> _lru;
+        // bumped by update, invalidate and clear: a page fetched meanwhile may predate a write and is not kept
+        uint64_t _writes = 0;
+
+        std::atomic<uint64_t> _epoch{ 0 };
+        std::atomic<uint64_t> _hits{ 0 };
+        std::atomic<uint64_t> _misses{ 0 };
+    };
+
+}
@@ -0,0 +1,202 @@
+#include "patch_set.h"
+#include "backend.h"
+#include "batch.h"
+#include "region_map.h"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+
+using namespace rmm;
+
+namespace {
+
+    inline bool writable(DWORD protect) {
+        return (protect & (PAGE_READWRITE | PAGE_WRITECOPY | PAGE_EXECUTE_READWRITE | PAGE_EXECUTE_WRITECOPY)) != 0;
+    }
+
+}
+
+patch_set::patch_set(HANDLE process)
+    : _process(process)
+{}
+
+void patch_set::add(uintptr_t address, const void *data, size_t size) {
+    if (_applied)
+        throw std::logic_error("patch set is applied");
+    if (size == 0)
+        return;
+    _patches.push_back({ address, _data.size(), size });
+    _data.insert(_data.end(), (const char*)data, (const char*)data + size);
+    _built = false;
+}
+
+void patch_set::redirect_call(uintptr_t dest, uintptr_t src) {
+    const byte asm_instr_call = 0xE8;
+
+    pointer psrc(_process, src);
+    if (psrc.value<byte>() != asm_instr_call) {
+        throw std::runtime_error("source is not 'call' instruction");
+    }
+
+    ++psrc;
+    add(psrc, DWORD(dest - psrc - 5 + 1));
+}
+
+size_t patch_set::spans() const {
+    const_cast<patch_set*>(this)->build();
+    return _spans.size();
+}
+
+void patch_set::clear() {
+    if (_applied)
+        throw std::logic_error("patch set is applied");
+    _patches.clear();
+    _data.clear();
+    _spans.clear();
+    _built = false;
+}
+
+void patch_set::build() {
+    if (_built)
+        return;
+    _spans.clear();
+
+    std::vector<size_t> order(_patches.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return _patches[a].address < _patches[b].address;
+    });
+    for (auto i : order) {
+        auto &p = _patches[i];
+        if (!_spans.empty() && p.address <= _spans.back().end)
+            _spans.back().end = (std::max)(_spans.back().end, p.address + p.size);
+        else
+            _spans.push_back({ p.address, p.address + p.size, {}, {} });
+    }
+
+    // patches are laid over their span in the order they were added
+    for (auto &s : _spans)
+        s.patched.resize(s.end - s.begin);
+    for (auto &p : _patches) {
+        auto s = std::upper_bound(_spans.begin(), _spans.end(), p.address, [](uintptr_t address, const span &s) {
+            return address < s.begin;
+        }) - 1;
+        std::memcpy(s->patched.data() + (p.address - s->begin), _data.data() + p.offset, p.size);
+    }
+
+    _built = true;
+}
+
+void patch_set::unprotect(std::vector<protection> &changed) const {
+    auto page_size = backend::of(_process).page_size();
+    auto map = region_map::of(_process);
+
+    // runs of pages touched by the spans
+    std::vector<std::pair<uintptr_t, uintptr_t>> runs;
+    for (auto &s : _spans) {
+        auto begin = s.begin & ~(uintptr_t)(page_size - 1);
+        auto end = (s.end + page_size - 1) & ~(uintptr_t)(page_size - 1);
+        if (!runs.empty() && begin <= runs.back().second)
+            runs.back().second = (std::max)(runs.back().second, end);
+        else
+            runs.emplace_back(begin, end);
+    }
+
+    try {
+        for (auto &run : runs) {
+            auto regions = map ? map->regions(run.first, run.second) : backend::of(_process).regions(_process, run.first, run.second);
+            for (auto &ri : regions) {
+                if (writable(ri.protect))
+                    continue;
+                DWORD old_prot;
+                pointer(_process, ri.begin).protect(ri.end - ri.begin, PAGE_EXECUTE_READWRITE, &old_prot);
+                changed.push_back({ ri.begin, ri.end, old_prot });
+            }
+        }
+    } catch (...) {
+        restore(changed);
+        throw;
+    }
+}
+
+std::error_code patch_set::restore(const std::vector<protection> &changed) const {
+    std::error_code result;
+    for (auto &c : changed) {
+        try {
+            pointer(_process, c.begin).protect(c.end - c.begin, c.old_prot);
+        } catch (const std::system_error &e) {
+            if (!result)
+                result = e.code();
+        }
+    }
+    return result;
+}
+
+std::error_code patch_set::write(bool patched) {
+    std::vector<batch_entry> entries;
+    entries.reserve(_spans.size());
+    for (auto &s : _spans)
+        entries.emplace_back(pointer(_process, s.begin), (patched ? s.patched : s.original).data(), s.end - s.begin);
+    if (write_batch(entries) == 0)
+        return {};
+
+    std::error_code result;
+    std::vector<batch_entry> undo;
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (entries[i].status) {
+            if (!result)
+                result = entries[i].status;
+            continue;
+        }
+        auto &s = _spans[i];
+        undo.emplace_back(pointer(_process, s.begin), (patched ? s.original : s.patched).data(), s.end - s.begin);
+    }
+    write_batch(undo);
+    return result;
+}
+
+void patch_set::apply() {
+    if (_applied)
+        return;
+    build();
+
+    std::vector<batch_entry> entries;
+    entries.reserve(_spans.size());
+    for (auto &s : _spans) {
+        s.original.resize(s.end - s.begin);
+        entries.emplace_back(pointer(_process, s.begin), s.original.data(), s.end - s.begin);
+    }
+    if (read_batch(entries) != 0) {
+        for (auto &e : entries) {
+            if (e.status)
+                throw std::system_error(e.status);
+        }
+    }
+
+    std::vector<protection> changed;
+    unprotect(changed);
+    auto ec = write(true);
+    auto restored = restore(changed);
+    if (ec)
+        throw std::system_error(ec);
+    _applied = true;
+    if (restored)
+        throw std::system_error(restored);
+}
+
+void patch_set::revert() {
+    if (!_applied)
+        return;
+
+    std::vector<protection> changed;
+    unprotect(changed);
+    auto ec = write(false);
+    auto restored = restore(changed);
+    if (ec)
+        throw std::system_error(ec);
+    _applied = false;
+    if (restored)
+        throw std::system_error(restored);
+}
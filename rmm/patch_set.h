@@ -0,0 +1,79 @@
+#pragma once
+
+#include "typedefs.h"
+#include "platform.h"
+#include "pointer.h"
+
+#include <system_error>
+#include <vector>
+
+namespace rmm {
+
+    // Set of writes applied (and reverted) as a whole.
+    // Overlapping and adjacent patches are merged into spans, each written at once,
+    // and protection is changed once per run of pages with the same protection
+    // (writable pages are left alone). Original bytes are saved when the set is applied.
+    // If any write fails, the spans already written are restored and std::system_error is thrown.
+    class patch_set {
+    public:
+        explicit patch_set(HANDLE process);
+
+        // Later patches take precedence over earlier ones they overlap.
+        void add(uintptr_t address, const void *data, size_t size);
+
+        template<typename T>
+        inline void add(pointer ptr, const T &value) {
+            add(ptr, &value, sizeof(T));
+        }
+
+        // Patches the CALL instruction at `src` to call `dest` (see memory::redirect_call).
+        void redirect_call(uintptr_t dest, uintptr_t src);
+
+        inline HANDLE process() const { return _process; }
+        inline bool applied() const { return _applied; }
+        // Number of patches and of the spans they have been merged into.
+        inline size_t size() const { return _patches.size(); }
+        size_t spans() const;
+
+        void apply();
+        // Restores the original bytes.
+        void revert();
+        // Drops all patches (the set must not be applied).
+        void clear();
+
+    private:
+        struct patch {
+            uintptr_t address;
+            size_t offset;  // in `_data`
+            size_t size;
+        };
+
+        struct span {
+            uintptr_t begin;
+            uintptr_t end;
+            std::vector<char> patched;
+            std::vector<char> original;
+        };
+
+        struct protection {
+            uintptr_t begin;
+            uintptr_t end;
+            DWORD old_prot;
+        };
+
+        void build();
+        void unprotect(std::vector<protection> &changed) const;
+        std::error_code restore(const std::vector<protection> &changed) const;
+        // Writes the patched (or original) bytes of every span. If any write fails,
+        // the other bytes are written back to the spans which succeeded and the first error is returned.
+        std::error_code write(bool patched);
+
+        HANDLE _process;
+        std::vector<patch> _patches;
+        std::vector<char> _data;
+        std::vector<span> _spans;
+        bool _built = false;
+        bool _applied = false;
+    };
+
+}
@@ -1,7 +1,6 @@
 #include "pointer.h"
 #include "memory.h"
-
-#include <Windows.h>
+#include "region_map.h"
 
 using namespace rmm;
 
@@ -17,34 +16,40 @@ pointer::pointer(HANDLE process, void *pointer)
 
 DWORD pointer::protect(size_t size, DWORD new_prot, DWORD *old_prot) {
     DWORD dwOldProt;
-    if(!VirtualProtectEx(_process, *this, size, new_prot, &dwOldProt))
-        throw std::system_error(GetLastError(), std::system_category());
+    if (auto ec = backend::of(_process).protect(_process, ptr, size, new_prot, dwOldProt))
+        throw std::system_error(ec);
+    if (auto map = region_map::of(_process))
+        map->set_protection(ptr, size, new_prot);
     if(old_prot != nullptr)
         *old_prot = dwOldProt;
     return dwOldProt;
 }
 
 DWORD pointer::get_protection() const {
-    MEMORY_BASIC_INFORMATION mi;
-    if (!VirtualQueryEx(_process, *this, &mi, sizeof(mi)))
-        throw std::system_error(GetLastError(), std::system_category());
-    return mi.Protect;
+    if (auto map = region_map::of(_process))
+        return map->protection(ptr);
+    region_info ri;
+    if (auto ec = backend::of(_process).query(_process, ptr, ri))
+        throw std::system_error(ec);
+    return ri.protect;
 }
 
 bool pointer::is_valid(size_t size) const {
-    MEMORY_BASIC_INFORMATION mi;
+    if (auto map = region_map::of(_process))
+        return map->is_valid(ptr, size);
+    region_info ri;
 
-    if(VirtualQueryEx(_process, *this, &mi, sizeof(mi)) == 0)
+    if(backend::of(_process).query(_process, ptr, ri))
         return false;
 
-    if(mi.State != MEM_COMMIT)
+    if(ri.state != MEM_COMMIT)
         return false;
 
-    if(mi.Protect == PAGE_NOACCESS)
+    if(ri.protect == PAGE_NOACCESS)
         return false;
 
     auto ptr_end = ptr + size;
-    auto reg_end = pointer(_process, (uintptr_t)mi.BaseAddress + mi.RegionSize);
+    auto reg_end = pointer(_process, ri.end);
     if(ptr_end > reg_end)
         return reg_end.is_valid(ptr_end - reg_end);
 
@@ -52,9 +57,23 @@ bool pointer::is_valid(size_t size) const {
 }
 
 pointer pointer::operator*() const {
+    uintptr_t p = 0;
+    if (auto cache = page_cache::of(_process)) {
+        // a successful read is as good as a validity check
+        statistics::add(statistics::pointer_reads);
+        if (cache->read(ptr, &p, sizeof(p)))
+            throw std::runtime_error("invalid pointer");
+        return pointer(_process, p);
+    }
     if(!is_valid())
         throw std::runtime_error("invalid pointer");
-    uintptr_t p = 0;
     *this >> p;
     return pointer(_process, p);
 }
+
+std::error_code pointer::read(void *buffer, size_t size) const {
+    statistics::add(statistics::pointer_reads);
+    if (auto cache = page_cache::of(_process))
+        return cache->read(ptr, buffer, size);
+    return backend::of(_process).read(_process, ptr, buffer, size);
+}
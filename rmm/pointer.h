@@ -1,9 +1,14 @@
 #pragma once
 
-#include <Windows.h>
-
 #include "typedefs.h"
-
+#include "platform.h"
+#include "backend.h"
+#include "page_cache.h"
+#include "statistics.h"
+
+#include <cstddef>
+#include <stdexcept>
+#include <system_error>
 #include <type_traits>
 
 namespace rmm {
@@ -48,8 +53,8 @@ namespace rmm {
         inline pointer operator++() { ++ptr; return *this; }
         inline pointer operator++(int) { return { _process, ptr++ }; }
 
-        inline bool operator==(nullptr_t rhs) const { return ptr == 0; }
-        inline bool operator!=(nullptr_t rhs) const { return ptr != 0; }
+        inline bool operator==(std::nullptr_t rhs) const { return ptr == 0; }
+        inline bool operator!=(std::nullptr_t rhs) const { return ptr != 0; }
 
         template<
             typename T,
@@ -102,39 +107,30 @@ namespace rmm {
 
         template<typename T>
         inline pointer operator<<(const T &src) {
+            statistics::add(statistics::pointer_writes);
             auto old_prot = protect(sizeof(T), PAGE_EXECUTE_READWRITE);
-            if (!WriteProcessMemory(_process, *this, &src, sizeof(T), NULL))
-                throw std::system_error(GetLastError(), std::system_category());
+            if (auto ec = backend::of(_process).write(_process, ptr, &src, sizeof(T)))
+                throw std::system_error(ec);
+            if (auto cache = page_cache::of(_process))
+                cache->update(ptr, &src, sizeof(T));
             protect(sizeof(T), old_prot);
             return *this + sizeof(T);
         }
 
         template<typename T>
-        inline pointer operator>>(T &dest) {
-            if (!ReadProcessMemory(_process, *this, &dest, sizeof(T), NULL))
-                throw std::system_error(GetLastError(), std::system_category());
+        inline pointer operator>>(T &dest) const {
+            if (auto ec = read(&dest, sizeof(T)))
+                throw std::system_error(ec);
             return *this + sizeof(T);
         }
 
         static constexpr size_t size() { return sizeof(uintptr_t); }
 
+        // Reads `size` bytes without throwing (through the page cache, if one is attached).
+        std::error_code read(void *buffer, size_t size) const;
+
         template<typename T>
-        struct remote_value {
-            remote_value(pointer ptr)
-                : ptr(ptr)
-            {}
-            inline operator T() const {
-                T value{};
-                ptr >> value;
-                return value;
-            }
-            inline T operator=(T value) {
-                ptr << value;
-                return value;
-            }
-        private:
-            pointer ptr;
-        };
+        struct remote_value;
 
         template<typename T>
         inline remote_value<T> value() const {
@@ -146,6 +142,24 @@ namespace rmm {
         HANDLE _process;
     };
 
+    template<typename T>
+    struct pointer::remote_value {
+        remote_value(pointer ptr)
+            : ptr(ptr)
+        {}
+        inline operator T() const {
+            T value{};
+            ptr >> value;
+            return value;
+        }
+        inline T operator=(T value) {
+            ptr << value;
+            return value;
+        }
+    private:
+        pointer ptr;
+    };
+
     template<>
     inline pointer::operator void*() const {
         return (void*)ptr;
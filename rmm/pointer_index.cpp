@@ -0,0 +1,146 @@
+#include "pointer_index.h"
+#include "backend.h"
+#include "region_reader.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_set>
+
+using namespace rmm;
+
+pointer_index::pointer_index(const memory &memory, size_t alignment)
+    : _memory(memory)
+    , _alignment(alignment)
+{
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0)
+        throw std::invalid_argument("alignment must be a power of two");
+    build();
+}
+
+void pointer_index::build() {
+    _references.clear();
+
+    // every readable region of the process is a valid target, not only those within `_memory`
+    auto process = _memory.begin().process();
+    auto targets = memory(process).regions();
+    if (targets.empty())
+        return;
+
+    // adjacent regions are merged, so that most lookups end at the first comparison
+    std::vector<std::pair<uintptr_t, uintptr_t>> ranges;
+    for (auto &t : targets) {
+        if (!ranges.empty() && ranges.back().second == t.begin())
+            ranges.back().second = t.end();
+        else
+            ranges.emplace_back(t.begin(), t.end());
+    }
+    auto lowest = ranges.front().first;
+    auto highest = ranges.back().second;
+
+    region_reader reader(process, _memory.scan_budget());
+    for (auto &region : _memory.regions()) {
+        reader.forward(region.begin(), region.end(), sizeof(uintptr_t) - 1, [&](uintptr_t address, const char *data, size_t size) {
+            auto last = ranges.begin();
+            // values starting in the overlap are left for the next chunk
+            auto p = (size_t)(((address + _alignment - 1) & ~(uintptr_t)(_alignment - 1)) - address);
+            for (; p + sizeof(uintptr_t) <= size; p += _alignment) {
+                uintptr_t value;
+                std::memcpy(&value, data + p, sizeof(value));
+                if (value < lowest || value >= highest)
+                    continue;
+                if (value < last->first || value >= last->second) {
+                    last = std::upper_bound(ranges.begin(), ranges.end(), value, [](uintptr_t value, const std::pair<uintptr_t, uintptr_t> &range) {
+                        return value < range.second;
+                    });
+                    if (last == ranges.end() || value < last->first) {
+                        last = ranges.begin();
+                        continue;
+                    }
+                }
+                _references.push_back({ value, address + p });
+            }
+            return true;
+        });
+    }
+
+    std::sort(_references.begin(), _references.end(), [](const reference &a, const reference &b) {
+        return a.value < b.value || (a.value == b.value && a.address < b.address);
+    });
+}
+
+std::vector<pointer_index::reference>::const_iterator pointer_index::lower_bound(uintptr_t value) const {
+    return std::lower_bound(_references.begin(), _references.end(), value, [](const reference &r, uintptr_t value) {
+        return r.value < value;
+    });
+}
+
+std::vector<uintptr_t> pointer_index::find(uintptr_t value) const {
+    std::vector<uintptr_t> addresses;
+    for (auto it = lower_bound(value); it != _references.end() && it->value == value; ++it)
+        addresses.push_back(it->address);
+    return addresses;
+}
+
+std::vector<pointer_index::reference> pointer_index::find(uintptr_t begin, uintptr_t end) const {
+    std::vector<reference> references;
+    for (auto it = lower_bound(begin); it != _references.end() && it->value < end; ++it)
+        references.push_back(*it);
+    return references;
+}
+
+std::vector<pointer_path> pointer_index::scan(uintptr_t target, size_t max_depth, size_t max_offset, size_t limit) const {
+    auto process = _memory.begin().process();
+    auto modules = backend::of(process).modules(process);
+    std::sort(modules.begin(), modules.end(), [](const module_info &a, const module_info &b) {
+        return a.begin < b.begin;
+    });
+
+    // chains are kept as a tree, each node pointing `offset` bytes below its parent
+    struct node {
+        uintptr_t address;
+        size_t parent;
+        uintptr_t offset;
+    };
+    const size_t root = SIZE_MAX;
+    std::vector<node> nodes;
+    std::vector<size_t> level, next_level;
+    std::unordered_set<uintptr_t> visited;
+    std::vector<pointer_path> paths;
+
+    auto expand = [&](uintptr_t address, size_t parent, size_t depth) {
+        auto low = address >= max_offset ? address - max_offset : 0;
+        for (auto it = lower_bound(low); it != _references.end() && it->value <= address; ++it) {
+            if (paths.size() >= limit)
+                return;
+            if (!visited.insert(it->address).second)
+                continue;
+            nodes.push_back({ it->address, parent, address - it->value });
+
+            auto m = std::upper_bound(modules.begin(), modules.end(), it->address, [](uintptr_t address, const module_info &mi) {
+                return address < mi.begin;
+            });
+            if (m != modules.begin() && it->address < (--m)->end) {
+                std::vector<intptr_t> offsets;
+                for (auto n = nodes.size() - 1; n != root; n = nodes[n].parent)
+                    offsets.push_back((intptr_t)nodes[n].offset);
+                paths.emplace_back(process, m->name, it->address - m->begin, std::move(offsets));
+                continue;
+            }
+            if (depth + 1 < max_depth)
+                next_level.push_back(nodes.size() - 1);
+        }
+    };
+
+    if (max_depth == 0)
+        return paths;
+    expand(target, root, 0);
+    for (size_t depth = 1; depth < max_depth && !next_level.empty() && paths.size() < limit; depth++) {
+        level.swap(next_level);
+        next_level.clear();
+        for (auto n : level)
+            expand(nodes[n].address, n, depth);
+    }
+
+    return paths;
+}
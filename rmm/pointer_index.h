@@ -0,0 +1,48 @@
+#pragma once
+
+#include "typedefs.h"
+#include "pointer.h"
+#include "memory.h"
+#include "pointer_path.h"
+
+#include <vector>
+
+namespace rmm {
+
+    // Reverse index of pointers within `memory`: every aligned pointer-sized value which lands inside a
+    // readable region, along with the address holding it, sorted by value.
+    // Built in a single pass; lookups are binary searches. Rebuild it when memory changes.
+    class pointer_index {
+    public:
+        struct reference {
+            uintptr_t value;
+            uintptr_t address; // holds `value`
+        };
+
+        explicit pointer_index(const memory &memory, size_t alignment = sizeof(uintptr_t));
+
+        void build();
+
+        inline size_t size() const { return _references.size(); }
+        inline const std::vector<reference>& references() const { return _references; }
+
+        // Addresses holding `value`.
+        std::vector<uintptr_t> find(uintptr_t value) const;
+        // References to [begin, end), in ascending order of value.
+        std::vector<reference> find(uintptr_t begin, uintptr_t end) const;
+
+        // Pointer scan: chains of at most `max_depth` levels leading to `target` from a module,
+        // where each level points at most `max_offset` bytes below the next one.
+        // Every address is expanded once (the first time it is reached, i.e. by the shortest chain),
+        // and chains end at the first module they reach. At most `limit` chains are returned.
+        std::vector<pointer_path> scan(uintptr_t target, size_t max_depth, size_t max_offset, size_t limit = SIZE_MAX) const;
+
+    private:
+        std::vector<reference>::const_iterator lower_bound(uintptr_t value) const;
+
+        memory _memory;
+        size_t _alignment;
+        std::vector<reference> _references;
+    };
+
+}
@@ -0,0 +1,159 @@
+#include "pointer_path.h"
+#include "backend.h"
+#include "batch.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+using namespace rmm;
+
+pointer_path::pointer_path(HANDLE process, uintptr_t base, std::vector<intptr_t> offsets)
+    : _process(process)
+    , _base(base)
+    , _offsets(std::move(offsets))
+    , _compiled(true)
+    , _cache_depth(_offsets.size())
+    , _values(_offsets.size())
+{}
+
+pointer_path::pointer_path(HANDLE process, const std::wstring &module, uintptr_t offset, std::vector<intptr_t> offsets)
+    : _process(process)
+    , _module(module)
+    , _base(offset)
+    , _offsets(std::move(offsets))
+    , _compiled(false)
+    , _cache_depth(_offsets.size())
+    , _values(_offsets.size())
+{}
+
+bool pointer_path::compile() {
+    if (!_compiled)
+        compile({ this });
+    return _compiled;
+}
+
+void pointer_path::compile(const std::vector<pointer_path*> &paths) {
+    std::unordered_map<HANDLE, std::vector<module_info>> modules;
+    for (auto path : paths) {
+        if (path->_compiled)
+            continue;
+        auto it = modules.find(path->_process);
+        if (it == modules.end())
+            it = modules.emplace(path->_process, backend::of(path->_process).modules(path->_process)).first;
+        for (auto &mi : it->second) {
+            if (mi.name == path->_module) {
+                path->_base += mi.begin;
+                path->_compiled = true;
+                break;
+            }
+        }
+    }
+}
+
+void pointer_path::set_cache_depth(size_t depth) {
+    _cache_depth = (std::min)(depth, _offsets.size());
+    if (_cached > _cache_depth)
+        _cached = _cache_depth;
+}
+
+void pointer_path::invalidate(size_t level) {
+    if (_cached > level)
+        _cached = level;
+}
+
+uintptr_t pointer_path::address(size_t level) const {
+    if (level == 0)
+        return _base;
+    return _values[level - 1] + _offsets[level - 1];
+}
+
+bool pointer_path::store(size_t level, uintptr_t value) {
+    if (value == 0) {
+        invalidate(level);
+        return false;
+    }
+    _values[level] = value;
+    if (level == _cached && level < _cache_depth)
+        _cached = level + 1;
+    return true;
+}
+
+pointer pointer_path::resolve() {
+    if (!compile())
+        return pointer(_process, nullptr);
+
+    for (auto level = _cached; level < _offsets.size(); level++) {
+        uintptr_t value = 0;
+        if (pointer(_process, address(level)).read(&value, sizeof(value))) {
+            invalidate(level);
+            return pointer(_process, nullptr);
+        }
+        if (!store(level, value))
+            return pointer(_process, nullptr);
+    }
+    return pointer(_process, address(_offsets.size()));
+}
+
+std::vector<pointer> pointer_path::resolve(const std::vector<pointer_path*> &paths) {
+    compile(paths);
+
+    std::vector<pointer> results;
+    results.reserve(paths.size());
+    // paths which are still being resolved
+    std::vector<size_t> pending;
+    size_t depth = 0;
+    for (size_t i = 0; i < paths.size(); i++) {
+        results.emplace_back(paths[i]->_process, nullptr);
+        if (paths[i]->_compiled) {
+            pending.push_back(i);
+            depth = (std::max)(depth, paths[i]->_offsets.size());
+        }
+    }
+
+    std::vector<uintptr_t> values;
+    std::vector<batch_entry> entries;
+    std::vector<size_t> reading;
+    for (size_t level = 0; level <= depth && !pending.empty(); level++) {
+        entries.clear();
+        reading.clear();
+        values.assign(pending.size(), 0);
+
+        size_t kept = 0;
+        for (auto i : pending) {
+            auto path = paths[i];
+            if (level == path->_offsets.size()) {
+                results[i] = pointer(path->_process, path->address(level));
+                continue;
+            }
+            pending[kept++] = i;
+            if (level < path->_cached)
+                continue;
+            reading.push_back(i);
+            entries.emplace_back(pointer(path->_process, path->address(level)), values[entries.size()]);
+        }
+        pending.resize(kept);
+
+        if (entries.empty())
+            continue;
+        read_batch(entries);
+
+        kept = 0;
+        size_t k = 0;
+        for (auto i : pending) {
+            if (k < reading.size() && reading[k] == i) {
+                auto path = paths[i];
+                auto ok = !entries[k].status;
+                if (!ok)
+                    path->invalidate(level);
+                ok = ok && path->store(level, values[k]);
+                k++;
+                if (!ok)
+                    continue;
+            }
+            pending[kept++] = i;
+        }
+        pending.resize(kept);
+    }
+
+    return results;
+}
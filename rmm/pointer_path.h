@@ -0,0 +1,64 @@
+#pragma once
+
+#include "typedefs.h"
+#include "platform.h"
+#include "pointer.h"
+
+#include <string>
+#include <vector>
+
+namespace rmm {
+
+    // Chain of pointers `[[[base] + offsets[0]] + offsets[1]] ... + offsets[n - 1]`,
+    // i.e. each offset is added to the pointer read at the previous level.
+    // The base may be relative to a module, in which case it is resolved once by `compile`.
+    //
+    // Pointers read at the upper `cache_depth` levels are cached and reused by subsequent resolutions
+    // until `invalidate`d; a level which fails to resolve (unreadable or null) drops itself and the ones below.
+    class pointer_path {
+    public:
+        pointer_path(HANDLE process, uintptr_t base, std::vector<intptr_t> offsets);
+        pointer_path(HANDLE process, const std::wstring &module, uintptr_t offset, std::vector<intptr_t> offsets);
+
+        inline HANDLE process() const { return _process; }
+        inline const std::vector<intptr_t>& offsets() const { return _offsets; }
+        inline size_t levels() const { return _offsets.size(); }
+
+        // Resolves the module base, false if the module is not loaded.
+        bool compile();
+        // Compiles many paths enumerating the modules of each process once.
+        static void compile(const std::vector<pointer_path*> &paths);
+        inline bool compiled() const { return _compiled; }
+
+        // Address the path leads to, nullptr if it cannot be resolved.
+        pointer resolve();
+        // Resolves many paths level by level, reading each level of all paths with a single read_batch.
+        static std::vector<pointer> resolve(const std::vector<pointer_path*> &paths);
+
+        // Number of upper levels which are cached (all of them by default).
+        inline size_t cache_depth() const { return _cache_depth; }
+        void set_cache_depth(size_t depth);
+        // Number of levels currently cached.
+        inline size_t cached() const { return _cached; }
+
+        // Drops cached levels starting from `level`.
+        void invalidate(size_t level = 0);
+
+    private:
+        // Address read at `level` (the base for level 0), given levels above it are cached.
+        uintptr_t address(size_t level) const;
+        // Records `value` read at `level`, false if it breaks the chain.
+        bool store(size_t level, uintptr_t value);
+
+        HANDLE _process;
+        std::wstring _module;
+        uintptr_t _base;
+        std::vector<intptr_t> _offsets;
+        bool _compiled;
+
+        size_t _cache_depth;
+        size_t _cached = 0;
+        std::vector<uintptr_t> _values;
+    };
+
+}
@@ -1,45 +1,29 @@
 #include "process.h"
 
-#include <Psapi.h>
-#include <TlHelp32.h>
-
 using namespace rmm;
 
 HANDLE process::open_by_name(const std::wstring &name) {
     DWORD pid = -1;
 
-    auto hSnapshot = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
-    if (!hSnapshot)
-        throw std::system_error(GetLastError(), std::system_category());
-
-    PROCESSENTRY32 pe;
-    pe.dwSize = sizeof(pe);
-    if (!Process32First(hSnapshot, &pe))
-        throw std::system_error(GetLastError(), std::system_category());
-    do {
-        if (name == name_from_path(pe.szExeFile)) {
+    auto &io = backend::native();
+    for (auto &pi : io.processes()) {
+        if (name == name_from_path(pi.name)) {
             if (pid == -1) {
-                pid = pe.th32ProcessID;
+                pid = pi.id;
             } else {
                 throw std::runtime_error("multiple processes with the same name");
             }
         }
-    } while (Process32Next(hSnapshot, &pe));
-    if (GetLastError() != ERROR_NO_MORE_FILES)
-        throw std::system_error(GetLastError(), std::system_category());
+    }
 
     if (pid == -1)
         throw std::runtime_error("process not found");
 
-    auto hProcess = OpenProcess(PROCESS_ALL_ACCESS, FALSE, pid);
-    if (!hProcess)
-        throw std::system_error(GetLastError(), std::system_category());
-
-    return hProcess;
+    return io.open(pid);
 }
 
-std::wstring process::name_from_path(const std::experimental::filesystem::path &path) {
-    return path.filename();
+std::wstring process::name_from_path(const std::filesystem::path &path) {
+    return path.filename().wstring();
 }
 
 process::process(const std::wstring &name)
@@ -47,27 +31,17 @@ process::process(const std::wstring &name)
 {}
 
 process::~process() {
-    CloseHandle(_process);
+    backend::of(_process).close(_process);
 }
 
-std::unordered_map<std::wstring, module> process::modules() {
-    auto hSnapshot = CreateToolhelp32Snapshot(TH32CS_SNAPMODULE | TH32CS_SNAPMODULE32, GetProcessId(_process));
-    if (!hSnapshot)
-        throw std::system_error(GetLastError(), std::system_category());
-
-    MODULEENTRY32 me;
-    me.dwSize = sizeof(me);
-    if (!Module32First(hSnapshot, &me))
-        throw std::system_error(GetLastError(), std::system_category());
-    do {
+const std::unordered_map<std::wstring, module>& process::modules() {
+    for (auto &mi : backend::of(_process).modules(_process)) {
         _modules.emplace(
             std::piecewise_construct,
-            std::forward_as_tuple(me.szModule),
-            std::forward_as_tuple(_process, me.szModule, (uintptr_t)me.modBaseAddr, (uintptr_t)me.modBaseAddr + me.modBaseSize)
+            std::forward_as_tuple(mi.name),
+            std::forward_as_tuple(_process, mi.name, mi.begin, mi.end)
         );
-    } while (Module32Next(hSnapshot, &me));
-    if (GetLastError() != ERROR_NO_MORE_FILES)
-        throw std::system_error(GetLastError(), std::system_category());
+    }
 
     return _modules;
 }
@@ -92,3 +66,14 @@ module& process::operator[](const std::wstring &name) {
 void process::clear_modules() {
     _modules.clear();
 }
+
+std::shared_ptr<const module_index> process::module_index() {
+    if (!_module_index)
+        _module_index = ::rmm::module_index::build(_process);
+    return _module_index;
+}
+
+std::shared_ptr<const module_index> process::refresh_module_index() {
+    _module_index = ::rmm::module_index::build(_process, _module_index.get());
+    return _module_index;
+}
@@ -1,33 +1,40 @@
 #pragma once
 
+#include "platform.h"
 #include "memory.h"
 #include "module.h"
+#include "module_index.h"
 
-#include <Windows.h>
-
+#include <memory>
 #include <unordered_map>
 #include <filesystem>
 
 namespace rmm {
 
-    // Inheriting from this class you must CloseHandle of `_process` in the destructor,
+    // Inheriting from this class you must close `_process` (see backend::close) in the destructor,
     // because ~process is not virtual.
     class process : public memory {
     public:
         static HANDLE open_by_name(const std::wstring &name);
-        static std::wstring name_from_path(const std::experimental::filesystem::path &path);
+        static std::wstring name_from_path(const std::filesystem::path &path);
 
         process(const std::wstring &name);
         ~process();
 
-        std::unordered_map<std::wstring, ::rmm::module> modules();
+        const std::unordered_map<std::wstring, ::rmm::module>& modules();
         ::rmm::module& module(const std::wstring &name);
         ::rmm::module& operator[](const std::wstring &name);
 
         void clear_modules();
+
+        // Address -> module/section index, built on first use.
+        std::shared_ptr<const ::rmm::module_index> module_index();
+        // Rebuilds the index after modules have been loaded or unloaded (re-reading only the changed ones).
+        std::shared_ptr<const ::rmm::module_index> refresh_module_index();
         
     protected:
         std::unordered_map<std::wstring, ::rmm::module> _modules;
+        std::shared_ptr<const ::rmm::module_index> _module_index;
     };
 
 }
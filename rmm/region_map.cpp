@@ -0,0 +1,185 @@
+#include "region_map.h"
+
+#include <algorithm>
+#include <mutex>
+#include <unordered_map>
+
+using namespace rmm;
+
+namespace {
+
+    std::shared_mutex attached_mutex;
+    std::unordered_map<HANDLE, std::shared_ptr<region_map>> attached;
+    std::atomic<size_t> attached_count{ 0 };
+
+}
+
+region_map::region_map(HANDLE process)
+    : _process(process)
+{}
+
+void region_map::refresh() {
+    _generation.fetch_add(1, std::memory_order_acq_rel);
+    ensure();
+}
+
+void region_map::invalidate() {
+    _generation.fetch_add(1, std::memory_order_acq_rel);
+}
+
+void region_map::ensure() const {
+    if (_built.load(std::memory_order_acquire) == _generation.load(std::memory_order_acquire))
+        return;
+    std::unique_lock lock(_mutex);
+    if (_built.load(std::memory_order_acquire) != _generation.load(std::memory_order_acquire))
+        build();
+}
+
+void region_map::build() const {
+    auto generation = _generation.load(std::memory_order_acquire);
+    auto &io = backend::of(_process);
+    _regions = io.regions(_process, io.min_address(), io.max_address());
+    _built.store(generation, std::memory_order_release);
+}
+
+std::vector<region_info>::const_iterator region_map::lookup(uintptr_t address) const {
+    auto it = std::upper_bound(_regions.begin(), _regions.end(), address, [](uintptr_t address, const region_info &ri) {
+        return address < ri.end;
+    });
+    if (it != _regions.end() && it->begin <= address)
+        return it;
+    return _regions.end();
+}
+
+bool region_map::find(uintptr_t address, region_info &info) const {
+    ensure();
+    std::shared_lock lock(_mutex);
+    auto it = lookup(address);
+    if (it == _regions.end())
+        return false;
+    info = *it;
+    return true;
+}
+
+bool region_map::is_valid(uintptr_t address, size_t size) const {
+    ensure();
+    std::shared_lock lock(_mutex);
+    auto it = lookup(address);
+    if (it == _regions.end())
+        return false;
+
+    auto end = address + size;
+    for (; it != _regions.end(); ++it) {
+        if (it->begin > address) // gap
+            return false;
+        if (it->state != MEM_COMMIT || it->protect == PAGE_NOACCESS)
+            return false;
+        if (it->end >= end)
+            return true;
+        address = it->end;
+    }
+    return false;
+}
+
+DWORD region_map::protection(uintptr_t address) const {
+    region_info ri;
+    if (!find(address, ri))
+        return PAGE_NOACCESS;
+    return ri.protect;
+}
+
+std::vector<region_info> region_map::regions(uintptr_t begin, uintptr_t end) const {
+    ensure();
+    std::shared_lock lock(_mutex);
+    std::vector<region_info> regions;
+    auto it = std::upper_bound(_regions.begin(), _regions.end(), begin, [](uintptr_t address, const region_info &ri) {
+        return address < ri.end;
+    });
+    for (; it != _regions.end() && it->begin < end; ++it) {
+        auto ri = *it;
+        if (ri.begin < begin)
+            ri.begin = begin;
+        if (ri.end > end)
+            ri.end = end;
+        regions.push_back(ri);
+    }
+    return regions;
+}
+
+void region_map::set_protection(uintptr_t address, size_t size, DWORD protect) {
+    std::unique_lock lock(_mutex);
+    if (_built.load(std::memory_order_acquire) != _generation.load(std::memory_order_acquire))
+        return; // rebuilt from scratch on next use anyway
+
+    auto page_size = backend::of(_process).page_size();
+    auto begin = address & ~(uintptr_t)(page_size - 1);
+    auto end = (address + size + page_size - 1) & ~(uintptr_t)(page_size - 1);
+
+    // restoring a protection (as pointer::operator<< does after writing) usually changes nothing
+    bool changes = false;
+    for (auto it = lookup(begin); it != _regions.end() && it->begin < end && !changes; ++it)
+        changes = it->protect != protect;
+    if (!changes)
+        return;
+
+    std::vector<region_info> regions;
+    regions.reserve(_regions.size() + 2);
+    for (auto &ri : _regions) {
+        if (ri.end <= begin || ri.begin >= end) {
+            regions.push_back(ri);
+            continue;
+        }
+        if (ri.begin < begin) {
+            regions.push_back(ri);
+            regions.back().end = begin;
+        }
+        regions.push_back(ri);
+        regions.back().begin = (std::max)(ri.begin, begin);
+        regions.back().end = (std::min)(ri.end, end);
+        regions.back().protect = protect;
+        if (ri.end > end) {
+            regions.push_back(ri);
+            regions.back().begin = end;
+        }
+    }
+
+    // Neighbours left alike around and within the range are joined again, as the system reports them,
+    // so that scans do not treat one region as several (a match never spans two regions).
+    auto alike = [](const region_info &a, const region_info &b) {
+        return a.end == b.begin && a.protect == b.protect && a.allocation_protect == b.allocation_protect
+            && a.state == b.state && a.type == b.type;
+    };
+    std::vector<region_info> merged;
+    merged.reserve(regions.size());
+    for (auto &ri : regions) {
+        if (!merged.empty() && ri.begin >= begin && ri.begin <= end && alike(merged.back(), ri))
+            merged.back().end = ri.end;
+        else
+            merged.push_back(ri);
+    }
+    regions = std::move(merged);
+    _regions = std::move(regions);
+}
+
+std::shared_ptr<region_map> region_map::attach(HANDLE process) {
+    auto map = std::make_shared<region_map>(process);
+    std::unique_lock lock(attached_mutex);
+    attached[process] = map;
+    attached_count.store(attached.size(), std::memory_order_release);
+    return map;
+}
+
+void region_map::detach(HANDLE process) {
+    std::unique_lock lock(attached_mutex);
+    attached.erase(process);
+    attached_count.store(attached.size(), std::memory_order_release);
+}
+
+std::shared_ptr<region_map> region_map::of(HANDLE process) {
+    if (attached_count.load(std::memory_order_acquire) == 0)
+        return nullptr;
+    std::shared_lock lock(attached_mutex);
+    if (auto it = attached.find(process); it != attached.end())
+        return it->second;
+    return nullptr;
+}
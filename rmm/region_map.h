@@ -0,0 +1,62 @@
+#pragma once
+
+#include "typedefs.h"
+#include "platform.h"
+#include "backend.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <vector>
+
+namespace rmm {
+
+    // Snapshot of the address space layout of a process, sorted by address.
+    // Lookups are binary searches over the snapshot and make no syscalls.
+    // `invalidate` marks the snapshot stale (it is rebuilt on next use), `refresh` rebuilds it right away;
+    // both advance `generation`.
+    //
+    // Once attached to a process, memory::regions, memory::is_valid_address, memory::get_protection,
+    // pointer::is_valid and pointer::get_protection of that process are served from the map,
+    // and protection changes made through pointer::protect are applied to it.
+    class region_map {
+    public:
+        explicit region_map(HANDLE process);
+
+        void refresh();
+        void invalidate();
+        inline uint64_t generation() const { return _generation.load(std::memory_order_acquire); }
+
+        // Region containing `address`, false if it is not mapped.
+        bool find(uintptr_t address, region_info &info) const;
+        // [address, address + size) is committed and accessible.
+        bool is_valid(uintptr_t address, size_t size) const;
+        // Protection at `address`, PAGE_NOACCESS if it is not mapped.
+        DWORD protection(uintptr_t address) const;
+        // Regions intersecting [begin, end), clipped to the range.
+        std::vector<region_info> regions(uintptr_t begin, uintptr_t end) const;
+
+        // Records a protection change of the pages spanning [address, address + size).
+        // Regions left with the same attributes as their neighbours are merged with them.
+        void set_protection(uintptr_t address, size_t size, DWORD protect);
+
+        // Routes lookups for `process` through a (new) region map and returns it.
+        static std::shared_ptr<region_map> attach(HANDLE process);
+        static void detach(HANDLE process);
+        // Region map attached to `process`, nullptr if none.
+        static std::shared_ptr<region_map> of(HANDLE process);
+
+    private:
+        void ensure() const;
+        void build() const;
+        std::vector<region_info>::const_iterator lookup(uintptr_t address) const;
+
+        HANDLE _process;
+        mutable std::shared_mutex _mutex;
+        mutable std::vector<region_info> _regions;
+        std::atomic<uint64_t> _generation{ 1 };
+        mutable std::atomic<uint64_t> _built{ 0 };
+    };
+
+}
@@ -0,0 +1,38 @@
+#include "region_reader.h"
+#include "statistics.h"
+
+using namespace rmm;
+
+region_reader::region_reader(HANDLE process, size_t budget)
+    : _process(process)
+    , _budget(budget)
+{}
+
+size_t region_reader::prepare(uintptr_t begin, uintptr_t end, size_t overlap) {
+    // A chunk must hold more than the overlap, otherwise scanning would not advance.
+    auto capacity = _budget;
+    if (capacity <= overlap)
+        capacity = overlap + backend::of(_process).page_size();
+    if (capacity > end - begin)
+        capacity = end - begin;
+    if (_buffer.size() < capacity)
+        _buffer.resize(capacity);
+    return capacity;
+}
+
+const char* region_reader::view(uintptr_t begin, uintptr_t end) {
+    if (begin >= end)
+        return nullptr;
+    auto data = (const char*)backend::of(_process).view(_process, begin, end - begin);
+    if (data != nullptr)
+        statistics::add(statistics::chunks_read);
+    return data;
+}
+
+void region_reader::read(uintptr_t address, char *buffer, size_t size) {
+    statistics::add(statistics::chunks_read);
+    statistics::timer timer(statistics::read_chunk, address, address + size);
+    if (auto ec = backend::of(_process).read(_process, address, buffer, size))
+        throw std::system_error(ec);
+    timer.stop(size);
+}
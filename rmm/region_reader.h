@@ -0,0 +1,98 @@
+#pragma once
+
+#include "typedefs.h"
+#include "platform.h"
+#include "backend.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace rmm {
+
+    // Streams a range of remote memory through a single reusable buffer of at most `budget` bytes.
+    // Consecutive chunks overlap by `overlap` bytes, which are carried over locally instead of being read again,
+    // so every occurrence of a pattern of `overlap + 1` bytes lies entirely within exactly one chunk.
+    // Ranges the backend can view in place (see backend::view) are passed as a single chunk without copying.
+    class region_reader {
+    public:
+        static constexpr size_t default_budget = 1024 * 1024;
+
+        region_reader(HANDLE process, size_t budget = default_budget);
+
+        inline size_t budget() const { return _budget; }
+
+        // Calls `fn(address, data, size)` for chunks of [begin, end) in ascending order of address
+        // until `fn` returns false. Returns false if scanning was stopped by `fn`.
+        template<typename F>
+        bool forward(uintptr_t begin, uintptr_t end, size_t overlap, F &&fn);
+
+        // Same as `forward`, but chunks are visited in descending order of address.
+        template<typename F>
+        bool backward(uintptr_t begin, uintptr_t end, size_t overlap, F &&fn);
+
+    private:
+        size_t prepare(uintptr_t begin, uintptr_t end, size_t overlap);
+        const char* view(uintptr_t begin, uintptr_t end);
+        void read(uintptr_t address, char *buffer, size_t size);
+
+        HANDLE _process;
+        size_t _budget;
+        std::vector<char> _buffer;
+    };
+
+    template<typename F>
+    bool region_reader::forward(uintptr_t begin, uintptr_t end, size_t overlap, F &&fn) {
+        if (auto data = view(begin, end))
+            return fn(begin, data, end - begin);
+
+        auto capacity = prepare(begin, end, overlap);
+        auto buffer = _buffer.data();
+
+        size_t kept = 0;
+        for (auto address = begin; address < end; ) {
+            auto n = capacity - kept;
+            if (n > end - address)
+                n = end - address;
+            read(address, buffer + kept, n);
+
+            auto size = kept + n;
+            if (!fn(address - kept, (const char*)buffer, size))
+                return false;
+
+            address += n;
+            kept = overlap < size ? overlap : size;
+            std::copy(buffer + size - kept, buffer + size, buffer);
+        }
+
+        return true;
+    }
+
+    template<typename F>
+    bool region_reader::backward(uintptr_t begin, uintptr_t end, size_t overlap, F &&fn) {
+        if (auto data = view(begin, end))
+            return fn(begin, data, end - begin);
+
+        auto capacity = prepare(begin, end, overlap);
+        auto buffer = _buffer.data();
+
+        size_t kept = 0;
+        for (auto address = end; address > begin; ) {
+            auto n = capacity - kept;
+            if (n > address - begin)
+                n = address - begin;
+            // the head of the previous chunk becomes the tail of this one
+            std::copy_backward(buffer, buffer + kept, buffer + n + kept);
+            address -= n;
+            read(address, buffer, n);
+
+            auto size = kept + n;
+            if (!fn(address, (const char*)buffer, size))
+                return false;
+
+            kept = overlap < size ? overlap : size;
+        }
+
+        return true;
+    }
+
+}
@@ -0,0 +1,600 @@
+#include "scan_kernel.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define RMM_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define RMM_TARGET(isa) __attribute__((target(isa)))
+#else
+#define RMM_TARGET(isa)
+#endif
+
+using namespace rmm;
+
+namespace {
+
+    typedef scan_kernel::anchor_info anchor_info;
+
+    inline unsigned count_trailing_zeros(unsigned long long bits) {
+#ifdef _MSC_VER
+        unsigned long index;
+#ifdef _WIN64
+        _BitScanForward64(&index, bits);
+#else
+        if (!_BitScanForward(&index, (unsigned long)bits)) {
+            _BitScanForward(&index, (unsigned long)(bits >> 32));
+            index += 32;
+        }
+#endif
+        return index;
+#else
+        return __builtin_ctzll(bits);
+#endif
+    }
+
+    inline unsigned highest_bit(unsigned long long bits) {
+#ifdef _MSC_VER
+        unsigned long index;
+#ifdef _WIN64
+        _BitScanReverse64(&index, bits);
+#else
+        if (_BitScanReverse(&index, (unsigned long)(bits >> 32)))
+            index += 32;
+        else
+            _BitScanReverse(&index, (unsigned long)bits);
+#endif
+        return index;
+#else
+        return 63 - __builtin_clzll(bits);
+#endif
+    }
+
+    inline bool anchors_match(const anchor_info *anchors, const char *p) {
+        return (p[anchors[0].offset] & anchors[0].mask) == anchors[0].byte
+            && (p[anchors[1].offset] & anchors[1].mask) == anchors[1].byte;
+    }
+
+    // Candidates are [data, data + count), a candidate is a position where the pattern may begin.
+    // Bytes up to data + count - 1 + length are readable.
+
+    const char* first_scalar(const scan_kernel &k, const anchor_info *anchors, const char *data, size_t count) {
+        for (size_t i = 0; i < count; i++)
+            if (anchors_match(anchors, data + i) && k.matches(data + i))
+                return data + i;
+        return nullptr;
+    }
+
+    const char* last_scalar(const scan_kernel &k, const anchor_info *anchors, const char *data, size_t count) {
+        for (size_t i = count; i-- > 0; )
+            if (anchors_match(anchors, data + i) && k.matches(data + i))
+                return data + i;
+        return nullptr;
+    }
+
+    // Masked Horspool over a segment of the pattern. `skip` holds 256 forward shifts, by the byte under
+    // the segment's last byte (`tail`), followed by 256 backward shifts, by the byte under its first byte (`head`).
+    // Only positions where that byte matches are verified in full.
+
+    const char* first_skip(const scan_kernel &k, const anchor_info &tail, const unsigned char *skip, const char *data, size_t count) {
+        for (size_t i = 0; i < count; ) {
+            auto c = data[i + tail.offset];
+            if ((c & tail.mask) == tail.byte && k.matches(data + i))
+                return data + i;
+            i += skip[(unsigned char)c];
+        }
+        return nullptr;
+    }
+
+    const char* last_skip(const scan_kernel &k, const anchor_info &head, const unsigned char *skip, const char *data, size_t count) {
+        skip += 256;
+        for (size_t i = count; i-- > 0; ) {
+            auto c = data[i + head.offset];
+            if ((c & head.mask) == head.byte && k.matches(data + i))
+                return data + i;
+            auto shift = skip[(unsigned char)c];
+            if (i < shift)
+                break;
+            i -= shift - 1;
+        }
+        return nullptr;
+    }
+
+    // Zero tests of blocks of a multiple of 64 bytes, returning at the first non-zero 64 bytes.
+
+    bool zero_scalar(const char *data, size_t size) {
+        for (size_t i = 0; i < size; i += 64) {
+            uint64_t words[8];
+            std::memcpy(words, data + i, sizeof(words));
+            if ((words[0] | words[1] | words[2] | words[3] | words[4] | words[5] | words[6] | words[7]) != 0)
+                return false;
+        }
+        return true;
+    }
+
+#ifdef RMM_X86
+
+    RMM_TARGET("sse2")
+    bool zero_sse2(const char *data, size_t size) {
+        for (size_t i = 0; i < size; i += 64) {
+            auto a = _mm_or_si128(_mm_loadu_si128((const __m128i*)(data + i)), _mm_loadu_si128((const __m128i*)(data + i + 16)));
+            auto b = _mm_or_si128(_mm_loadu_si128((const __m128i*)(data + i + 32)), _mm_loadu_si128((const __m128i*)(data + i + 48)));
+            if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_or_si128(a, b), _mm_setzero_si128())) != 0xFFFF)
+                return false;
+        }
+        return true;
+    }
+
+    RMM_TARGET("avx2")
+    bool zero_avx2(const char *data, size_t size) {
+        for (size_t i = 0; i < size; i += 64) {
+            auto v = _mm256_or_si256(_mm256_loadu_si256((const __m256i*)(data + i)), _mm256_loadu_si256((const __m256i*)(data + i + 32)));
+            if (!_mm256_testz_si256(v, v))
+                return false;
+        }
+        return true;
+    }
+
+    RMM_TARGET("avx512f,avx512bw")
+    bool zero_avx512(const char *data, size_t size) {
+        for (size_t i = 0; i < size; i += 64) {
+            auto v = _mm512_loadu_si512((const void*)(data + i));
+            if (_mm512_test_epi64_mask(v, v) != 0)
+                return false;
+        }
+        return true;
+    }
+
+    RMM_TARGET("sse2")
+    inline unsigned candidates_sse2(const anchor_info *anchors, const char *p) {
+        auto d0 = _mm_loadu_si128((const __m128i*)(p + anchors[0].offset));
+        auto d1 = _mm_loadu_si128((const __m128i*)(p + anchors[1].offset));
+        auto e0 = _mm_cmpeq_epi8(_mm_and_si128(d0, _mm_set1_epi8(anchors[0].mask)), _mm_set1_epi8(anchors[0].byte));
+        auto e1 = _mm_cmpeq_epi8(_mm_and_si128(d1, _mm_set1_epi8(anchors[1].mask)), _mm_set1_epi8(anchors[1].byte));
+        return (unsigned)_mm_movemask_epi8(_mm_and_si128(e0, e1));
+    }
+
+    RMM_TARGET("sse2")
+    const char* first_sse2(const scan_kernel &k, const anchor_info *anchors, const char *data, size_t count) {
+        size_t i = 0;
+        for (; i + 16 <= count; i += 16) {
+            for (auto bits = candidates_sse2(anchors, data + i); bits != 0; bits &= bits - 1) {
+                auto p = data + i + count_trailing_zeros(bits);
+                if (k.matches(p))
+                    return p;
+            }
+        }
+        return first_scalar(k, anchors, data + i, count - i);
+    }
+
+    RMM_TARGET("sse2")
+    const char* last_sse2(const scan_kernel &k, const anchor_info *anchors, const char *data, size_t count) {
+        size_t i = count;
+        for (; i >= 16; i -= 16) {
+            for (unsigned long long bits = candidates_sse2(anchors, data + i - 16); bits != 0; ) {
+                auto bit = highest_bit(bits);
+                auto p = data + i - 16 + bit;
+                if (k.matches(p))
+                    return p;
+                bits &= ~(1ull << bit);
+            }
+        }
+        return last_scalar(k, anchors, data, i);
+    }
+
+    RMM_TARGET("avx2")
+    inline unsigned candidates_avx2(const anchor_info *anchors, const char *p) {
+        auto d0 = _mm256_loadu_si256((const __m256i*)(p + anchors[0].offset));
+        auto d1 = _mm256_loadu_si256((const __m256i*)(p + anchors[1].offset));
+        auto e0 = _mm256_cmpeq_epi8(_mm256_and_si256(d0, _mm256_set1_epi8(anchors[0].mask)), _mm256_set1_epi8(anchors[0].byte));
+        auto e1 = _mm256_cmpeq_epi8(_mm256_and_si256(d1, _mm256_set1_epi8(anchors[1].mask)), _mm256_set1_epi8(anchors[1].byte));
+        return (unsigned)_mm256_movemask_epi8(_mm256_and_si256(e0, e1));
+    }
+
+    RMM_TARGET("avx2")
+    const char* first_avx2(const scan_kernel &k, const anchor_info *anchors, const char *data, size_t count) {
+        size_t i = 0;
+        for (; i + 32 <= count; i += 32) {
+            for (auto bits = candidates_avx2(anchors, data + i); bits != 0; bits &= bits - 1) {
+                auto p = data + i + count_trailing_zeros(bits);
+                if (k.matches(p))
+                    return p;
+            }
+        }
+        return first_sse2(k, anchors, data + i, count - i);
+    }
+
+    RMM_TARGET("avx2")
+    const char* last_avx2(const scan_kernel &k, const anchor_info *anchors, const char *data, size_t count) {
+        size_t i = count;
+        for (; i >= 32; i -= 32) {
+            for (unsigned long long bits = candidates_avx2(anchors, data + i - 32); bits != 0; ) {
+                auto bit = highest_bit(bits);
+                auto p = data + i - 32 + bit;
+                if (k.matches(p))
+                    return p;
+                bits &= ~(1ull << bit);
+            }
+        }
+        return last_sse2(k, anchors, data, i);
+    }
+
+    RMM_TARGET("avx512f,avx512bw")
+    inline unsigned long long candidates_avx512(const anchor_info *anchors, const char *p) {
+        auto d0 = _mm512_loadu_si512((const void*)(p + anchors[0].offset));
+        auto d1 = _mm512_loadu_si512((const void*)(p + anchors[1].offset));
+        auto e0 = _mm512_cmpeq_epi8_mask(_mm512_and_si512(d0, _mm512_set1_epi8(anchors[0].mask)), _mm512_set1_epi8(anchors[0].byte));
+        auto e1 = _mm512_cmpeq_epi8_mask(_mm512_and_si512(d1, _mm512_set1_epi8(anchors[1].mask)), _mm512_set1_epi8(anchors[1].byte));
+        return (unsigned long long)(e0 & e1);
+    }
+
+    RMM_TARGET("avx512f,avx512bw")
+    const char* first_avx512(const scan_kernel &k, const anchor_info *anchors, const char *data, size_t count) {
+        size_t i = 0;
+        for (; i + 64 <= count; i += 64) {
+            for (auto bits = candidates_avx512(anchors, data + i); bits != 0; bits &= bits - 1) {
+                auto p = data + i + count_trailing_zeros(bits);
+                if (k.matches(p))
+                    return p;
+            }
+        }
+        return first_avx2(k, anchors, data + i, count - i);
+    }
+
+    RMM_TARGET("avx512f,avx512bw")
+    const char* last_avx512(const scan_kernel &k, const anchor_info *anchors, const char *data, size_t count) {
+        size_t i = count;
+        for (; i >= 64; i -= 64) {
+            for (auto bits = candidates_avx512(anchors, data + i - 64); bits != 0; ) {
+                auto bit = highest_bit(bits);
+                auto p = data + i - 64 + bit;
+                if (k.matches(p))
+                    return p;
+                bits &= ~(1ull << bit);
+            }
+        }
+        return last_avx2(k, anchors, data, i);
+    }
+
+    scan_kernel::instruction_set detect() {
+#if defined(_MSC_VER)
+        int regs[4];
+        __cpuid(regs, 0);
+        auto max_leaf = regs[0];
+        __cpuid(regs, 1);
+        bool has_sse2 = (regs[3] & (1 << 26)) != 0;
+        bool has_osxsave = (regs[2] & (1 << 27)) != 0;
+        bool has_avx = (regs[2] & (1 << 28)) != 0;
+        if (!has_sse2)
+            return scan_kernel::scalar;
+        if (!has_osxsave || !has_avx || max_leaf < 7)
+            return scan_kernel::sse2;
+        auto xcr0 = _xgetbv(0);
+        if ((xcr0 & 0x06) != 0x06)
+            return scan_kernel::sse2;
+        __cpuidex(regs, 7, 0);
+        bool has_avx2 = (regs[1] & (1 << 5)) != 0;
+        bool has_avx512 = (regs[1] & (1 << 16)) != 0 && (regs[1] & (1 << 30)) != 0 && (xcr0 & 0xE6) == 0xE6;
+        if (has_avx512)
+            return scan_kernel::avx512;
+        return has_avx2 ? scan_kernel::avx2 : scan_kernel::sse2;
+#else
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"))
+            return scan_kernel::avx512;
+        if (__builtin_cpu_supports("avx2"))
+            return scan_kernel::avx2;
+        if (__builtin_cpu_supports("sse2"))
+            return scan_kernel::sse2;
+        return scan_kernel::scalar;
+#endif
+    }
+
+#else
+
+    scan_kernel::instruction_set detect() {
+        return scan_kernel::scalar;
+    }
+
+#endif
+
+    std::atomic<scan_kernel::instruction_set> selected_set{ scan_kernel::supported() };
+
+    bool zero(scan_kernel::instruction_set set, const char *data, size_t size) {
+        switch (set) {
+#ifdef RMM_X86
+        case scan_kernel::avx512:
+            return zero_avx512(data, size);
+        case scan_kernel::avx2:
+            return zero_avx2(data, size);
+        case scan_kernel::sse2:
+            return zero_sse2(data, size);
+#endif
+        default:
+            return zero_scalar(data, size);
+        }
+    }
+
+    // Zero-filled blocks skipped by kernels which cannot match zeros, and the most data
+    // searched before looking for the next zero-filled block (which bounds the lookahead per call).
+    const size_t zero_block = 4096;
+    const size_t max_search_run = 16 * zero_block;
+
+    // The segment is capped so that shifts fit in a byte.
+    const size_t max_segment_length = 255;
+
+    // Shortest segment for which the skip table outruns the anchor filter of the instruction set
+    // (measured on cached chunks of code and of random data). The AVX-512 filter is never slower.
+    size_t skip_threshold(scan_kernel::instruction_set set) {
+        switch (set) {
+        case scan_kernel::avx512: return max_segment_length + 1;
+        case scan_kernel::avx2: return 128;
+        case scan_kernel::sse2: return 48;
+        default: return 6;
+        }
+    }
+
+}
+
+scan_kernel::instruction_set scan_kernel::supported() {
+    static const instruction_set set = detect();
+    return set;
+}
+
+scan_kernel::instruction_set scan_kernel::selected() {
+    return selected_set.load(std::memory_order_relaxed);
+}
+
+void scan_kernel::select(instruction_set set) {
+    if (set > supported())
+        set = supported();
+    selected_set.store(set, std::memory_order_relaxed);
+}
+
+scan_kernel::scan_kernel(const char *data, size_t length)
+    : _pattern(data, length)
+    , _mask(length, '\xFF')
+    , _exact(true)
+    , _matches_zero(_pattern.find_first_not_of('\0') == std::string::npos)
+{
+    choose_anchors();
+    build_skip_table();
+}
+
+scan_kernel::scan_kernel(const char *pattern, const char *mask, size_t length)
+    : _pattern(length, '\x00')
+    , _mask(mask, length)
+    , _exact(true)
+{
+    for (size_t i = 0; i < length; i++) {
+        _pattern[i] = pattern[i] & mask[i];
+        if (mask[i] != '\xFF')
+            _exact = false;
+    }
+    _matches_zero = _pattern.find_first_not_of('\0') == std::string::npos;
+    choose_anchors();
+    build_skip_table();
+}
+
+void scan_kernel::choose_anchors() {
+    // Fully masked bytes are compared exactly and ranked by rarity,
+    // partially masked ones come after them, ranked by the number of masked bits.
+    auto score = [this](size_t i) {
+        auto m = (unsigned char)_mask[i];
+        if (m == 0xFF)
+            return (int)byte_frequency((unsigned char)_pattern[i]);
+        int bits = 0;
+        for (; m != 0; m &= m - 1)
+            bits++;
+        return 0x100 + (8 - bits) * 0x20;
+    };
+
+    size_t best[2] = { SIZE_MAX, SIZE_MAX };
+    for (size_t i = 0; i < _pattern.size(); i++) {
+        if (_mask[i] == '\x00')
+            continue;
+        if (best[0] == SIZE_MAX || score(i) < score(best[0])) {
+            best[1] = best[0];
+            best[0] = i;
+        } else if (best[1] == SIZE_MAX || score(i) < score(best[1])) {
+            best[1] = i;
+        }
+    }
+
+    _wildcard = best[0] == SIZE_MAX;
+    if (_wildcard)
+        best[0] = 0;
+    if (best[1] == SIZE_MAX)
+        best[1] = best[0];
+
+    _anchor = best[0];
+    for (int i = 0; i < 2; i++)
+        _anchors[i] = { best[i], _pattern[best[i]], _mask[best[i]] };
+}
+
+void scan_kernel::build_skip_table() {
+    _segment = 0;
+    _segment_length = 0;
+    for (size_t i = 0; i < _pattern.size(); ) {
+        if (_mask[i] == '\x00') {
+            i++;
+            continue;
+        }
+        auto begin = i;
+        while (i < _pattern.size() && _mask[i] != '\x00')
+            i++;
+        if (i - begin > _segment_length) {
+            _segment = begin;
+            _segment_length = i - begin;
+        }
+    }
+    if (_segment_length > max_segment_length) {
+        // keep the middle of the run, anchors are unaffected
+        _segment += (_segment_length - max_segment_length) / 2;
+        _segment_length = max_segment_length;
+    }
+
+    if (_segment_length < skip_threshold(scalar))
+        return;
+
+    // A shift must not skip any position where the byte could belong to a match:
+    // with masks, a byte matches every segment position whose masked bits it agrees with.
+    auto pattern = _pattern.data() + _segment;
+    auto mask = _mask.data() + _segment;
+    auto m = _segment_length;
+    _skip.assign(512, (unsigned char)m);
+    for (size_t j = 0; j + 1 < m; j++) {
+        auto shift = (unsigned char)(m - 1 - j);
+        for (unsigned c = 0; c < 256; c++)
+            if (((char)c & mask[j]) == pattern[j])
+                _skip[c] = shift;
+    }
+    for (size_t j = m - 1; j > 0; j--) {
+        for (unsigned c = 0; c < 256; c++)
+            if (((char)c & mask[j]) == pattern[j])
+                _skip[256 + c] = (unsigned char)j;
+    }
+}
+
+scan_kernel::search_strategy scan_kernel::strategy() const {
+    if (!_skip.empty() && _segment_length >= skip_threshold(selected()))
+        return skip_table;
+    return anchor_filter;
+}
+
+bool scan_kernel::matches(const char *data) const {
+    if (_exact)
+        return std::memcmp(data, _pattern.data(), _pattern.size()) == 0;
+    for (size_t i = 0; i < _pattern.size(); i++)
+        if ((data[i] & _mask[i]) != _pattern[i])
+            return false;
+    return true;
+}
+
+const char* scan_kernel::first(const char *data, size_t size) const {
+    if (_pattern.empty() || size < _pattern.size())
+        return nullptr;
+    if (_wildcard)
+        return data;
+    if (_matches_zero || size < 2 * zero_block)
+        return search_first(data, size);
+
+    // Runs of non-zero blocks are searched widened by length - 1 bytes, since a match cannot lie within zeros alone.
+    // `from` is the first position where a match may still begin.
+    auto set = selected();
+    auto overlap = _pattern.size() - 1;
+    auto end = data + size;
+    auto from = data;
+    for (auto block = data; block < end; ) {
+        auto run_end = block;
+        while (run_end < end && (size_t)(run_end - block) < max_search_run) {
+            if ((size_t)(end - run_end) < zero_block) {
+                run_end = end;
+                break;
+            }
+            if (zero(set, run_end, zero_block))
+                break;
+            run_end += zero_block;
+        }
+        if (run_end > from) {
+            auto stop = (size_t)(end - run_end) > overlap ? run_end + overlap : end;
+            if (auto p = search_first(from, stop - from))
+                return p;
+        }
+
+        auto zero_end = run_end;
+        while ((size_t)(end - zero_end) >= zero_block && zero(set, zero_end, zero_block))
+            zero_end += zero_block;
+        from = (size_t)(zero_end - run_end) > overlap ? zero_end - overlap : run_end;
+        block = zero_end;
+    }
+    return nullptr;
+}
+
+const char* scan_kernel::search_first(const char *data, size_t size) const {
+    if (size < _pattern.size())
+        return nullptr;
+    auto count = size - _pattern.size() + 1;
+    if (strategy() == skip_table)
+        return first_skip(*this, { _segment + _segment_length - 1, _pattern[_segment + _segment_length - 1], _mask[_segment + _segment_length - 1] }, _skip.data(), data, count);
+
+    switch (selected()) {
+#ifdef RMM_X86
+    case avx512:
+        return first_avx512(*this, _anchors, data, count);
+    case avx2:
+        return first_avx2(*this, _anchors, data, count);
+    case sse2:
+        return first_sse2(*this, _anchors, data, count);
+#endif
+    default:
+        return first_scalar(*this, _anchors, data, count);
+    }
+}
+
+const char* scan_kernel::last(const char *data, size_t size) const {
+    if (_pattern.empty() || size < _pattern.size())
+        return nullptr;
+    if (_wildcard)
+        return data + size - _pattern.size();
+    if (_matches_zero || size < 2 * zero_block)
+        return search_last(data, size);
+
+    // Mirror image of `first`: blocks are taken from the end, `to` is the end of the last match still possible.
+    auto set = selected();
+    auto overlap = _pattern.size() - 1;
+    auto to = data + size;
+    for (auto block = data + size; block > data; ) {
+        auto run_begin = block;
+        while (run_begin > data && (size_t)(block - run_begin) < max_search_run) {
+            if ((size_t)(run_begin - data) < zero_block) {
+                run_begin = data;
+                break;
+            }
+            if (zero(set, run_begin - zero_block, zero_block))
+                break;
+            run_begin -= zero_block;
+        }
+        if (run_begin < to) {
+            auto start = (size_t)(run_begin - data) > overlap ? run_begin - overlap : data;
+            if (auto p = search_last(start, to - start))
+                return p;
+        }
+
+        auto zero_begin = run_begin;
+        while ((size_t)(zero_begin - data) >= zero_block && zero(set, zero_begin - zero_block, zero_block))
+            zero_begin -= zero_block;
+        to = (size_t)(run_begin - zero_begin) > overlap ? zero_begin + overlap : run_begin;
+        block = zero_begin;
+    }
+    return nullptr;
+}
+
+const char* scan_kernel::search_last(const char *data, size_t size) const {
+    if (size < _pattern.size())
+        return nullptr;
+    auto count = size - _pattern.size() + 1;
+    if (strategy() == skip_table)
+        return last_skip(*this, { _segment, _pattern[_segment], _mask[_segment] }, _skip.data(), data, count);
+
+    switch (selected()) {
+#ifdef RMM_X86
+    case avx512:
+        return last_avx512(*this, _anchors, data, count);
+    case avx2:
+        return last_avx2(*this, _anchors, data, count);
+    case sse2:
+        return last_sse2(*this, _anchors, data, count);
+#endif
+    default:
+        return last_scalar(*this, _anchors, data, count);
+    }
+}
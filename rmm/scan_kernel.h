@@ -0,0 +1,125 @@
+#pragma once
+
+#include "typedefs.h"
+
+#include <string>
+#include <vector>
+
+namespace rmm {
+
+    // Compiled (masked) byte pattern and the vectorized kernels searching for it.
+    // Candidate positions are filtered 16/32/64 at a time by comparing two selective bytes of the pattern
+    // (the anchors, chosen to be rare in typical process memory), survivors are verified in full.
+    // The kernel is picked at runtime according to CPUID; every kernel returns exactly the same results.
+    //
+    // Long patterns are searched with a masked Boyer-Moore-Horspool skip table instead, built over the longest
+    // run of non-wildcard bytes; the pattern is verified in full only where that run matches.
+    //
+    // Patterns which cannot match zero-filled data skip zero-filled blocks (after a vectorized test),
+    // so sparse and padded memory costs little more than the test itself.
+    class scan_kernel {
+    public:
+        enum instruction_set {
+            scalar,
+            sse2,
+            avx2,
+            avx512,
+        };
+
+        // Best instruction set supported by the CPU and OS.
+        static instruction_set supported();
+        // Instruction set used by kernels, `supported()` unless overridden by `select`.
+        static instruction_set selected();
+        // Overrides the instruction set (clamped to `supported()`), e.g. to compare kernels.
+        static void select(instruction_set set);
+
+        // Heuristic frequency of `byte` in process memory (code, pointers, text, zero fill):
+        // 0 - rare, 255 - most common. The more common the byte, the worse it is as an anchor.
+        static constexpr unsigned byte_frequency(unsigned char byte) {
+            switch (byte) {
+            case 0x00: return 255;
+            case 0xFF: return 240;
+            case 0xCC: return 200;
+            case 0x48: return 190;
+            case 0x8B: return 180;
+            case 0x89: return 170;
+            case 0x0F: return 160;
+            case 0x20: return 150;
+            case 0xE8: case 0x24: return 140;
+            case 0x4C: case 0x83: return 130;
+            case 0xC3: case 0x90: return 120;
+            case 0x85: case 0x75: return 110;
+            case 0x44: case 0x40: case 0xFE: case 'e': return 100;
+            case 't': return 96; // 0x74 (JE rel8)
+            case 'a': case 'o': return 92;
+            case 0x7F: case 0xC0: case 0x80: return 90;
+            case 'i': case 'n': return 88;
+            }
+            if (byte >= 'a' && byte <= 'z')
+                return 80;
+            if (byte >= 'A' && byte <= 'Z')
+                return 48;
+            if (byte >= '0' && byte <= '9')
+                return 64;
+            if (byte >= 0x01 && byte <= 0x10)
+                return 128;
+            return 16;
+        }
+
+        enum search_strategy {
+            anchor_filter,
+            skip_table,
+        };
+
+        // Exact pattern.
+        scan_kernel(const char *data, size_t length);
+        // Masked pattern: data byte `d` matches pattern byte `p` if (d & mask) == (p & mask).
+        scan_kernel(const char *pattern, const char *mask, size_t length);
+
+        inline size_t length() const { return _pattern.size(); }
+        // Pattern (with masked bits cleared) and mask, byte for byte.
+        inline const std::string& pattern() const { return _pattern; }
+        inline const std::string& mask() const { return _mask; }
+        inline size_t anchor() const { return _anchor; }
+        // Longest run of non-wildcard bytes, the segment of the skip table.
+        inline size_t segment() const { return _segment; }
+        inline size_t segment_length() const { return _segment_length; }
+        // Strategy used by `first`/`last` with the selected instruction set: the skip table wins once
+        // the segment is long enough for the average shift to outrun the vector width.
+        search_strategy strategy() const;
+        // Whether the pattern matches zero-filled data (every byte it compares is zero).
+        inline bool matches_zero() const { return _matches_zero; }
+
+        // First/last position of [data, data + size) where the pattern matches, nullptr if none.
+        const char* first(const char *data, size_t size) const;
+        const char* last(const char *data, size_t size) const;
+
+        bool matches(const char *data) const;
+
+        struct anchor_info {
+            size_t offset;
+            char byte;
+            char mask;
+        };
+
+    private:
+        void choose_anchors();
+        void build_skip_table();
+        const char* search_first(const char *data, size_t size) const;
+        const char* search_last(const char *data, size_t size) const;
+
+        std::string _pattern;
+        std::string _mask;
+        bool _exact;
+        bool _wildcard; // nothing in the pattern is masked, every position matches
+        bool _matches_zero;
+        size_t _anchor;
+        anchor_info _anchors[2];
+        size_t _segment;
+        size_t _segment_length;
+        // Shifts by the byte under the last (forward) and the first (backward) byte of the segment,
+        // empty if the segment is too short for the skip table to pay off.
+        std::vector<unsigned char> _skip;
+    };
+
+}
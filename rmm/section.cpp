@@ -1,14 +1,32 @@
 #include "section.h"
 
-#include <Windows.h>
-#include <Psapi.h>
+#include <algorithm>
+#include <cstring>
 
 using namespace rmm;
 
 section::section(pointer module_base, const IMAGE_SECTION_HEADER &header)
     : memory(module_base.process())
-    , name(std::string((char*)&header.Name[0], '\0', sizeof(header.Name)))
+    , name((const char*)header.Name, strnlen((const char*)header.Name, sizeof(header.Name)))
+    , protect(protection(header.Characteristics))
 {
     _begin = module_base + header.VirtualAddress;
-    _end = _begin + max(header.Misc.VirtualSize, header.SizeOfRawData);
+    _end = _begin + (std::max)(header.Misc.VirtualSize, header.SizeOfRawData);
+}
+
+section::section(HANDLE process, const std::string &name, uintptr_t begin, uintptr_t end, DWORD protect)
+    : memory(process)
+    , name(name)
+    , protect(protect)
+{
+    _begin = begin;
+    _end = end;
+}
+
+DWORD section::protection(DWORD characteristics) {
+    bool r = (characteristics & IMAGE_SCN_MEM_READ) != 0;
+    bool w = (characteristics & IMAGE_SCN_MEM_WRITE) != 0;
+    if (characteristics & IMAGE_SCN_MEM_EXECUTE)
+        return w ? PAGE_EXECUTE_READWRITE : r ? PAGE_EXECUTE_READ : PAGE_EXECUTE;
+    return w ? PAGE_READWRITE : r ? PAGE_READONLY : PAGE_NOACCESS;
 }
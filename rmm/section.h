@@ -1,8 +1,7 @@
 #pragma once
 
-#include <Windows.h>
-
 #include "typedefs.h"
+#include "platform.h"
 #include "pointer.h"
 #include "memory.h"
 
@@ -13,8 +12,13 @@ namespace rmm {
     class section : public memory {
     public:
         section(pointer module_base, const IMAGE_SECTION_HEADER &header);
+        section(HANDLE process, const std::string &name, uintptr_t begin, uintptr_t end, DWORD protect);
+
+        // PAGE_* protection of a PE section with the given characteristics.
+        static DWORD protection(DWORD characteristics);
 
         const std::string name;
+        const DWORD protect;
     };
 
 }
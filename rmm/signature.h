@@ -0,0 +1,196 @@
+#pragma once
+
+#include "typedefs.h"
+#include "scan_kernel.h"
+
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace rmm {
+
+    // Signature in IDA-style notation, e.g. "48 8B 05 ?? ?? ?? ?? 4? 89": hex bytes separated by spaces,
+    // "?" or "??" for any byte, "4?" / "?4" for a byte with a single fixed nibble.
+    // Unlike pattern/mask strings, the length is explicit, so zero bytes and wildcards may appear anywhere,
+    // and matches are reported at the first byte of the signature.
+    //
+    // Declared constexpr (see make_signature), the text is parsed at compile time, and a malformed one fails to compile.
+    // `Capacity` is an upper bound of the length.
+    template<size_t Capacity>
+    class signature {
+    public:
+        enum byte_class {
+            any,
+            exact,
+            high_nibble,
+            low_nibble,
+        };
+
+        constexpr explicit signature(const char *text) {
+            for (auto p = text; *p != '\0'; ) {
+                if (*p == ' ' || *p == '\t') {
+                    p++;
+                    continue;
+                }
+                auto token = p;
+                while (*p != '\0' && *p != ' ' && *p != '\t')
+                    p++;
+                if (_length == Capacity)
+                    throw std::invalid_argument("signature is too long");
+
+                if (p - token == 1 && token[0] == '?') {
+                    _pattern[_length] = 0;
+                    _mask[_length] = 0;
+                } else if (p - token == 2) {
+                    auto high = nibble(token[0]);
+                    auto low = nibble(token[1]);
+                    auto mask = (high >= 0 ? 0xF0 : 0) | (low >= 0 ? 0x0F : 0);
+                    _pattern[_length] = (char)((((high & 0xF) << 4) | (low & 0xF)) & mask);
+                    _mask[_length] = (char)mask;
+                } else {
+                    throw std::invalid_argument("malformed signature byte");
+                }
+                _length++;
+            }
+            if (_length == 0)
+                throw std::invalid_argument("empty signature");
+            _anchor = choose_anchor();
+        }
+
+        constexpr size_t length() const { return _length; }
+        constexpr const char* pattern() const { return _pattern; }
+        constexpr const char* mask() const { return _mask; }
+        constexpr char pattern(size_t i) const { return _pattern[i]; }
+        constexpr char mask(size_t i) const { return _mask[i]; }
+
+        constexpr byte_class class_of(size_t i) const {
+            switch ((unsigned char)_mask[i]) {
+            case 0x00: return any;
+            case 0xFF: return exact;
+            case 0xF0: return high_nibble;
+            default: return low_nibble;
+            }
+        }
+
+        // The most selective byte (see scan_kernel::byte_frequency), length() if every byte is a wildcard.
+        constexpr size_t anchor() const { return _anchor; }
+
+        bool matches(const char *data) const {
+            for (size_t i = 0; i < _length; i++)
+                if ((data[i] & _mask[i]) != _pattern[i])
+                    return false;
+            return true;
+        }
+
+        // Runtime kernel for scanning memory (see memory::find).
+        scan_kernel kernel() const {
+            return scan_kernel(_pattern, _mask, _length);
+        }
+
+    private:
+        // Value of a hex digit, -1 for '?'.
+        static constexpr int nibble(char c) {
+            if (c >= '0' && c <= '9')
+                return c - '0';
+            if (c >= 'A' && c <= 'F')
+                return c - 'A' + 10;
+            if (c >= 'a' && c <= 'f')
+                return c - 'a' + 10;
+            if (c == '?')
+                return -1;
+            throw std::invalid_argument("malformed signature byte");
+        }
+
+        constexpr size_t choose_anchor() const {
+            // ranked as in scan_kernel: fully masked bytes by rarity, then by the number of masked bits
+            size_t best = _length;
+            unsigned best_score = 0;
+            for (size_t i = 0; i < _length; i++) {
+                unsigned score = 0;
+                switch (class_of(i)) {
+                case any: continue;
+                case exact: score = scan_kernel::byte_frequency((unsigned char)_pattern[i]); break;
+                default: score = 0x100 + 4 * 0x20; break;
+                }
+                if (best == _length || score < best_score) {
+                    best = i;
+                    best_score = score;
+                }
+            }
+            return best;
+        }
+
+        char _pattern[Capacity] = {};
+        char _mask[Capacity] = {};
+        size_t _length = 0;
+        size_t _anchor = 0;
+    };
+
+    // Each byte of `text` takes at least two characters (counting the separator or terminator).
+    template<size_t N>
+    constexpr signature<N / 2> make_signature(const char (&text)[N]) {
+        return signature<N / 2>(text);
+    }
+
+    // Matcher specialized on a constexpr signature:
+    //     static constexpr auto sig = make_signature("48 8B 05 ?? ?? ?? ?? 4? 89");
+    //     auto p = signature_matcher<sig>::first(data, size);
+    // Comparisons are unrolled, wildcards are compiled out, and candidates are located by the anchor byte.
+    template<const auto &Signature>
+    class signature_matcher {
+    public:
+        static constexpr size_t length = Signature.length();
+        static constexpr size_t anchor = Signature.anchor();
+
+        static inline bool matches(const char *data) {
+            return matches(data, std::make_index_sequence<length>());
+        }
+
+        // First match within [data, data + size), nullptr if none.
+        static const char* first(const char *data, size_t size) {
+            if (size < length)
+                return nullptr;
+            auto last = data + size - length;
+            if constexpr (anchor == length) {
+                return data;
+            } else if constexpr (Signature.class_of(anchor) == std::decay_t<decltype(Signature)>::exact) {
+                constexpr char byte = Signature.pattern(anchor);
+                for (auto p = data + anchor; p <= last + anchor; p++) {
+                    p = (const char*)std::memchr(p, (unsigned char)byte, last + anchor + 1 - p);
+                    if (p == nullptr)
+                        return nullptr;
+                    if (matches(p - anchor))
+                        return p - anchor;
+                }
+                return nullptr;
+            } else {
+                for (auto p = data; p <= last; p++)
+                    if (matches(p))
+                        return p;
+                return nullptr;
+            }
+        }
+
+    private:
+        template<size_t I>
+        static inline bool byte_matches(const char *data) {
+            constexpr char mask = Signature.mask(I);
+            constexpr char pattern = Signature.pattern(I);
+            if constexpr (mask == '\x00')
+                return true;
+            else if constexpr (mask == '\xFF')
+                return data[I] == pattern;
+            else
+                return (data[I] & mask) == pattern;
+        }
+
+        template<size_t... I>
+        static inline bool matches(const char *data, std::index_sequence<I...>) {
+            // the anchor is tested first, it is the most likely to fail
+            return byte_matches<anchor < length ? anchor : 0>(data) && (byte_matches<I>(data) && ...);
+        }
+    };
+
+}
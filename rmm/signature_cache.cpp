@@ -0,0 +1,365 @@
+#include "signature_cache.h"
+#include "elf_headers.h"
+#include "signature_set.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <tuple>
+
+using namespace rmm;
+
+namespace {
+
+    const char file_magic[8] = { 'R', 'M', 'M', 'S', 'I', 'G', 'C', 'A' };
+    const uint32_t file_version = 1;
+    const size_t header_page = 0x1000;
+    const size_t max_notes = 0x10000;
+
+    const uint64_t fnv_basis = 0xCBF29CE484222325ull;
+    const uint64_t fnv_prime = 0x100000001B3ull;
+
+    uint64_t fnv1a(uint64_t hash, const void *data, size_t size) {
+        auto bytes = (const unsigned char*)data;
+        for (size_t i = 0; i < size; i++)
+            hash = (hash ^ bytes[i]) * fnv_prime;
+        return hash;
+    }
+
+    template<typename T>
+    inline uint64_t fnv1a(uint64_t hash, const T &value) {
+        return fnv1a(hash, &value, sizeof(value));
+    }
+
+    // GNU build ID of an ELF image from its notes (falling back to its program headers), 0 if unreadable.
+    template<typename Addr, typename ProgramHeader>
+    uint64_t elf_identity(const module &module, const char *page, size_t size) {
+        elf::file_header<Addr> header;
+        std::memcpy(&header, page, sizeof(header));
+        auto headers_end = (uint64_t)header.phoff + (uint64_t)header.phnum * header.phentsize;
+        if (header.phentsize < sizeof(ProgramHeader) || headers_end > size)
+            return 0;
+
+        std::vector<ProgramHeader> segments(header.phnum);
+        uint64_t lowest = UINT64_MAX;
+        for (uint16_t i = 0; i < header.phnum; i++) {
+            std::memcpy(&segments[i], page + header.phoff + (size_t)i * header.phentsize, sizeof(ProgramHeader));
+            if (segments[i].type == elf::pt_load)
+                lowest = (std::min)(lowest, (uint64_t)segments[i].vaddr & ~(uint64_t)(header_page - 1));
+        }
+
+        for (auto &s : segments) {
+            if (s.type != elf::pt_note || lowest == UINT64_MAX || s.vaddr < lowest)
+                continue;
+            std::vector<char> notes((size_t)(std::min)((uint64_t)s.filesz, (uint64_t)max_notes));
+            if ((module.begin() + (uintptr_t)(s.vaddr - lowest)).read(notes.data(), notes.size()))
+                continue;
+            for (size_t offset = 0; offset + sizeof(elf::note_header) <= notes.size(); ) {
+                elf::note_header note;
+                std::memcpy(&note, notes.data() + offset, sizeof(note));
+                auto name = offset + sizeof(note);
+                auto desc = name + ((note.namesz + 3) & ~3u);
+                offset = desc + ((note.descsz + 3) & ~3u);
+                if (offset > notes.size())
+                    break;
+                if (note.type == elf::nt_gnu_build_id && note.namesz == 4 && std::memcmp(notes.data() + name, "GNU", 4) == 0)
+                    return fnv1a(fnv_basis, notes.data() + desc, note.descsz);
+            }
+        }
+
+        return fnv1a(fnv1a(fnv_basis, &header, sizeof(header)), page + header.phoff, (size_t)(headers_end - header.phoff));
+    }
+
+    // Hash of the parts of PE headers which identify the build; ImageBase is left out, the loader rewrites it.
+    uint64_t pe_identity(const char *page, size_t size) {
+        IMAGE_DOS_HEADER dos;
+        std::memcpy(&dos, page, sizeof(dos));
+        if (dos.e_magic != IMAGE_DOS_SIGNATURE || dos.e_lfanew < 0)
+            return 0;
+        auto nt = (size_t)dos.e_lfanew;
+        auto optional = nt + sizeof(DWORD) + sizeof(IMAGE_FILE_HEADER);
+        if (optional + sizeof(IMAGE_OPTIONAL_HEADER32) > size)
+            return 0;
+
+        DWORD signature;
+        IMAGE_FILE_HEADER file_header;
+        std::memcpy(&signature, page + nt, sizeof(signature));
+        std::memcpy(&file_header, page + nt + sizeof(DWORD), sizeof(file_header));
+        if (signature != IMAGE_NT_SIGNATURE)
+            return 0;
+
+        auto hash = fnv1a(fnv_basis, file_header);
+        WORD magic;
+        std::memcpy(&magic, page + optional, sizeof(magic));
+        if (magic == IMAGE_NT_OPTIONAL_HDR64_MAGIC && optional + sizeof(IMAGE_OPTIONAL_HEADER64) <= size) {
+            IMAGE_OPTIONAL_HEADER64 oh;
+            std::memcpy(&oh, page + optional, sizeof(oh));
+            hash = fnv1a(fnv1a(fnv1a(hash, oh.SizeOfImage), oh.CheckSum), oh.AddressOfEntryPoint);
+        } else if (magic == IMAGE_NT_OPTIONAL_HDR32_MAGIC) {
+            IMAGE_OPTIONAL_HEADER32 oh;
+            std::memcpy(&oh, page + optional, sizeof(oh));
+            hash = fnv1a(fnv1a(fnv1a(hash, oh.SizeOfImage), oh.CheckSum), oh.AddressOfEntryPoint);
+        } else {
+            return 0;
+        }
+
+        auto sections = optional + file_header.SizeOfOptionalHeader;
+        auto sections_size = (size_t)file_header.NumberOfSections * sizeof(IMAGE_SECTION_HEADER);
+        if (sections + sections_size > size)
+            return 0;
+        return fnv1a(hash, page + sections, sections_size);
+    }
+
+}
+
+signature_cache::signature_cache(const std::filesystem::path &path)
+    : _path(path)
+{
+    load(path);
+}
+
+uint64_t signature_cache::build_id(const module &module) {
+    char page[header_page];
+    auto size = (size_t)(std::min)((uintptr_t)module.size(), (uintptr_t)sizeof(page));
+    if (size < sizeof(IMAGE_DOS_HEADER) || module.begin().read(page, size))
+        return 0;
+
+    uint64_t identity = 0;
+    if (std::memcmp(page, elf::magic, sizeof(elf::magic)) == 0) {
+        if (page[elf::ident_class] == elf::class64)
+            identity = elf_identity<uint64_t, elf::program_header64>(module, page, size);
+        else if (page[elf::ident_class] == elf::class32)
+            identity = elf_identity<uint32_t, elf::program_header32>(module, page, size);
+    } else {
+        identity = pe_identity(page, size);
+    }
+    if (identity == 0)
+        return 0;
+
+    auto id = fnv1a(identity, (uint64_t)module.size());
+    return id != 0 ? id : 1;
+}
+
+uint64_t signature_cache::module_build(const module &module) {
+    module_key k = { module.begin().process(), (uintptr_t)module.begin(), (uintptr_t)module.end() };
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto it = _builds.find(k);
+        if (it != _builds.end())
+            return it->second;
+    }
+    // unreadable headers are tried again next time
+    auto build = build_id(module);
+    if (build != 0) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _builds.emplace(k, build);
+    }
+    return build;
+}
+
+uint64_t signature_cache::signature_id(const scan_kernel &kernel) {
+    auto hash = fnv1a(fnv_basis, (uint64_t)kernel.length());
+    hash = fnv1a(hash, kernel.pattern().data(), kernel.length());
+    return fnv1a(hash, kernel.mask().data(), kernel.length());
+}
+
+bool signature_cache::lookup(const key &k, uint32_t &rva) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _entries.find(k);
+    if (it == _entries.end())
+        return false;
+    rva = it->second;
+    return true;
+}
+
+void signature_cache::store(const key &k, const module &module, const pointer &match) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto rva = (uintptr_t)match - (uintptr_t)module.begin();
+    if (match == nullptr || rva > UINT32_MAX)
+        _entries.erase(k);
+    else
+        _entries[k] = (uint32_t)rva;
+}
+
+pointer signature_cache::find(const module &module, const scan_kernel &kernel) {
+    key k = { module_build(module), signature_id(kernel) };
+    uint32_t rva;
+    bool cached = k.build != 0 && lookup(k, rva);
+    if (cached) {
+        std::vector<char> bytes(kernel.length());
+        if (kernel.length() != 0 && rva + bytes.size() <= module.size()
+            && !(module.begin() + rva).read(bytes.data(), bytes.size()) && kernel.matches(bytes.data())) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _counters.hits++;
+            return module.begin() + rva;
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        (cached ? _counters.stale : _counters.misses)++;
+    }
+
+    auto match = module.find_single(kernel);
+    if (k.build != 0)
+        store(k, module, match);
+    return match;
+}
+
+pointer signature_cache::find(const module &module, const char *pattern, const char *mask) {
+    size_t length;
+    if (!memory::prepare_pattern(pattern, mask, length))
+        return pointer(module.begin().process(), nullptr);
+    return find(module, scan_kernel(pattern, mask, length));
+}
+
+std::vector<pointer> signature_cache::find(const module &module, const std::vector<scan_kernel> &kernels) {
+    auto process = module.begin().process();
+    std::vector<pointer> matches(kernels.size(), pointer(process, nullptr));
+    auto build = module_build(module);
+
+    // cached RVAs, checked in one go
+    std::vector<size_t> cached;
+    std::vector<uint32_t> rvas;
+    size_t total = 0;
+    for (size_t i = 0; i < kernels.size(); i++) {
+        uint32_t rva;
+        if (build != 0 && kernels[i].length() != 0 && lookup({ build, signature_id(kernels[i]) }, rva)
+            && rva + kernels[i].length() <= module.size()) {
+            cached.push_back(i);
+            rvas.push_back(rva);
+            total += kernels[i].length();
+        }
+    }
+    std::vector<char> bytes(total);
+    std::vector<io_vector> vectors;
+    for (size_t j = 0, offset = 0; j < cached.size(); j++) {
+        auto length = kernels[cached[j]].length();
+        vectors.push_back({ (uintptr_t)module.begin() + rvas[j], bytes.data() + offset, length, {} });
+        offset += length;
+    }
+    if (!vectors.empty())
+        backend::of(process).read_vector(process, vectors.data(), vectors.size());
+
+    std::vector<bool> resolved(kernels.size());
+    size_t hits = 0;
+    for (size_t j = 0; j < cached.size(); j++) {
+        auto i = cached[j];
+        if (!vectors[j].status && kernels[i].matches((const char*)vectors[j].buffer)) {
+            matches[i] = module.begin() + rvas[j];
+            resolved[i] = true;
+            hits++;
+        }
+    }
+
+    // the rest in a single pass
+    signature_set set;
+    std::vector<size_t> ids;
+    for (size_t i = 0; i < kernels.size(); i++) {
+        if (!resolved[i] && kernels[i].length() != 0) {
+            set.add(kernels[i]);
+            ids.push_back(i);
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _counters.hits += hits;
+        _counters.stale += cached.size() - hits;
+        _counters.misses += ids.size() - (cached.size() - hits);
+    }
+    if (ids.empty())
+        return matches;
+
+    set.compile();
+    auto found = set.find_first(module);
+    for (size_t id = 0; id < ids.size(); id++) {
+        matches[ids[id]] = found[id];
+        if (build != 0)
+            store({ build, signature_id(kernels[ids[id]]) }, module, found[id]);
+    }
+    return matches;
+}
+
+bool signature_cache::load(const std::filesystem::path &path) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _entries.clear();
+
+    std::ifstream in(path, std::ios::binary);
+    char magic[sizeof(file_magic)];
+    uint32_t version;
+    uint64_t count;
+    in.read(magic, sizeof(magic));
+    in.read((char*)&version, sizeof(version));
+    in.read((char*)&count, sizeof(count));
+    if (!in || std::memcmp(magic, file_magic, sizeof(magic)) != 0 || version != file_version)
+        return false;
+
+    for (uint64_t i = 0; i < count; i++) {
+        key k;
+        uint32_t rva;
+        in.read((char*)&k.build, sizeof(k.build));
+        in.read((char*)&k.signature, sizeof(k.signature));
+        in.read((char*)&rva, sizeof(rva));
+        if (!in) {
+            _entries.clear();
+            return false;
+        }
+        _entries[k] = rva;
+    }
+    return true;
+}
+
+void signature_cache::save() const {
+    if (_path.empty())
+        throw std::invalid_argument("signature cache has no file");
+    save(_path);
+}
+
+void signature_cache::save(const std::filesystem::path &path) const {
+    std::vector<std::pair<key, uint32_t>> entries;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        entries.assign(_entries.begin(), _entries.end());
+    }
+    std::sort(entries.begin(), entries.end(), [](const std::pair<key, uint32_t> &a, const std::pair<key, uint32_t> &b) {
+        return std::tie(a.first.build, a.first.signature) < std::tie(b.first.build, b.first.signature);
+    });
+
+    // written aside and renamed over, so that a crash never leaves a truncated cache behind
+    auto temporary = path;
+    temporary += ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        if (!out)
+            throw std::runtime_error("cannot create signature cache " + temporary.string());
+        uint64_t count = entries.size();
+        out.write(file_magic, sizeof(file_magic));
+        out.write((const char*)&file_version, sizeof(file_version));
+        out.write((const char*)&count, sizeof(count));
+        for (auto &[k, rva] : entries) {
+            out.write((const char*)&k.build, sizeof(k.build));
+            out.write((const char*)&k.signature, sizeof(k.signature));
+            out.write((const char*)&rva, sizeof(rva));
+        }
+        if (!out)
+            throw std::runtime_error("cannot write signature cache " + temporary.string());
+    }
+    std::filesystem::rename(temporary, path);
+}
+
+size_t signature_cache::size() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _entries.size();
+}
+
+void signature_cache::clear() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _entries.clear();
+    _builds.clear();
+    _counters = {};
+}
+
+signature_cache::counters signature_cache::stats() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _counters;
+}
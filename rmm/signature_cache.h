@@ -0,0 +1,99 @@
+#pragma once
+
+#include "typedefs.h"
+#include "pointer.h"
+#include "memory.h"
+#include "module.h"
+#include "scan_kernel.h"
+#include "signature.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace rmm {
+
+    // Signatures resolved in modules, kept across runs in a file.
+    // Modules are told apart by their build (see build_id); for each build the cache maps a signature
+    // (its pattern and mask) to the RVA of its first match. A cached RVA is only trusted once the signature
+    // matches there again, so a stale entry costs a small read before the module is scanned as usual.
+    class signature_cache {
+    public:
+        struct counters {
+            size_t hits;
+            size_t misses; // not cached, scanned
+            size_t stale;  // cached, but the signature no longer matched there; scanned
+        };
+
+        signature_cache() = default;
+        // Cache backed by `path`: loaded now if the file exists, written by save().
+        // An unreadable or corrupt file leaves the cache empty.
+        explicit signature_cache(const std::filesystem::path &path);
+
+        // Identity of the build of `module`: its GNU build ID on ELF, otherwise a hash of the headers
+        // module::sections() reads (file header, image size, checksum, entry point and the section table).
+        // Combined with the size of the module; 0 if the headers cannot be read.
+        static uint64_t build_id(const module &module);
+        // build_id as the lookups use it: read once per module (process, begin and end) and remembered until clear(),
+        // so a cached hit costs a single read.
+        uint64_t module_build(const module &module);
+
+        // First match of `kernel` in `module`, nullptr if none.
+        pointer find(const module &module, const scan_kernel &kernel);
+        // Pattern and mask follow the conventions of memory::find_by_pattern.
+        pointer find(const module &module, const char *pattern, const char *mask);
+        template<size_t N>
+        inline pointer find(const module &module, const signature<N> &signature) { return find(module, signature.kernel()); }
+
+        // First match of every kernel. Cached RVAs are checked with a single vectored read,
+        // the rest is searched for in a single pass over the module (see signature_set).
+        std::vector<pointer> find(const module &module, const std::vector<scan_kernel> &kernels);
+
+        // Replaces the contents with the file at `path`, returns false (leaving the cache empty) if it cannot be read.
+        bool load(const std::filesystem::path &path);
+        // Writes to the file the cache was created with / to `path`, replacing it atomically. Throws on failure.
+        void save() const;
+        void save(const std::filesystem::path &path) const;
+
+        size_t size() const;
+        void clear();
+        counters stats() const;
+
+    private:
+        struct key {
+            uint64_t build;
+            uint64_t signature;
+            inline bool operator==(const key &rhs) const { return build == rhs.build && signature == rhs.signature; }
+        };
+
+        struct key_hash {
+            inline size_t operator()(const key &k) const { return (size_t)(k.build ^ (k.signature * 0x9E3779B97F4A7C15ull)); }
+        };
+
+        struct module_key {
+            HANDLE process;
+            uintptr_t begin;
+            uintptr_t end;
+            inline bool operator==(const module_key &rhs) const { return process == rhs.process && begin == rhs.begin && end == rhs.end; }
+        };
+
+        struct module_key_hash {
+            inline size_t operator()(const module_key &k) const {
+                return (size_t)(((uint64_t)(uintptr_t)k.process * 0x9E3779B97F4A7C15ull) ^ k.begin ^ ((uint64_t)k.end << 1));
+            }
+        };
+
+        static uint64_t signature_id(const scan_kernel &kernel);
+        bool lookup(const key &k, uint32_t &rva) const;
+        void store(const key &k, const module &module, const pointer &match);
+
+        std::filesystem::path _path;
+        mutable std::mutex _mutex;
+        std::unordered_map<key, uint32_t, key_hash> _entries;
+        std::unordered_map<module_key, uint64_t, module_key_hash> _builds;
+        counters _counters = {};
+    };
+
+}
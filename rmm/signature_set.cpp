@@ -0,0 +1,199 @@
+#include "signature_set.h"
+
+#include <stdexcept>
+#include <string>
+
+using namespace rmm;
+
+signature_set::id signature_set::add(const char *pattern, const char *mask) {
+    size_t length;
+    if (!memory::prepare_pattern(pattern, mask, length))
+        throw std::invalid_argument("empty pattern");
+    return add(pattern, mask, length);
+}
+
+signature_set::id signature_set::add(const char *data, size_t length) {
+    if (length == 0)
+        throw std::invalid_argument("empty pattern");
+    std::string mask(length, '\xFF');
+    return add(data, mask.data(), length);
+}
+
+signature_set::id signature_set::add(const scan_kernel &kernel) {
+    if (kernel.length() == 0)
+        throw std::invalid_argument("empty pattern");
+    return add(kernel.pattern().data(), kernel.mask().data(), kernel.length());
+}
+
+signature_set::id signature_set::add(const char *pattern, const char *mask, size_t length) {
+    signature sig{ scan_kernel(pattern, mask, length), no_anchor, 0, 0 };
+
+    auto fixed = [&](size_t i) { return mask[i] == '\xFF'; };
+    auto frequency = [&](size_t i) { return scan_kernel::byte_frequency((unsigned char)pattern[i]); };
+
+    unsigned best = ~0u;
+    for (size_t i = 0; i + 1 < length; i++) {
+        if (fixed(i) && fixed(i + 1) && frequency(i) + frequency(i + 1) < best) {
+            best = frequency(i) + frequency(i + 1);
+            sig.kind = pair_anchor;
+            sig.anchor = (uint32_t)i;
+            sig.key = (uint16_t)((unsigned char)pattern[i] | (unsigned char)pattern[i + 1] << 8);
+        }
+    }
+    if (sig.kind == no_anchor) {
+        for (size_t i = 0; i < length; i++) {
+            if (fixed(i) && frequency(i) < best) {
+                best = frequency(i);
+                sig.kind = byte_anchor;
+                sig.anchor = (uint32_t)i;
+                sig.key = (unsigned char)pattern[i];
+            }
+        }
+    }
+
+    if (length > _max_length)
+        _max_length = length;
+    if (sig.kernel.matches_zero())
+        _matches_zero = true;
+    _signatures.push_back(std::move(sig));
+    _table.reset();
+    return _signatures.size() - 1;
+}
+
+void signature_set::compile() {
+    _table = build();
+}
+
+std::shared_ptr<const signature_set::anchor_table> signature_set::build() const {
+    auto table = std::make_shared<anchor_table>();
+    auto &t = *table;
+
+    t.pair_filter.assign(0x10000 / 64, 0);
+    t.pair_begin.assign(0x10000 + 1, 0);
+    t.byte_begin.assign(0x100 + 1, 0);
+
+    for (auto &sig : _signatures) {
+        if (sig.kind == pair_anchor)
+            t.pair_begin[sig.key + 1]++;
+        else if (sig.kind == byte_anchor)
+            t.byte_begin[sig.key + 1]++;
+    }
+    for (size_t i = 1; i < t.pair_begin.size(); i++)
+        t.pair_begin[i] += t.pair_begin[i - 1];
+    for (size_t i = 1; i < t.byte_begin.size(); i++)
+        t.byte_begin[i] += t.byte_begin[i - 1];
+
+    t.pair_entries.resize(t.pair_begin.back());
+    t.byte_entries.resize(t.byte_begin.back());
+    std::vector<uint32_t> pair_fill(t.pair_begin.begin(), t.pair_begin.end() - 1);
+    std::vector<uint32_t> byte_fill(t.byte_begin.begin(), t.byte_begin.end() - 1);
+    for (uint32_t id = 0; id < _signatures.size(); id++) {
+        auto &sig = _signatures[id];
+        switch (sig.kind) {
+        case pair_anchor:
+            t.pair_entries[pair_fill[sig.key]++] = { id, sig.anchor };
+            t.pair_filter[sig.key / 64] |= 1ull << (sig.key % 64);
+            break;
+        case byte_anchor:
+            t.byte_entries[byte_fill[sig.key]++] = { id, sig.anchor };
+            break;
+        default:
+            t.unanchored.push_back(id);
+            break;
+        }
+    }
+
+    return table;
+}
+
+template<typename F>
+void signature_set::scan_chunk(const anchor_table &table, uintptr_t address, const char *chunk, size_t size, uintptr_t reported_end, const std::vector<bool> &skip, F &&fn) const {
+    auto verify = [&](const entry &e, size_t position) {
+        if (skip[e.signature] || position < e.anchor)
+            return;
+        auto start = position - e.anchor;
+        auto &sig = _signatures[e.signature];
+        if (start + sig.kernel.length() > size)
+            return;
+        if (address + start + sig.kernel.length() <= reported_end)
+            return;
+        if (sig.kernel.matches(chunk + start))
+            fn(e.signature, address + start);
+    };
+
+    auto data = (const unsigned char*)chunk;
+    bool has_bytes = !table.byte_entries.empty();
+    for (size_t i = 0; i < size; i++) {
+        if (has_bytes) {
+            for (auto b = table.byte_begin[data[i]], b_end = table.byte_begin[data[i] + 1]; b != b_end; b++)
+                verify(table.byte_entries[b], i);
+        }
+        if (i + 1 == size)
+            break;
+        unsigned key = data[i] | data[i + 1] << 8;
+        if (!(table.pair_filter[key / 64] >> (key % 64) & 1))
+            continue;
+        for (auto p = table.pair_begin[key], p_end = table.pair_begin[key + 1]; p != p_end; p++)
+            verify(table.pair_entries[p], i);
+    }
+
+    for (auto id : table.unanchored) {
+        if (skip[id])
+            continue;
+        auto &kernel = _signatures[id].kernel;
+        for (auto p = kernel.first(chunk, size); p != nullptr; p = kernel.first(p + 1, chunk + size - (p + 1))) {
+            if (address + (p - chunk) + kernel.length() > reported_end) {
+                fn(id, address + (p - chunk));
+                if (skip[id])
+                    break;
+            }
+        }
+    }
+}
+
+template<typename F>
+void signature_set::scan(const memory &memory, bool first_only, F &&fn) const {
+    if (_signatures.empty())
+        return;
+    auto table = _table ? _table : build();
+
+    std::vector<bool> skip(_signatures.size(), false);
+    auto remaining = _signatures.size();
+    auto report = [&](id id, uintptr_t address) {
+        fn(id, address);
+        if (first_only) {
+            skip[id] = true;
+            remaining--;
+        }
+    };
+
+    region_reader reader(memory.begin().process(), memory.scan_budget());
+    for (auto &region : _matches_zero ? memory.regions() : memory.populated_regions(_max_length - 1)) {
+        uintptr_t reported_end = region.begin();
+        bool more = reader.forward(region.begin(), region.end(), _max_length - 1, [&](uintptr_t address, const char *chunk, size_t size) {
+            scan_chunk(*table, address, chunk, size, reported_end, skip, report);
+            reported_end = address + size;
+            return remaining != 0;
+        });
+        if (!more)
+            break;
+    }
+}
+
+std::vector<std::vector<pointer>> signature_set::find(const memory &memory) const {
+    auto process = memory.begin().process();
+    std::vector<std::vector<pointer>> matches(_signatures.size());
+    scan(memory, false, [&](id id, uintptr_t address) {
+        matches[id].emplace_back(process, address);
+    });
+    return matches;
+}
+
+std::vector<pointer> signature_set::find_first(const memory &memory) const {
+    auto process = memory.begin().process();
+    std::vector<pointer> matches(_signatures.size(), pointer(process, nullptr));
+    scan(memory, true, [&](id id, uintptr_t address) {
+        matches[id] = pointer(process, address);
+    });
+    return matches;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "typedefs.h"
+#include "pointer.h"
+#include "memory.h"
+#include "scan_kernel.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace rmm {
+
+    // Many signatures matched in a single pass over memory.
+    // Signatures are bucketed by an anchor: the rarest pair of adjacent fully masked bytes
+    // (or the rarest single one, if there is no such pair). While scanning, every position is looked up
+    // in the anchor table and only signatures sharing the anchor at that position are verified.
+    // Signatures without any fully masked byte are searched for separately in each chunk.
+    class signature_set {
+    public:
+        typedef size_t id;
+
+        // Pattern and mask follow the conventions of memory::find_by_pattern.
+        id add(const char *pattern, const char *mask);
+        // Exact signature.
+        id add(const char *data, size_t length);
+        // Compiled pattern, wildcards included.
+        id add(const scan_kernel &kernel);
+
+        inline size_t size() const { return _signatures.size(); }
+
+        // Builds the anchor table. Must be called after the last `add`,
+        // otherwise every `find` builds a temporary table of its own.
+        void compile();
+
+        // Every match of every signature (indexed by id) in ascending order of address.
+        std::vector<std::vector<pointer>> find(const memory &memory) const;
+        // First match of every signature (indexed by id), nullptr if none.
+        // Scanning stops as soon as each signature has been found.
+        std::vector<pointer> find_first(const memory &memory) const;
+
+    private:
+        enum anchor_kind {
+            pair_anchor,
+            byte_anchor,
+            no_anchor,
+        };
+
+        struct signature {
+            scan_kernel kernel;
+            anchor_kind kind;
+            uint32_t anchor;
+            uint16_t key;
+        };
+
+        id add(const char *pattern, const char *mask, size_t length);
+
+        struct entry {
+            uint32_t signature;
+            uint32_t anchor;
+        };
+
+        // Anchors of two bytes (little-endian pair) and of a single byte, as CSR tables.
+        struct anchor_table {
+            std::vector<uint64_t> pair_filter;
+            std::vector<uint32_t> pair_begin;
+            std::vector<entry> pair_entries;
+            std::vector<uint32_t> byte_begin;
+            std::vector<entry> byte_entries;
+            std::vector<uint32_t> unanchored;
+        };
+
+        std::shared_ptr<const anchor_table> build() const;
+        // Calls `fn(id, address)` for matches in the chunk which end after `reported_end`.
+        template<typename F>
+        void scan_chunk(const anchor_table &table, uintptr_t address, const char *chunk, size_t size, uintptr_t reported_end, const std::vector<bool> &skip, F &&fn) const;
+        template<typename F>
+        void scan(const memory &memory, bool first_only, F &&fn) const;
+
+        std::vector<signature> _signatures;
+        size_t _max_length = 0;
+        bool _matches_zero = false;
+        std::shared_ptr<const anchor_table> _table;
+    };
+
+}
@@ -0,0 +1,201 @@
+#include "statistics.h"
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using namespace rmm;
+
+namespace {
+
+#if RMM_STATISTICS
+    // Counters of a thread. Only the owning thread writes them, others may read them at any time.
+    struct local_block;
+
+    struct registry {
+        std::mutex mutex;
+        std::vector<local_block*> blocks;
+        statistics::snapshot retired;
+    };
+
+    registry& blocks() {
+        static registry instance;
+        return instance;
+    }
+
+    struct local_block {
+        std::atomic<uint64_t> counters[statistics::counter_count] = {};
+        std::atomic<uint64_t> nanoseconds[statistics::phase_count] = {};
+        statistics::sink *sink = nullptr;
+        registry &owner;
+
+        local_block()
+            : owner(blocks())
+        {
+            std::lock_guard lock(owner.mutex);
+            owner.blocks.push_back(this);
+        }
+
+        ~local_block() {
+            std::lock_guard lock(owner.mutex);
+            owner.retired += load();
+            owner.blocks.erase(std::find(owner.blocks.begin(), owner.blocks.end(), this));
+        }
+
+        statistics::snapshot load() const {
+            statistics::snapshot s;
+            for (unsigned i = 0; i < statistics::counter_count; i++)
+                s.counters[i] = counters[i].load(std::memory_order_relaxed);
+            for (unsigned i = 0; i < statistics::phase_count; i++)
+                s.nanoseconds[i] = nanoseconds[i].load(std::memory_order_relaxed);
+            return s;
+        }
+    };
+
+    local_block& local() {
+        thread_local local_block block;
+        return block;
+    }
+
+    inline void bump(std::atomic<uint64_t> &value, uint64_t n) {
+        value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+#endif
+
+    std::atomic<bool> has_trace_hook{ false };
+    std::shared_ptr<const statistics::trace_hook> trace_hook;
+
+}
+
+statistics::snapshot& statistics::snapshot::operator+=(const snapshot &rhs) {
+    for (unsigned i = 0; i < counter_count; i++)
+        counters[i] += rhs.counters[i];
+    for (unsigned i = 0; i < phase_count; i++)
+        nanoseconds[i] += rhs.nanoseconds[i];
+    return *this;
+}
+
+statistics::snapshot& statistics::snapshot::operator-=(const snapshot &rhs) {
+    for (unsigned i = 0; i < counter_count; i++)
+        counters[i] -= rhs.counters[i];
+    for (unsigned i = 0; i < phase_count; i++)
+        nanoseconds[i] -= rhs.nanoseconds[i];
+    return *this;
+}
+
+statistics::snapshot statistics::sink::load() const {
+    snapshot s;
+    for (unsigned i = 0; i < counter_count; i++)
+        s.counters[i] = counters[i].load(std::memory_order_relaxed);
+    for (unsigned i = 0; i < phase_count; i++)
+        s.nanoseconds[i] = nanoseconds[i].load(std::memory_order_relaxed);
+    return s;
+}
+
+void statistics::sink::reset() {
+    for (auto &c : counters)
+        c.store(0, std::memory_order_relaxed);
+    for (auto &t : nanoseconds)
+        t.store(0, std::memory_order_relaxed);
+}
+
+const char* statistics::name(counter c) {
+    static const char *names[counter_count] = {
+        "query_calls",
+        "read_calls",
+        "write_calls",
+        "protect_calls",
+        "enumeration_calls",
+        "bytes_read",
+        "bytes_written",
+        "failed_reads",
+        "failed_writes",
+        "regions_visited",
+        "chunks_read",
+        "bytes_skipped",
+        "pointer_reads",
+        "pointer_writes",
+        "modules_resolved",
+    };
+    return c < counter_count ? names[c] : "";
+}
+
+const char* statistics::name(phase p) {
+    static const char *names[phase_count] = {
+        "enumerate_regions",
+        "read_chunk",
+        "scan_region",
+        "resolve_module",
+    };
+    return p < phase_count ? names[p] : "";
+}
+
+statistics::snapshot statistics::thread() {
+#if RMM_STATISTICS
+    return local().load();
+#else
+    return {};
+#endif
+}
+
+statistics::snapshot statistics::global() {
+#if RMM_STATISTICS
+    auto &r = blocks();
+    std::lock_guard lock(r.mutex);
+    auto total = r.retired;
+    for (auto block : r.blocks)
+        total += block->load();
+    return total;
+#else
+    return {};
+#endif
+}
+
+void statistics::set_trace_hook(trace_hook hook) {
+    std::shared_ptr<const statistics::trace_hook> p;
+    if (hook)
+        p = std::make_shared<const statistics::trace_hook>(std::move(hook));
+    std::atomic_store(&::trace_hook, p);
+    has_trace_hook.store(p != nullptr, std::memory_order_release);
+}
+
+#if RMM_STATISTICS
+
+void statistics::add(counter c, uint64_t n) {
+    auto &block = local();
+    bump(block.counters[c], n);
+    if (block.sink != nullptr)
+        block.sink->counters[c].fetch_add(n, std::memory_order_relaxed);
+}
+
+void statistics::add_time(phase p, uint64_t nanoseconds) {
+    auto &block = local();
+    bump(block.nanoseconds[p], nanoseconds);
+    if (block.sink != nullptr)
+        block.sink->nanoseconds[p].fetch_add(nanoseconds, std::memory_order_relaxed);
+}
+
+statistics::scope::scope(sink *sink) {
+    auto &block = local();
+    _previous = block.sink;
+    block.sink = sink;
+}
+
+statistics::scope::~scope() {
+    local().sink = _previous;
+}
+
+void statistics::timer::stop(uint64_t bytes) {
+    if (_stopped)
+        return;
+    _stopped = true;
+    auto nanoseconds = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - _start).count();
+    add_time(_phase, nanoseconds);
+    if (has_trace_hook.load(std::memory_order_acquire)) {
+        if (auto hook = std::atomic_load(&::trace_hook))
+            (*hook)({ _phase, _begin, _end, bytes, nanoseconds });
+    }
+}
+
+#endif
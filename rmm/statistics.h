@@ -0,0 +1,155 @@
+#pragma once
+
+#include "typedefs.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+
+// Instrumentation of I/O and scanning. Compile with RMM_STATISTICS=0 to remove it:
+// counting and timing compile to nothing and snapshots stay zero.
+#ifndef RMM_STATISTICS
+#define RMM_STATISTICS 1
+#endif
+
+namespace rmm {
+
+    // Counters and per-phase times, kept per thread (for every thread that touched rmm)
+    // and, while a collecting memory object is scanning, also per memory object (see memory::collect_stats).
+    class statistics {
+    public:
+        enum counter : unsigned {
+            // calls into the OS made by the native backends
+            query_calls,        // VirtualQueryEx, /proc/<pid>/maps (which also list modules on Linux) and pagemap reads
+            read_calls,         // ReadProcessMemory, process_vm_readv, pread on /proc/<pid>/mem
+            write_calls,        // WriteProcessMemory, process_vm_writev, pwrite on /proc/<pid>/mem
+            protect_calls,      // VirtualProtectEx, mprotect
+            enumeration_calls,  // Toolhelp snapshots, /proc listings
+            bytes_read,
+            bytes_written,
+            failed_reads,
+            failed_writes,
+            // work done by rmm
+            regions_visited,    // regions (or pieces of them) searched by memory scans
+            chunks_read,        // buffers filled by region_reader and match_range
+            bytes_skipped,      // never populated memory left out of scans (see memory::populated_regions)
+            pointer_reads,      // pointer::read, operator>>, operator*
+            pointer_writes,     // pointer::operator<<
+            modules_resolved,   // module lookups by name
+            counter_count
+        };
+
+        enum phase : unsigned {
+            enumerate_regions,  // memory::regions
+            read_chunk,         // filling a scan buffer
+            scan_region,        // searching a region, reading included
+            resolve_module,     // module lookup by name
+            phase_count
+        };
+
+        struct snapshot {
+            uint64_t counters[counter_count] = {};
+            uint64_t nanoseconds[phase_count] = {};
+
+            inline uint64_t operator[](counter c) const { return counters[c]; }
+            inline uint64_t time(phase p) const { return nanoseconds[p]; }
+            inline uint64_t syscalls() const {
+                return counters[query_calls] + counters[read_calls] + counters[write_calls]
+                    + counters[protect_calls] + counters[enumeration_calls];
+            }
+
+            snapshot& operator+=(const snapshot &rhs);
+            snapshot& operator-=(const snapshot &rhs);
+            inline snapshot operator+(const snapshot &rhs) const { auto s = *this; return s += rhs; }
+            inline snapshot operator-(const snapshot &rhs) const { auto s = *this; return s -= rhs; }
+        };
+
+        // Accumulator shared by a memory object and its copies, updated from every thread working for it.
+        struct sink {
+            std::atomic<uint64_t> counters[counter_count] = {};
+            std::atomic<uint64_t> nanoseconds[phase_count] = {};
+
+            snapshot load() const;
+            void reset();
+        };
+
+        // Completed phase, reported to the trace hook: [begin, end) is the address range it covered
+        // (empty if not applicable), `bytes` what it transferred or searched.
+        struct trace_event {
+            phase kind;
+            uintptr_t begin;
+            uintptr_t end;
+            uint64_t bytes;
+            uint64_t nanoseconds;
+        };
+        typedef std::function<void(const trace_event &event)> trace_hook;
+
+        static const char* name(counter c);
+        static const char* name(phase p);
+
+        // Counters of the calling thread since it started.
+        static snapshot thread();
+        // Sum over every thread, including the ones which have exited.
+        static snapshot global();
+
+        // Called on the thread completing the phase, must be thread safe. Empty to remove.
+        static void set_trace_hook(trace_hook hook);
+
+#if RMM_STATISTICS
+        static void add(counter c, uint64_t n = 1);
+        static void add_time(phase p, uint64_t nanoseconds);
+#else
+        static inline void add(counter, uint64_t = 1) {}
+        static inline void add_time(phase, uint64_t) {}
+#endif
+
+        // Routes counting on the calling thread to `sink` as well (nullptr - none) until destroyed.
+        class scope {
+        public:
+#if RMM_STATISTICS
+            explicit scope(sink *sink);
+            ~scope();
+#else
+            explicit scope(sink*) {}
+#endif
+            scope(const scope&) = delete;
+            scope& operator=(const scope&) = delete;
+
+#if RMM_STATISTICS
+        private:
+            sink *_previous;
+#endif
+        };
+
+        // Times a phase from construction to destruction (or `stop`).
+        class timer {
+        public:
+#if RMM_STATISTICS
+            explicit timer(phase p, uintptr_t begin = 0, uintptr_t end = 0)
+                : _phase(p)
+                , _begin(begin)
+                , _end(end)
+                , _start(std::chrono::steady_clock::now())
+            {}
+            inline ~timer() { stop(); }
+            void stop(uint64_t bytes = 0);
+#else
+            explicit timer(phase, uintptr_t = 0, uintptr_t = 0) {}
+            inline void stop(uint64_t = 0) {}
+#endif
+            timer(const timer&) = delete;
+            timer& operator=(const timer&) = delete;
+
+#if RMM_STATISTICS
+        private:
+            phase _phase;
+            uintptr_t _begin;
+            uintptr_t _end;
+            std::chrono::steady_clock::time_point _start;
+            bool _stopped = false;
+#endif
+        };
+    };
+
+}
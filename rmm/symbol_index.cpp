@@ -0,0 +1,134 @@
+#include "symbol_index.h"
+#include "backend.h"
+
+#include <cwctype>
+
+using namespace rmm;
+
+namespace {
+
+    const int max_forwarding = 8;
+
+    std::wstring lowercase(std::wstring name) {
+        for (auto &c : name)
+            c = (wchar_t)std::towlower(c);
+        return name;
+    }
+
+}
+
+symbol_index::symbol_index(HANDLE process)
+    : _process(process)
+{}
+
+std::shared_ptr<const symbol_index> symbol_index::build(HANDLE process, thread_pool *pool) {
+    auto modules = backend::of(process).modules(process);
+
+    std::shared_ptr<symbol_index> index(new symbol_index(process));
+    index->_images.resize(modules.size());
+    auto parse = [&](size_t i, size_t) {
+        index->_images[i] = module_image::parse(process, modules[i].begin, modules[i].end);
+    };
+    if (pool != nullptr) {
+        pool->parallel_for(modules.size(), parse);
+    } else {
+        for (size_t i = 0; i < modules.size(); i++)
+            parse(i, 0);
+    }
+
+    for (size_t i = 0; i < modules.size(); i++) {
+        auto &image = *index->_images[i];
+        index->_by_module.emplace(lowercase(modules[i].name), i);
+        for (auto &entry : image.exports()) {
+            if (!entry.name.empty())
+                index->_exports[entry.name].push_back({ &image, &entry });
+        }
+        for (auto &entry : image.imports()) {
+            if (!entry.name.empty())
+                index->_imports[entry.name].push_back(&entry);
+        }
+    }
+    return index;
+}
+
+const module_image* symbol_index::image(const std::wstring &module) const {
+    auto it = _by_module.find(lowercase(module));
+    return it != _by_module.end() ? _images[it->second].get() : nullptr;
+}
+
+uintptr_t symbol_index::resolve(const module_image::export_entry &entry, int depth) const {
+    if (entry.indirect)
+        return resolve_indirect(entry);
+    if (entry.forwarder.empty())
+        return entry.address;
+    if (depth == max_forwarding)
+        return 0;
+
+    // "module.name" or "module.#ordinal", the module named without its extension
+    auto dot = entry.forwarder.rfind('.');
+    if (dot == std::string::npos)
+        return 0;
+    std::wstring module(entry.forwarder.begin(), entry.forwarder.begin() + dot);
+    auto target = this->image(module + L".dll");
+    if (target == nullptr)
+        target = this->image(module);
+    if (target == nullptr)
+        return 0;
+
+    auto name = entry.forwarder.substr(dot + 1);
+    const module_image::export_entry *forwarded;
+    if (!name.empty() && name[0] == '#')
+        forwarded = target->find_export((DWORD)std::strtoul(name.c_str() + 1, nullptr, 10));
+    else
+        forwarded = target->find_export(name);
+    return forwarded != nullptr ? resolve(*forwarded, depth + 1) : 0;
+}
+
+uintptr_t symbol_index::resolve_indirect(const module_image::export_entry &entry) const {
+    // The function is whatever the resolver picked, which only the slots bound to it tell:
+    // a filled slot points into the defining image, somewhere else than the resolver.
+    const module_image *definer = nullptr;
+    for (auto &image : _images) {
+        if (image->begin() <= entry.address && entry.address < image->end())
+            definer = image.get();
+    }
+    if (definer == nullptr)
+        return 0;
+    auto it = _imports.find(entry.name);
+    if (it == _imports.end())
+        return 0;
+    for (auto slot : it->second) {
+        uint64_t value = 0;
+        if (pointer(_process, slot->slot).read(&value, definer->is_64bit() ? 8 : 4))
+            continue;
+        if (value != entry.address && value >= definer->begin() && value < definer->end())
+            return (uintptr_t)value;
+    }
+    return 0;
+}
+
+pointer symbol_index::find(const std::string &name) const {
+    auto s = find_symbol(name);
+    return pointer(_process, s ? resolve(*s.entry, 0) : 0);
+}
+
+pointer symbol_index::find(const std::wstring &module, const std::string &name) const {
+    auto image = this->image(module);
+    auto entry = image != nullptr ? image->find_export(name) : nullptr;
+    return pointer(_process, entry != nullptr ? resolve(*entry, 0) : 0);
+}
+
+symbol_index::symbol symbol_index::find_symbol(const std::string &name) const {
+    auto it = _exports.find(name);
+    return it != _exports.end() ? it->second.front() : symbol{ nullptr, nullptr };
+}
+
+std::vector<symbol_index::symbol> symbol_index::find_all(const std::string &name) const {
+    auto it = _exports.find(name);
+    return it != _exports.end() ? it->second : std::vector<symbol>();
+}
+
+std::vector<const module_image::import_entry*> symbol_index::find_imports(const std::string &name) const {
+    auto it = _imports.find(name);
+    return it != _imports.end() ? it->second : std::vector<const module_image::import_entry*>();
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "typedefs.h"
+#include "pointer.h"
+#include "module_image.h"
+#include "thread_pool.h"
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace rmm {
+
+    // Exports and imports of every module of a process, by name.
+    // Each module is parsed once (see module_image), in parallel on `pool` if given;
+    // resolving a name afterwards is a single hash lookup, no matter how many modules there are.
+    class symbol_index {
+    public:
+        struct symbol {
+            const module_image *image;
+            const module_image::export_entry *entry;
+            explicit operator bool() const { return entry != nullptr; }
+        };
+
+        static std::shared_ptr<const symbol_index> build(HANDLE process, thread_pool *pool = nullptr);
+
+        inline HANDLE process() const { return _process; }
+        // Images in the order of backend::modules.
+        inline const std::vector<std::shared_ptr<const module_image>>& images() const { return _images; }
+        // Image of the module named `module` (case insensitive), nullptr if none.
+        const module_image* image(const std::wstring &module) const;
+
+        // Address of the export `name` of the first module defining it, nullptr if none.
+        // PE forwarders are followed. ELF indirect functions (STT_GNU_IFUNC) are resolved through an import slot
+        // the loader has filled with the function; nullptr if no module has one bound yet.
+        pointer find(const std::string &name) const;
+        pointer find(const std::wstring &module, const std::string &name) const;
+
+        // Export `name` of the first module defining it / of every one.
+        symbol find_symbol(const std::string &name) const;
+        std::vector<symbol> find_all(const std::string &name) const;
+
+        // Import slots of `name` in every module.
+        std::vector<const module_image::import_entry*> find_imports(const std::string &name) const;
+
+    private:
+        explicit symbol_index(HANDLE process);
+
+        uintptr_t resolve(const module_image::export_entry &entry, int depth) const;
+        uintptr_t resolve_indirect(const module_image::export_entry &entry) const;
+
+        HANDLE _process;
+        std::vector<std::shared_ptr<const module_image>> _images;
+        std::unordered_map<std::wstring, size_t> _by_module;
+        // names point into the images
+        std::unordered_map<std::string_view, std::vector<symbol>> _exports;
+        std::unordered_map<std::string_view, std::vector<const module_image::import_entry*>> _imports;
+    };
+
+}
@@ -0,0 +1,172 @@
+#include "thread_pool.h"
+
+#include <atomic>
+#include <exception>
+
+using namespace rmm;
+
+class thread_pool::job {
+public:
+    job(size_t count, size_t participants, const std::function<void(size_t, size_t)> &fn)
+        : _fn(fn)
+        , _shares(participants)
+        , _count(count)
+    {
+        for (size_t i = 0; i < participants; i++) {
+            _shares[i].begin = count * i / participants;
+            _shares[i].end = count * (i + 1) / participants;
+        }
+    }
+
+    // Runs indices until none are left to take or steal.
+    void work(size_t worker) {
+        size_t index;
+        while (take(worker, index) || steal(worker, index)) {
+            if (!_failed.load(std::memory_order_relaxed)) {
+                try {
+                    _fn(index, worker);
+                } catch (...) {
+                    std::lock_guard lock(_done_mutex);
+                    if (!_failed.exchange(true))
+                        _error = std::current_exception();
+                }
+            }
+            if (_done.fetch_add(1) + 1 == _count) {
+                std::lock_guard lock(_done_mutex);
+                _finished.notify_all();
+            }
+        }
+    }
+
+    void wait() {
+        std::unique_lock lock(_done_mutex);
+        _finished.wait(lock, [this] { return _done.load() == _count; });
+        if (_error)
+            std::rethrow_exception(_error);
+    }
+
+private:
+    struct share {
+        std::mutex mutex;
+        size_t begin = 0;
+        size_t end = 0;
+    };
+
+    bool take(size_t worker, size_t &index) {
+        auto &own = _shares[worker];
+        std::lock_guard lock(own.mutex);
+        if (own.begin == own.end)
+            return false;
+        index = own.begin++;
+        return true;
+    }
+
+    bool steal(size_t worker, size_t &index) {
+        for (size_t i = 1; i < _shares.size(); i++) {
+            auto &victim = _shares[(worker + i) % _shares.size()];
+            size_t begin, end;
+            {
+                std::lock_guard lock(victim.mutex);
+                auto left = victim.end - victim.begin;
+                if (left == 0)
+                    continue;
+                // the victim keeps the lower half, its next indices stay in ascending order
+                begin = victim.end - (left + 1) / 2;
+                end = victim.end;
+                victim.end = begin;
+            }
+            auto &own = _shares[worker];
+            std::lock_guard lock(own.mutex);
+            index = begin;
+            own.begin = begin + 1;
+            own.end = end;
+            return true;
+        }
+        return false;
+    }
+
+    const std::function<void(size_t, size_t)> &_fn;
+    std::vector<share> _shares;
+    size_t _count;
+    std::atomic<size_t> _done{ 0 };
+    std::atomic<bool> _failed{ false };
+    std::exception_ptr _error;
+    std::mutex _done_mutex;
+    std::condition_variable _finished;
+};
+
+thread_pool::thread_pool(size_t threads) {
+    for (size_t i = 0; i < threads; i++)
+        _threads.emplace_back(&thread_pool::run, this, i + 1);
+}
+
+thread_pool::~thread_pool() {
+    {
+        std::lock_guard lock(_mutex);
+        _stopping = true;
+    }
+    _wakeup.notify_all();
+    for (auto &thread : _threads)
+        thread.join();
+}
+
+void thread_pool::parallel_for(size_t count, const std::function<void(size_t, size_t)> &fn) {
+    if (count == 0)
+        return;
+
+    if (_threads.empty() || count == 1) {
+        for (size_t i = 0; i < count; i++)
+            fn(i, 0);
+        return;
+    }
+
+    auto j = std::make_shared<job>(count, concurrency(), fn);
+    {
+        std::lock_guard lock(_mutex);
+        _jobs.push_back(j);
+    }
+    _wakeup.notify_all();
+
+    j->work(0);
+    j->wait();
+
+    std::lock_guard lock(_mutex);
+    for (auto it = _jobs.begin(); it != _jobs.end(); ++it) {
+        if (*it == j) {
+            _jobs.erase(it);
+            break;
+        }
+    }
+}
+
+void thread_pool::run(size_t worker) {
+    while (true) {
+        std::shared_ptr<job> j;
+        {
+            std::unique_lock lock(_mutex);
+            _wakeup.wait(lock, [this] {
+                return _stopping || !_jobs.empty();
+            });
+            if (_stopping)
+                return;
+            j = _jobs.front();
+        }
+
+        j->work(worker);
+
+        // Nothing is left to take from this job, let others through.
+        std::unique_lock lock(_mutex);
+        if (!_jobs.empty() && _jobs.front() == j)
+            _jobs.pop_front();
+    }
+}
+
+size_t thread_pool::default_threads() {
+    auto threads = std::thread::hardware_concurrency();
+    return threads > 1 ? threads - 1 : 0;
+}
+
+thread_pool& thread_pool::shared() {
+    static thread_pool pool;
+    return pool;
+}
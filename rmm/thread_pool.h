@@ -0,0 +1,51 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace rmm {
+
+    // Fixed set of worker threads running parallel loops.
+    // Every participant of a loop (workers and the calling thread) starts with its own contiguous share of indices
+    // and, once it is exhausted, steals half of the remaining share of another participant.
+    class thread_pool {
+    public:
+        // `threads` workers in addition to the thread calling `parallel_for`.
+        explicit thread_pool(size_t threads = default_threads());
+        ~thread_pool();
+
+        thread_pool(const thread_pool&) = delete;
+        thread_pool& operator=(const thread_pool&) = delete;
+
+        // Number of participants of a loop, i.e. the upper bound of `worker` passed to `fn`.
+        inline size_t concurrency() const { return _threads.size() + 1; }
+
+        // Calls `fn(index, worker)` for every index in [0, count) and waits for completion.
+        // Indices are taken in ascending order within each share.
+        // If `fn` throws, remaining indices are skipped and the first exception is rethrown.
+        void parallel_for(size_t count, const std::function<void(size_t index, size_t worker)> &fn);
+
+        // One worker per hardware thread, except the one calling `parallel_for`.
+        static size_t default_threads();
+        // Pool shared by default by parallel scans.
+        static thread_pool& shared();
+
+    private:
+        class job;
+
+        void run(size_t worker);
+
+        std::vector<std::thread> _threads;
+        std::mutex _mutex;
+        std::condition_variable _wakeup;
+        std::deque<std::shared_ptr<job>> _jobs;
+        bool _stopping = false;
+    };
+
+}
@@ -0,0 +1,100 @@
+#include "tracked_scan.h"
+#include "region_reader.h"
+
+#include <algorithm>
+#include <iterator>
+
+using namespace rmm;
+
+tracked_scan::tracked_scan(const memory &memory, const scan_kernel &kernel, const change_tracker &tracker)
+    : _memory(memory)
+    , _kernel(kernel)
+    , _tracker(tracker)
+{}
+
+std::vector<pointer> tracked_scan::rescan(const std::vector<change_tracker::page_range> &windows) const {
+    // readable parts of the windows, each extended by the pattern length so that its matches are whole
+    auto process = _memory.begin().process();
+    auto overlap = _kernel.length() - 1;
+    std::vector<memory> pieces;
+    auto regions = _kernel.matches_zero() ? _memory.regions() : _memory.populated_regions(overlap);
+    auto region = regions.begin();
+    for (auto &w : windows) {
+        while (region != regions.end() && region->end() <= w.first)
+            ++region;
+        for (auto r = region; r != regions.end() && r->begin() < w.second; ++r) {
+            auto begin = (std::max)((uintptr_t)r->begin(), w.first);
+            auto end = (std::min)((uintptr_t)r->end(), w.second + overlap);
+            pieces.emplace_back(process, begin, end, true);
+            pieces.back().set_scan_budget(_memory.scan_budget());
+        }
+    }
+
+    std::vector<std::vector<pointer>> found(pieces.size());
+    auto pool = _memory.scan_pool();
+    if (pool == nullptr) {
+        region_reader reader(process, _memory.scan_budget());
+        for (size_t i = 0; i < pieces.size(); i++)
+            memory::find_in_region(reader, pieces[i], _kernel, found[i]);
+    } else {
+        std::vector<region_reader> readers(pool->concurrency(), region_reader(process, _memory.scan_budget()));
+        pool->parallel_for(pieces.size(), [&](size_t i, size_t worker) {
+            statistics::scope scope(_memory.stats_sink().get());
+            memory::find_in_region(readers[worker], pieces[i], _kernel, found[i]);
+        });
+    }
+
+    std::vector<pointer> matches;
+    for (auto &f : found)
+        matches.insert(matches.end(), f.begin(), f.end());
+    return matches;
+}
+
+size_t tracked_scan::update() {
+    statistics::scope scope(_memory.stats_sink().get());
+    auto previous = std::move(_matches);
+    _matches.clear();
+    _added.clear();
+    _removed.clear();
+
+    if (!_scanned || _tracker.epoch() != _scanned_epoch + 1) {
+        _matches = _memory.find(_kernel);
+    } else {
+        // Matches starting in [changed page - (length - 1), end of changed page) may differ.
+        auto length = _kernel.length();
+        auto begin = (uintptr_t)_memory.begin();
+        auto end = (uintptr_t)_memory.end();
+        std::vector<change_tracker::page_range> windows;
+        for (auto &c : _tracker.changes()) {
+            auto first = (std::max)(c.first - (std::min)(c.first, (uintptr_t)length - 1), begin);
+            auto last = (std::min)(c.second, end);
+            if (first >= last)
+                continue;
+            if (!windows.empty() && windows.back().second >= first)
+                windows.back().second = last;
+            else
+                windows.emplace_back(first, last);
+        }
+
+        auto found = rescan(windows);
+        auto f = found.begin();
+        auto w = windows.begin();
+        _matches.reserve(previous.size() + found.size());
+        for (auto &match : previous) {
+            while (w != windows.end() && w->second <= match)
+                ++w;
+            if (w != windows.end() && w->first <= match)
+                continue;
+            for (; f != found.end() && *f < match; ++f)
+                _matches.push_back(*f);
+            _matches.push_back(match);
+        }
+        _matches.insert(_matches.end(), f, found.end());
+    }
+
+    std::set_difference(_matches.begin(), _matches.end(), previous.begin(), previous.end(), std::back_inserter(_added));
+    std::set_difference(previous.begin(), previous.end(), _matches.begin(), _matches.end(), std::back_inserter(_removed));
+    _scanned = true;
+    _scanned_epoch = _tracker.epoch();
+    return _matches.size();
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "typedefs.h"
+#include "pointer.h"
+#include "memory.h"
+#include "scan_kernel.h"
+#include "change_tracker.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace rmm {
+
+    // Matches of a compiled pattern within `memory`, kept up to date from one epoch of `tracker` to the next.
+    // `update` rescans only the pages changed during the last epoch, widened by the pattern length
+    // so that matches crossing into them are found again; everything at the first call,
+    // or if the tracker did not advance exactly once since the previous update.
+    // The tracker must outlive the scan.
+    //
+    //     change_tracker tracker(heap);
+    //     tracked_scan scan(heap, kernel, tracker);
+    //     while (running) {
+    //         tracker.advance();
+    //         scan.update();
+    //         for (auto match : scan.added()) ...
+    //     }
+    class tracked_scan {
+    public:
+        tracked_scan(const memory &memory, const scan_kernel &kernel, const change_tracker &tracker);
+
+        // Returns the number of matches.
+        size_t update();
+
+        // Matches in ascending order of address.
+        inline const std::vector<pointer>& matches() const { return _matches; }
+        // Matches found / no longer found by the last update.
+        inline const std::vector<pointer>& added() const { return _added; }
+        inline const std::vector<pointer>& removed() const { return _removed; }
+
+    private:
+        std::vector<pointer> rescan(const std::vector<change_tracker::page_range> &windows) const;
+
+        memory _memory;
+        scan_kernel _kernel;
+        const change_tracker &_tracker;
+        bool _scanned = false;
+        uint64_t _scanned_epoch = 0;
+        std::vector<pointer> _matches;
+        std::vector<pointer> _added;
+        std::vector<pointer> _removed;
+    };
+
+}
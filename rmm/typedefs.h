@@ -1,5 +1,7 @@
 #pragma once
 
+#ifdef _WIN32
+
 #ifndef uintptr_t
 #ifdef _WIN64
 typedef unsigned __int64 uintptr_t;
@@ -15,3 +17,12 @@ typedef __int64 intptr_t;
 typedef int intptr_t;
 #endif
 #endif
+
+#else
+
+#include <cstdint>
+
+using std::uintptr_t;
+using std::intptr_t;
+
+#endif
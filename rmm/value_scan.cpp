@@ -0,0 +1,281 @@
+#include "value_scan.h"
+#include "batch.h"
+#include "change_tracker.h"
+#include "region_reader.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+using namespace rmm;
+
+namespace {
+
+    template<typename T, typename C>
+    inline bool test(C condition, T value, T previous, T a, T b) {
+        switch (condition) {
+        case C::any: return true;
+        case C::exact: return value == a;
+        case C::range: return a <= value && value <= b;
+        case C::changed: return value != previous;
+        case C::unchanged: return value == previous;
+        case C::increased: return value > previous;
+        case C::decreased: return value < previous;
+        }
+        return false;
+    }
+
+}
+
+template<typename T>
+value_scan<T>::value_scan(const memory &memory, size_t alignment)
+    : _memory(memory)
+    , _alignment(alignment)
+    , _page_size(backend::of(memory.begin().process()).page_size())
+{
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0 || alignment > _page_size)
+        throw std::invalid_argument("alignment must be a power of two not exceeding the page size");
+    if (_page_size > 0x10000)
+        throw std::invalid_argument("page size is too large");
+    _slots = _page_size / alignment;
+}
+
+template<typename T>
+void value_scan<T>::add(storage &storage, uintptr_t address, T value) const {
+    auto base = address & ~(uintptr_t)(_page_size - 1);
+    if (storage.pages.empty() || storage.pages.back().address != base) {
+        finish(storage);
+        storage.pages.push_back({ base, (uint32_t)storage.offsets.size(), 0, 0, false });
+    }
+    auto &page = storage.pages.back();
+    auto offset = (uint32_t)(address - base);
+    storage.offsets.push_back((uint16_t)offset);
+    page.count++;
+    page.end = offset + (uint32_t)sizeof(T);
+    storage.values.push_back(value);
+}
+
+template<typename T>
+void value_scan<T>::finish(storage &storage) const {
+    if (storage.pages.empty())
+        return;
+    auto &page = storage.pages.back();
+    // a bitmap takes less space than 16-bit offsets
+    if (page.dense || (size_t)page.count * 16 <= _slots)
+        return;
+
+    auto words = (_slots + 63) / 64;
+    auto index = storage.bitmaps.size();
+    storage.bitmaps.resize(index + words);
+    for (size_t i = 0; i < page.count; i++) {
+        auto slot = storage.offsets[page.index + i] / _alignment;
+        storage.bitmaps[index + slot / 64] |= 1ull << (slot % 64);
+    }
+    storage.offsets.resize(page.index);
+    page.index = (uint32_t)index;
+    page.dense = true;
+}
+
+template<typename T>
+size_t value_scan<T>::first(condition condition, T a, T b) {
+    if (condition != any && condition != exact && condition != range)
+        throw std::invalid_argument("condition requires a previous scan");
+
+    // zero bits are a zero value: never populated memory holds no candidates unless zero is one
+    auto matches_zero = test(condition, T(), T(), a, b);
+
+    storage result;
+    region_reader reader(_memory.begin().process(), _memory.scan_budget());
+    for (auto &region : matches_zero ? _memory.regions() : _memory.populated_regions(sizeof(T) - 1)) {
+        reader.forward(region.begin(), region.end(), sizeof(T) - 1, [&](uintptr_t address, const char *data, size_t size) {
+            // values starting in the overlap are left for the next chunk
+            auto p = (size_t)(((address + _alignment - 1) & ~(uintptr_t)(_alignment - 1)) - address);
+            for (; p + sizeof(T) <= size; p += _alignment) {
+                T value;
+                std::memcpy(&value, data + p, sizeof(T));
+                if (test(condition, value, value, a, b))
+                    add(result, address + p, value);
+            }
+            return true;
+        });
+    }
+    finish(result);
+
+    _storage = std::move(result);
+    _started = true;
+    scanned();
+    return count();
+}
+
+template<typename T>
+void value_scan<T>::scanned() {
+    _scanned_tracker = _tracker;
+    _scanned_epoch = _tracker != nullptr ? _tracker->epoch() : 0;
+}
+
+template<typename T>
+size_t value_scan<T>::next(condition condition, T a, T b) {
+    if (!_started)
+        throw std::logic_error("next scan without a first one");
+    if (condition == any)
+        return count();
+
+    struct piece {
+        size_t first;   // pages [first, last]
+        size_t last;
+        uintptr_t begin;
+        uintptr_t end;
+        size_t offset;  // in the buffer
+    };
+
+    auto process = _memory.begin().process();
+    auto budget = (std::max)(_memory.scan_budget(), _page_size + sizeof(T));
+    auto &pages = _storage.pages;
+
+    // pages left unchanged since the previous scan keep their values
+    auto tracked = _tracker != nullptr && _tracker == _scanned_tracker && _tracker->epoch() == _scanned_epoch + 1;
+    std::vector<char> unchanged(pages.size());
+    if (tracked) {
+        for (size_t i = 0; i < pages.size(); i++)
+            unchanged[i] = !_tracker->changed(pages[i].address, pages[i].address + pages[i].end);
+    }
+
+    storage result;
+    std::vector<char> buffer;
+    std::vector<piece> pieces;
+    std::vector<batch_entry> entries;
+    std::vector<batch_entry> retry;
+    std::vector<size_t> retry_pages;
+    std::vector<char> readable;
+    std::vector<const char*> data;
+    size_t value = 0;
+
+    for (size_t i = 0; i < pages.size(); ) {
+        // Ranges of adjacent pages with candidates, up to `budget` bytes in total.
+        pieces.clear();
+        size_t total = 0;
+        auto j = i;
+        for (; j < pages.size(); j++) {
+            if (unchanged[j])
+                continue;
+            auto begin = pages[j].address;
+            auto end = begin + pages[j].end;
+            if (!pieces.empty() && pieces.back().last + 1 == j && pages[j - 1].address + _page_size == begin) {
+                auto &p = pieces.back();
+                if (total + (end - p.end) > budget)
+                    break;
+                total += end - p.end;
+                p.end = end;
+                p.last = j;
+                continue;
+            }
+            if (!pieces.empty() && total + (end - begin) > budget)
+                break;
+            pieces.push_back({ j, j, begin, end, total });
+            total += end - begin;
+        }
+
+        buffer.resize(total);
+        entries.clear();
+        for (auto &p : pieces)
+            entries.emplace_back(pointer(process, p.begin), buffer.data() + p.offset, (size_t)(p.end - p.begin));
+        read_batch(entries);
+
+        // Pages of ranges which could not be read as a whole are read one by one, those failing are dropped.
+        readable.assign(j - i, 1);
+        retry.clear();
+        retry_pages.clear();
+        for (size_t k = 0; k < pieces.size(); k++) {
+            auto &p = pieces[k];
+            if (!entries[k].status || p.first == p.last) {
+                if (entries[k].status)
+                    readable[p.first - i] = 0;
+                continue;
+            }
+            for (auto n = p.first; n <= p.last; n++) {
+                retry.emplace_back(pointer(process, pages[n].address), buffer.data() + p.offset + (pages[n].address - p.begin), (size_t)pages[n].end);
+                retry_pages.push_back(n);
+            }
+        }
+        read_batch(retry);
+        for (size_t k = 0; k < retry.size(); k++) {
+            if (retry[k].status)
+                readable[retry_pages[k] - i] = 0;
+        }
+
+        data.assign(j - i, nullptr);
+        for (auto &p : pieces) {
+            for (auto n = p.first; n <= p.last; n++)
+                data[n - i] = buffer.data() + p.offset + (pages[n].address - p.begin);
+        }
+
+        for (auto n = i; n < j; n++) {
+            auto &page = pages[n];
+            if (unchanged[n]) {
+                for_each_offset(_storage, page, [&](size_t offset) {
+                    auto previous = _storage.values[value++];
+                    if (test(condition, previous, previous, a, b))
+                        add(result, page.address + offset, previous);
+                });
+                continue;
+            }
+            if (!readable[n - i]) {
+                value += page.count;
+                continue;
+            }
+            for_each_offset(_storage, page, [&](size_t offset) {
+                T current;
+                std::memcpy(&current, data[n - i] + offset, sizeof(T));
+                if (test(condition, current, _storage.values[value++], a, b))
+                    add(result, page.address + offset, current);
+            });
+        }
+
+        i = j;
+    }
+    finish(result);
+
+    _storage = std::move(result);
+    scanned();
+    return count();
+}
+
+template<typename T>
+void value_scan<T>::reset() {
+    _storage = storage();
+    _started = false;
+}
+
+template<typename T>
+size_t value_scan<T>::footprint() const {
+    return _storage.pages.size() * sizeof(page)
+        + _storage.offsets.size() * sizeof(uint16_t)
+        + _storage.bitmaps.size() * sizeof(uint64_t)
+        + _storage.values.size() * sizeof(T);
+}
+
+template<typename T>
+std::vector<uintptr_t> value_scan<T>::addresses(size_t limit) const {
+    std::vector<uintptr_t> addresses;
+    addresses.reserve((std::min)(limit, count()));
+    for_each([&](uintptr_t address, T) {
+        if (addresses.size() < limit)
+            addresses.push_back(address);
+    });
+    return addresses;
+}
+
+namespace rmm {
+
+    template class value_scan<int8_t>;
+    template class value_scan<uint8_t>;
+    template class value_scan<int16_t>;
+    template class value_scan<uint16_t>;
+    template class value_scan<int32_t>;
+    template class value_scan<uint32_t>;
+    template class value_scan<int64_t>;
+    template class value_scan<uint64_t>;
+    template class value_scan<float>;
+    template class value_scan<double>;
+
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include "typedefs.h"
+#include "pointer.h"
+#include "memory.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace rmm {
+
+    class change_tracker;
+
+    // Incremental scan narrowing down the addresses of a value of type T:
+    // `first` collects the candidates within `memory`, each `next` keeps those satisfying a condition.
+    //
+    // Candidates are stored per page: the page address plus either page-relative offsets,
+    // or a bitmap of aligned slots once more than 1/16 of the slots are candidates,
+    // along with the value each candidate had during the previous scan.
+    // `next` reads only pages which still hold candidates (up to the end of the last one),
+    // adjacent pages as one range, all ranges of up to `memory.scan_budget()` bytes with a single read_batch.
+    // With a change_tracker, pages it reports unchanged are not read at all (see set_tracker).
+    //
+    // Instantiated for 8/16/32/64-bit integers, float and double.
+    template<typename T>
+    class value_scan {
+    public:
+        enum condition {
+            any,        // first scan only: every aligned position (unknown initial value)
+            exact,      // == a
+            range,      // a <= value <= b
+            changed,    // next scan only, compared to the previous scan
+            unchanged,
+            increased,
+            decreased,
+        };
+
+        // `alignment` must be a power of two, at most the page size.
+        explicit value_scan(const memory &memory, size_t alignment = alignof(T));
+
+        // Returns the number of candidates.
+        size_t first(condition condition, T a = T(), T b = T());
+        size_t next(condition condition, T a = T(), T b = T());
+        void reset();
+
+        inline size_t count() const { return _storage.values.size(); }
+        // Bytes occupied by candidates.
+        size_t footprint() const;
+
+        // Candidates on pages left unchanged according to `tracker` are tested against the values read by the previous scan
+        // instead of being read again. This holds only if the tracker advanced exactly once since the previous scan,
+        // otherwise `next` reads every page with candidates. The tracker must outlive its use here.
+        inline const change_tracker* tracker() const { return _tracker; }
+        inline void set_tracker(const change_tracker *tracker) { _tracker = tracker; }
+
+        std::vector<uintptr_t> addresses(size_t limit = SIZE_MAX) const;
+        inline pointer operator[](uintptr_t address) const { return pointer(_memory.begin().process(), address); }
+
+        // Calls `fn(address, value)` for every candidate in ascending order of address,
+        // `value` is the one read by the last scan.
+        template<typename F>
+        void for_each(F &&fn) const;
+
+    private:
+        struct page {
+            uintptr_t address;
+            uint32_t index;     // of the first offset in `offsets` or the first word in `bitmaps`
+            uint32_t count;
+            uint32_t end;       // page-relative end of the last candidate
+            bool dense;
+        };
+
+        struct storage {
+            std::vector<page> pages;
+            std::vector<uint16_t> offsets;
+            std::vector<uint64_t> bitmaps;
+            std::vector<T> values;
+        };
+
+        template<typename F>
+        void for_each_offset(const storage &storage, const page &page, F &&fn) const;
+        void add(storage &storage, uintptr_t address, T value) const;
+        void finish(storage &storage) const;
+        void scanned();
+
+        memory _memory;
+        size_t _alignment;
+        size_t _page_size;
+        size_t _slots;      // aligned positions per page
+        bool _started = false;
+        storage _storage;
+        const change_tracker *_tracker = nullptr;
+        // tracker and its epoch at the previous scan
+        const change_tracker *_scanned_tracker = nullptr;
+        uint64_t _scanned_epoch = 0;
+    };
+
+    template<typename T>
+    template<typename F>
+    void value_scan<T>::for_each_offset(const storage &storage, const page &page, F &&fn) const {
+        if (!page.dense) {
+            for (size_t i = 0; i < page.count; i++)
+                fn((size_t)storage.offsets[page.index + i]);
+            return;
+        }
+        auto words = (_slots + 63) / 64;
+        for (size_t w = 0; w < words; w++) {
+            // dense pages have plenty of bits set, a plain walk will do
+            auto bits = storage.bitmaps[page.index + w];
+            for (size_t slot = w * 64; bits != 0; slot++, bits >>= 1) {
+                if (bits & 1)
+                    fn(slot * _alignment);
+            }
+        }
+    }
+
+    template<typename T>
+    template<typename F>
+    void value_scan<T>::for_each(F &&fn) const {
+        size_t value = 0;
+        for (auto &page : _storage.pages) {
+            for_each_offset(_storage, page, [&](size_t offset) {
+                fn(page.address + offset, _storage.values[value++]);
+            });
+        }
+    }
+
+}
@@ -0,0 +1,138 @@
+#ifdef _WIN32
+
+#include "win32_backend.h"
+#include "statistics.h"
+
+#include <Windows.h>
+#include <Psapi.h>
+#include <TlHelp32.h>
+
+using namespace rmm;
+
+namespace {
+
+    inline std::error_code last_error() {
+        return std::error_code(GetLastError(), std::system_category());
+    }
+
+}
+
+win32_backend::win32_backend() {
+    GetSystemInfo(&sys_info);
+}
+
+uintptr_t win32_backend::min_address() const {
+    return (uintptr_t)sys_info.lpMinimumApplicationAddress;
+}
+
+uintptr_t win32_backend::max_address() const {
+    return (uintptr_t)sys_info.lpMaximumApplicationAddress;
+}
+
+size_t win32_backend::page_size() const {
+    return sys_info.dwPageSize;
+}
+
+std::error_code win32_backend::read(HANDLE process, uintptr_t address, void *buffer, size_t size) {
+    statistics::add(statistics::read_calls);
+    if (!ReadProcessMemory(process, (LPCVOID)address, buffer, size, NULL)) {
+        statistics::add(statistics::failed_reads);
+        return last_error();
+    }
+    statistics::add(statistics::bytes_read, size);
+    return {};
+}
+
+std::error_code win32_backend::write(HANDLE process, uintptr_t address, const void *buffer, size_t size) {
+    statistics::add(statistics::write_calls);
+    if (!WriteProcessMemory(process, (LPVOID)address, buffer, size, NULL)) {
+        statistics::add(statistics::failed_writes);
+        return last_error();
+    }
+    statistics::add(statistics::bytes_written, size);
+    return {};
+}
+
+std::error_code win32_backend::query(HANDLE process, uintptr_t address, region_info &info) {
+    MEMORY_BASIC_INFORMATION mi;
+    statistics::add(statistics::query_calls);
+    if (!VirtualQueryEx(process, (LPCVOID)address, &mi, sizeof(mi)))
+        return last_error();
+    info.begin = (uintptr_t)mi.BaseAddress;
+    info.end = (uintptr_t)mi.BaseAddress + mi.RegionSize;
+    info.allocation_protect = mi.AllocationProtect;
+    info.protect = mi.Protect;
+    info.state = mi.State;
+    info.type = mi.Type;
+    return {};
+}
+
+std::error_code win32_backend::protect(HANDLE process, uintptr_t address, size_t size, DWORD new_prot, DWORD &old_prot) {
+    statistics::add(statistics::protect_calls);
+    if (!VirtualProtectEx(process, (LPVOID)address, size, new_prot, &old_prot))
+        return last_error();
+    return {};
+}
+
+std::vector<module_info> win32_backend::modules(HANDLE process) {
+    statistics::add(statistics::enumeration_calls);
+    auto hSnapshot = CreateToolhelp32Snapshot(TH32CS_SNAPMODULE | TH32CS_SNAPMODULE32, GetProcessId(process));
+    if (hSnapshot == INVALID_HANDLE_VALUE)
+        throw std::system_error(GetLastError(), std::system_category());
+
+    std::vector<module_info> modules;
+    MODULEENTRY32 me;
+    me.dwSize = sizeof(me);
+    if (!Module32First(hSnapshot, &me)) {
+        auto error = GetLastError();
+        CloseHandle(hSnapshot);
+        throw std::system_error(error, std::system_category());
+    }
+    do {
+        modules.push_back({ me.szModule, (uintptr_t)me.modBaseAddr, (uintptr_t)me.modBaseAddr + me.modBaseSize });
+    } while (Module32Next(hSnapshot, &me));
+    auto error = GetLastError();
+    CloseHandle(hSnapshot);
+    if (error != ERROR_NO_MORE_FILES)
+        throw std::system_error(error, std::system_category());
+
+    return modules;
+}
+
+std::vector<process_info> win32_backend::processes() {
+    statistics::add(statistics::enumeration_calls);
+    auto hSnapshot = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
+    if (hSnapshot == INVALID_HANDLE_VALUE)
+        throw std::system_error(GetLastError(), std::system_category());
+
+    std::vector<process_info> processes;
+    PROCESSENTRY32 pe;
+    pe.dwSize = sizeof(pe);
+    if (!Process32First(hSnapshot, &pe)) {
+        auto error = GetLastError();
+        CloseHandle(hSnapshot);
+        throw std::system_error(error, std::system_category());
+    }
+    do {
+        processes.push_back({ pe.th32ProcessID, pe.szExeFile });
+    } while (Process32Next(hSnapshot, &pe));
+    auto error = GetLastError();
+    CloseHandle(hSnapshot);
+    if (error != ERROR_NO_MORE_FILES)
+        throw std::system_error(error, std::system_category());
+
+    return processes;
+}
+
+HANDLE win32_backend::open(DWORD pid) {
+    auto hProcess = OpenProcess(PROCESS_ALL_ACCESS, FALSE, pid);
+    if (!hProcess)
+        throw std::system_error(GetLastError(), std::system_category());
+    return hProcess;
+}
+
+void win32_backend::close(HANDLE process) {
+    CloseHandle(process);
+}
+
+#endif
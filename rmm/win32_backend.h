@@ -0,0 +1,33 @@
+#pragma once
+
+#ifdef _WIN32
+
+#include "backend.h"
+
+namespace rmm {
+
+    class win32_backend : public backend {
+    public:
+        win32_backend();
+
+        uintptr_t min_address() const override;
+        uintptr_t max_address() const override;
+        size_t page_size() const override;
+
+        std::error_code read(HANDLE process, uintptr_t address, void *buffer, size_t size) override;
+        std::error_code write(HANDLE process, uintptr_t address, const void *buffer, size_t size) override;
+        std::error_code query(HANDLE process, uintptr_t address, region_info &info) override;
+        std::error_code protect(HANDLE process, uintptr_t address, size_t size, DWORD new_prot, DWORD &old_prot) override;
+
+        std::vector<module_info> modules(HANDLE process) override;
+        std::vector<process_info> processes() override;
+        HANDLE open(DWORD pid) override;
+        void close(HANDLE process) override;
+
+    private:
+        SYSTEM_INFO sys_info;
+    };
+
+}
+
+#endif
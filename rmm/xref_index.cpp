@@ -0,0 +1,297 @@
+#include "xref_index.h"
+#include "region_reader.h"
+#include "scan_kernel.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define RMM_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define RMM_TARGET(isa) __attribute__((target(isa)))
+#else
+#define RMM_TARGET(isa)
+#endif
+
+using namespace rmm;
+
+namespace {
+
+    // Bytes needed before/after a candidate byte to decode the instruction around it.
+    const size_t look_behind = 4; // prefix, REX, 0F, opcode before ModRM
+    const size_t look_ahead = 6;  // 0F 8x rel32
+
+    inline bool is_candidate(unsigned char b) {
+        return (b & 0xFE) == 0xE8 || b == 0x0F || (b & 0xC7) == 0x05;
+    }
+
+    // Sorted, merged address ranges.
+    class range_set {
+    public:
+        explicit range_set(const std::vector<memory> &regions) {
+            for (auto &r : regions) {
+                if (!_ranges.empty() && _ranges.back().second == r.begin())
+                    _ranges.back().second = r.end();
+                else
+                    _ranges.emplace_back(r.begin(), r.end());
+            }
+        }
+
+        bool contains(uintptr_t address) const {
+            auto it = std::upper_bound(_ranges.begin(), _ranges.end(), address, [](uintptr_t address, const std::pair<uintptr_t, uintptr_t> &range) {
+                return address < range.second;
+            });
+            return it != _ranges.end() && it->first <= address;
+        }
+
+    private:
+        std::vector<std::pair<uintptr_t, uintptr_t>> _ranges;
+    };
+
+    // Calls `fn(i)` for every i in [begin, end) where data[i] is a candidate byte.
+    template<typename F>
+    void candidates_scalar(const unsigned char *data, size_t begin, size_t end, F &&fn) {
+        for (auto i = begin; i < end; i++) {
+            if (is_candidate(data[i]))
+                fn(i);
+        }
+    }
+
+#ifdef RMM_X86
+    inline unsigned count_trailing_zeros(unsigned bits) {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward(&index, bits);
+        return index;
+#else
+        return __builtin_ctz(bits);
+#endif
+    }
+
+    RMM_TARGET("sse2")
+    inline unsigned candidates_sse2(const unsigned char *p) {
+        auto d = _mm_loadu_si128((const __m128i*)p);
+        auto branch = _mm_cmpeq_epi8(_mm_and_si128(d, _mm_set1_epi8((char)0xFE)), _mm_set1_epi8((char)0xE8));
+        auto escape = _mm_cmpeq_epi8(d, _mm_set1_epi8(0x0F));
+        auto modrm = _mm_cmpeq_epi8(_mm_and_si128(d, _mm_set1_epi8((char)0xC7)), _mm_set1_epi8(0x05));
+        return (unsigned)_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(branch, escape), modrm));
+    }
+
+    template<typename F>
+    RMM_TARGET("sse2")
+    void candidates_sse2(const unsigned char *data, size_t begin, size_t end, F &&fn) {
+        auto i = begin;
+        for (; i + 16 <= end; i += 16) {
+            for (auto bits = candidates_sse2(data + i); bits != 0; bits &= bits - 1)
+                fn(i + count_trailing_zeros(bits));
+        }
+        candidates_scalar(data, i, end, fn);
+    }
+
+    RMM_TARGET("avx2")
+    inline unsigned candidates_avx2(const unsigned char *p) {
+        auto d = _mm256_loadu_si256((const __m256i*)p);
+        auto branch = _mm256_cmpeq_epi8(_mm256_and_si256(d, _mm256_set1_epi8((char)0xFE)), _mm256_set1_epi8((char)0xE8));
+        auto escape = _mm256_cmpeq_epi8(d, _mm256_set1_epi8(0x0F));
+        auto modrm = _mm256_cmpeq_epi8(_mm256_and_si256(d, _mm256_set1_epi8((char)0xC7)), _mm256_set1_epi8(0x05));
+        return (unsigned)_mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(branch, escape), modrm));
+    }
+
+    template<typename F>
+    RMM_TARGET("avx2")
+    void candidates_avx2(const unsigned char *data, size_t begin, size_t end, F &&fn) {
+        auto i = begin;
+        for (; i + 32 <= end; i += 32) {
+            for (auto bits = candidates_avx2(data + i); bits != 0; bits &= bits - 1)
+                fn(i + count_trailing_zeros(bits));
+        }
+        candidates_sse2(data, i, end, fn);
+    }
+#endif
+
+    template<typename F>
+    void candidates(const unsigned char *data, size_t begin, size_t end, F &&fn) {
+#ifdef RMM_X86
+        switch (scan_kernel::selected()) {
+        case scan_kernel::avx512:
+        case scan_kernel::avx2:
+            return candidates_avx2(data, begin, end, fn);
+        case scan_kernel::sse2:
+            return candidates_sse2(data, begin, end, fn);
+        default:
+            break;
+        }
+#endif
+        candidates_scalar(data, begin, end, fn);
+    }
+
+    inline int32_t rel32(const unsigned char *p) {
+        int32_t rel;
+        std::memcpy(&rel, p, sizeof(rel));
+        return rel;
+    }
+
+    // Two-byte opcodes (0F xx) with a ModRM operand and no immediate.
+    inline bool two_byte_operand(unsigned char op) {
+        switch (op) {
+        case 0x10: case 0x11: case 0x12: case 0x13: case 0x16: case 0x17: case 0x18:
+        case 0x28: case 0x29: case 0x2A: case 0x2C: case 0x2D: case 0x2E: case 0x2F:
+        case 0x51: case 0x54: case 0x55: case 0x56: case 0x57: case 0x58: case 0x59:
+        case 0x5A: case 0x5B: case 0x5C: case 0x5D: case 0x5E: case 0x5F:
+        case 0x6E: case 0x6F: case 0x7E: case 0x7F:
+        case 0xAF: case 0xB6: case 0xB7: case 0xBE: case 0xBF: case 0xD6: case 0xE7:
+            return true;
+        default:
+            return op >= 0x40 && op <= 0x4F; // CMOVcc
+        }
+    }
+
+    // Size of the immediate following [rip + disp32] of one-byte opcode `op` with ModRM `modrm`, -1 if not supported.
+    inline int one_byte_operand(unsigned char op, unsigned char modrm) {
+        auto reg = (modrm >> 3) & 7;
+        switch (op) {
+        case 0x01: case 0x03: case 0x09: case 0x0B: case 0x11: case 0x13: case 0x19: case 0x1B:
+        case 0x21: case 0x23: case 0x29: case 0x2B: case 0x31: case 0x33: case 0x39: case 0x3B:
+        case 0x63: case 0x84: case 0x85: case 0x86: case 0x87: case 0x88: case 0x89: case 0x8A:
+        case 0x8B: case 0x8D:
+            return 0;
+        case 0x80: case 0x83:
+            return 1;
+        case 0x81:
+            return 4;
+        case 0xC6:
+            return reg == 0 ? 1 : -1;
+        case 0xC7:
+            return reg == 0 ? 4 : -1;
+        case 0xF6:
+            return reg == 0 ? 1 : -1;
+        case 0xF7:
+            return reg == 0 ? 4 : -1;
+        case 0xFF:
+            return reg == 0 || reg == 1 || reg == 2 || reg == 4 || reg == 6 ? 0 : -1;
+        default:
+            return -1;
+        }
+    }
+
+}
+
+xref_index::xref_index(const memory &memory, bool code_64bit)
+    : _memory(memory)
+    , _code_64bit(code_64bit)
+{
+    build();
+}
+
+void xref_index::build() {
+    _xrefs.clear();
+
+    auto process = _memory.begin().process();
+    std::vector<memory> code;
+    for (auto &ri : _memory.readable_regions()) {
+        if (ri.protect & (PAGE_EXECUTE | PAGE_EXECUTE_READ | PAGE_EXECUTE_READWRITE | PAGE_EXECUTE_WRITECOPY))
+            code.emplace_back(process, ri.begin, ri.end, true);
+    }
+    range_set executable(code);
+    range_set readable(memory(process).regions());
+
+    // 32-bit code wraps around at 4 GiB
+    auto mask = _code_64bit ? ~(uintptr_t)0 : (uintptr_t)0xFFFFFFFF;
+
+    region_reader reader(process, _memory.scan_budget());
+    for (auto &region : code) {
+        reader.forward(region.begin(), region.end(), look_behind + look_ahead - 1, [&](uintptr_t address, const char *chunk, size_t size) {
+            auto bytes = (const unsigned char*)chunk;
+            // positions are examined in exactly one chunk, with look_behind/look_ahead bytes around them
+            size_t begin = address == region.begin() ? 0 : look_behind;
+            size_t end = address + size == region.end() ? size : (size >= look_ahead ? size - look_ahead + 1 : 0);
+            if (begin >= end)
+                return true;
+
+            candidates(bytes, begin, end, [&](size_t p) {
+                auto b = bytes[p];
+                if ((b & 0xFE) == 0xE8) {
+                    if (p + 5 > size)
+                        return;
+                    auto target = (address + p + 5 + rel32(bytes + p + 1)) & mask;
+                    if (executable.contains(target))
+                        _xrefs.push_back({ target, address + p, b == 0xE8 ? call : jump });
+                    return;
+                }
+                if (b == 0x0F) {
+                    if (p + 6 > size || (bytes[p + 1] & 0xF0) != 0x80)
+                        return;
+                    auto target = (address + p + 6 + rel32(bytes + p + 2)) & mask;
+                    if (executable.contains(target))
+                        _xrefs.push_back({ target, address + p, branch });
+                    return;
+                }
+
+                // ModRM of [rip + disp32], of [disp32] in 32-bit code
+                if (p < 1 || p + 5 > size)
+                    return;
+                size_t start;
+                int immediate;
+                bool two_byte = p >= 2 && bytes[p - 2] == 0x0F;
+                if (two_byte) {
+                    if (!two_byte_operand(bytes[p - 1]))
+                        return;
+                    start = p - 2;
+                    immediate = 0;
+                } else {
+                    immediate = one_byte_operand(bytes[p - 1], b);
+                    if (immediate < 0)
+                        return;
+                    start = p - 1;
+                }
+                if (_code_64bit && start >= 1 && (bytes[start - 1] & 0xF0) == 0x40) // REX (INC/DEC in 32-bit code)
+                    start--;
+                if (start >= 1 && bytes[start - 1] == 0x66) {
+                    start--;
+                    if (immediate == 4)
+                        immediate = 2;
+                } else if (two_byte && start >= 1 && (bytes[start - 1] == 0xF2 || bytes[start - 1] == 0xF3)) {
+                    start--;
+                }
+                auto target = _code_64bit ? address + p + 5 + immediate + rel32(bytes + p + 1) : (uintptr_t)(uint32_t)rel32(bytes + p + 1);
+                if (readable.contains(target))
+                    _xrefs.push_back({ target, address + start, data });
+            });
+            return true;
+        });
+    }
+
+    std::sort(_xrefs.begin(), _xrefs.end(), [](const xref &a, const xref &b) {
+        return a.target < b.target || (a.target == b.target && a.source < b.source);
+    });
+}
+
+std::vector<xref_index::xref>::const_iterator xref_index::lower_bound(uintptr_t target) const {
+    return std::lower_bound(_xrefs.begin(), _xrefs.end(), target, [](const xref &x, uintptr_t target) {
+        return x.target < target;
+    });
+}
+
+std::vector<uintptr_t> xref_index::find(uintptr_t target, unsigned kinds) const {
+    std::vector<uintptr_t> sources;
+    for (auto it = lower_bound(target); it != _xrefs.end() && it->target == target; ++it) {
+        if (it->kind & kinds)
+            sources.push_back(it->source);
+    }
+    return sources;
+}
+
+std::vector<xref_index::xref> xref_index::find_range(uintptr_t begin, uintptr_t end, unsigned kinds) const {
+    std::vector<xref> xrefs;
+    for (auto it = lower_bound(begin); it != _xrefs.end() && it->target < end; ++it) {
+        if (it->kind & kinds)
+            xrefs.push_back(*it);
+    }
+    return xrefs;
+}
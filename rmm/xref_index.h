@@ -0,0 +1,56 @@
+#pragma once
+
+#include "typedefs.h"
+#include "pointer.h"
+#include "memory.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace rmm {
+
+    // Index of x86/x64 code cross-references within the executable regions of `memory`, sorted by target:
+    // CALL/JMP rel32 (E8/E9), Jcc rel32 (0F 80-8F) and [rip + disp32] operands of common instructions,
+    // which are absolute [disp32] operands in 32-bit code.
+    // Code is swept linearly (candidate bytes are located 16/32 at a time, then decoded),
+    // so bytes which merely look like such instructions are indexed as well; branch targets must lie
+    // within an indexed executable region and RIP-relative targets within a readable one, which filters most of them.
+    class xref_index {
+    public:
+        enum reference_kind : uint8_t {
+            call = 1,       // E8 rel32
+            jump = 2,       // E9 rel32
+            branch = 4,     // Jcc rel32
+            data = 8,       // [rip + disp32] or [disp32], including CALL/JMP through memory (the target is the slot)
+            any = call | jump | branch | data,
+        };
+
+        struct xref {
+            uintptr_t target;
+            uintptr_t source; // first byte of the instruction
+            reference_kind kind;
+        };
+
+        // `code_64bit` tells how the code is decoded, e.g. module_image::is_64bit() of the module it belongs to.
+        explicit xref_index(const memory &memory, bool code_64bit = sizeof(void*) == 8);
+
+        void build();
+
+        inline bool code_64bit() const { return _code_64bit; }
+        inline size_t size() const { return _xrefs.size(); }
+        inline const std::vector<xref>& xrefs() const { return _xrefs; }
+
+        // Sources referencing `target` (by any of `kinds`), in ascending order.
+        std::vector<uintptr_t> find(uintptr_t target, unsigned kinds = any) const;
+        // Cross-references to [begin, end), in ascending order of target.
+        std::vector<xref> find_range(uintptr_t begin, uintptr_t end, unsigned kinds = any) const;
+
+    private:
+        std::vector<xref>::const_iterator lower_bound(uintptr_t target) const;
+
+        memory _memory;
+        bool _code_64bit;
+        std::vector<xref> _xrefs;
+    };
+
+}